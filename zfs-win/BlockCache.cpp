@@ -0,0 +1,538 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "BlockCache.h"
+#include "L2Cache.h"
+#include "Compress.h"
+
+namespace ZFS
+{
+	BlockCache::BlockCache(uint64_t budget, bool compressed)
+		: m_budget(0)
+		, m_target(0)
+		, m_logical(0)
+		, m_compressed(compressed)
+		, m_hot_bytes(0)
+		, m_hot_budget(0)
+		, m_l2(NULL)
+	{
+		memset(m_bytes, 0, sizeof(m_bytes));
+		memset(&m_stats, 0, sizeof(m_stats));
+
+		Resize(budget);
+
+		m_target = m_budget / 2;
+	}
+
+	BlockCache::~BlockCache()
+	{
+		SetL2(NULL);
+
+		Clear();
+	}
+
+	void BlockCache::Resize(uint64_t budget)
+	{
+		// the decompressed tier takes an eighth in compressed mode
+
+		m_hot_budget = m_compressed ? budget / 8 : 0;
+		m_budget = budget - m_hot_budget;
+		m_target = std::min<uint64_t>(m_target, m_budget);
+	}
+
+	void BlockCache::SetBudget(uint64_t budget)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+
+			Resize(budget);
+
+			while(m_bytes[MRU] + m_bytes[MFU] > m_budget)
+			{
+				Evict(m_bytes[MRU] > m_target || m_bytes[MFU] == 0 ? MRU : MFU);
+			}
+
+			for(int i = MRU_GHOST; i <= MFU_GHOST; i++)
+			{
+				while(m_bytes[i] > m_budget)
+				{
+					Remove(m_list[i].back());
+				}
+			}
+
+			while(m_hot_bytes > m_hot_budget)
+			{
+				RemoveHot(m_hot_list.back());
+			}
+		}
+
+		Flush();
+	}
+
+	void BlockCache::SetCompressed(bool compressed)
+	{
+		uint64_t budget = GetBudget();
+
+		Clear();
+
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		m_compressed = compressed;
+
+		Resize(budget);
+
+		m_target = m_budget / 2;
+	}
+
+	void BlockCache::Clear()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		for(auto i = m_map.begin(); i != m_map.end(); i++)
+		{
+			Entry* e = i->second;
+
+			if(e->data != NULL)
+			{
+				_aligned_free(e->data);
+			}
+
+			delete e;
+		}
+
+		m_map.clear();
+
+		for(int i = 0; i < LISTS; i++)
+		{
+			m_list[i].clear();
+			m_bytes[i] = 0;
+		}
+
+		while(!m_hot_list.empty())
+		{
+			RemoveHot(m_hot_list.back());
+		}
+
+		m_logical = 0;
+		m_target = m_budget / 2;
+	}
+
+	bool BlockCache::GetKey(const blkptr_t* bp, BlockKey& key)
+	{
+		const dva_t& addr = bp->blk_dva[0];
+
+		if(bp->birth == 0 || addr.asize == 0 || addr.gang != 0)
+		{
+			return false; // holes, gang blocks
+		}
+
+		key.vdev = addr.vdev;
+		key.offset = addr.offset;
+		key.birth = bp->birth;
+
+		return true;
+	}
+
+	void BlockCache::SetL2(L2Cache* l2)
+	{
+		Flush();
+
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		m_l2 = l2;
+	}
+
+	void BlockCache::Persist()
+	{
+		if(m_l2 == NULL)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		// frequent first, the ring may not take it all, streamed blocks too, a restart reads them again
+
+		for(int i = MFU; i >= MRU; i--)
+		{
+			for(auto j = m_list[i].begin(); j != m_list[i].end(); j++)
+			{
+				Entry* e = *j;
+
+				if(!m_l2->Contains(e->key))
+				{
+					m_l2->Write(e->key, e->data, e->size, e->lsize, e->comp);
+				}
+			}
+		}
+	}
+
+	void BlockCache::Flush()
+	{
+		std::vector<Spill> spill;
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+
+			spill.swap(m_spill);
+		}
+
+		for(auto i = spill.begin(); i != spill.end(); i++)
+		{
+			if(m_l2 != NULL)
+			{
+				m_l2->Write(i->key, i->data, i->size, i->lsize, i->comp);
+			}
+
+			_aligned_free(i->data);
+		}
+	}
+
+	bool BlockCache::Lookup(const BlockKey& key, uint8_t* dst, size_t size)
+	{
+		if(m_budget == 0)
+		{
+			return false;
+		}
+
+		if(Find(key, dst, size))
+		{
+			return true;
+		}
+
+		if(m_l2 == NULL)
+		{
+			return false;
+		}
+
+		std::vector<uint8_t> data;
+		size_t lsize;
+		uint8_t comp;
+
+		if(!m_l2->Read(key, data, lsize, comp) || lsize > size)
+		{
+			return false;
+		}
+
+		if(comp == ZIO_COMPRESS_OFF)
+		{
+			memcpy(dst, data.data(), data.size());
+		}
+		else if(!ZFS::decompress(data.data(), dst, data.size(), lsize, comp))
+		{
+			return false;
+		}
+
+		// back in memory, it was useful again
+
+		Insert(key, data.data(), data.size(), dst, lsize, comp);
+
+		return true;
+	}
+
+	bool BlockCache::Find(const BlockKey& key, uint8_t* dst, size_t size)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		auto i = m_map.find(key);
+
+		if(i == m_map.end() || i->second->data == NULL || i->second->lsize > size)
+		{
+			m_stats.misses++;
+
+			return false;
+		}
+
+		Entry* e = i->second;
+
+		if(e->comp == ZIO_COMPRESS_OFF)
+		{
+			memcpy(dst, e->data, e->size);
+		}
+		else
+		{
+			auto j = m_hot_map.find(key);
+
+			if(j != m_hot_map.end())
+			{
+				HotEntry* h = j->second;
+
+				memcpy(dst, h->data, h->size);
+
+				m_hot_list.erase(h->pos);
+
+				h->pos = m_hot_list.insert(m_hot_list.begin(), h);
+
+				m_stats.hot_hits++;
+			}
+			else
+			{
+				if(!ZFS::decompress(e->data, dst, e->size, e->lsize, e->comp))
+				{
+					m_stats.misses++;
+
+					return false;
+				}
+
+				m_stats.decompressed++;
+
+				// already frequent before this hit, not worth decompressing every time
+
+				if(e->list == MFU)
+				{
+					AddHot(key, dst, e->lsize);
+				}
+			}
+		}
+
+		// a second hit makes it frequent, even if it came from a stream
+
+		Unlink(e);
+
+		e->streaming = false;
+
+		Link(e, MFU);
+
+		m_stats.hits++;
+
+		return true;
+	}
+
+	void BlockCache::Insert(const BlockKey& key, const uint8_t* src, size_t psize, const uint8_t* dst, size_t lsize, uint8_t comp, bool streaming)
+	{
+		Store(key, src, psize, dst, lsize, comp, streaming);
+
+		Flush();
+	}
+
+	void BlockCache::Store(const BlockKey& key, const uint8_t* src, size_t psize, const uint8_t* dst, size_t lsize, uint8_t comp, bool streaming)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		// compressed blocks stay that way if asked to, the rest is kept as the caller sees it
+
+		bool compressed = m_compressed && comp != ZIO_COMPRESS_OFF && src != NULL && psize < lsize;
+
+		size_t size = compressed ? psize : lsize;
+
+		if(size > m_budget / 8)
+		{
+			return;
+		}
+
+		auto i = m_map.find(key);
+
+		Entry* e = i != m_map.end() ? i->second : NULL;
+
+		if(e != NULL && e->data != NULL)
+		{
+			return; // someone else read it in the meantime
+		}
+
+		int list = MRU;
+
+		if(e != NULL)
+		{
+			// it was evicted before, the list it came from deserved more room
+
+			if(e->list == MRU_GHOST)
+			{
+				uint64_t delta = std::max<uint64_t>(m_bytes[MFU_GHOST] / m_bytes[MRU_GHOST], 1) * size;
+
+				m_target = std::min<uint64_t>(m_target + delta, m_budget);
+
+				m_stats.mru_ghost_hits++;
+
+				Replace(size, false);
+			}
+			else
+			{
+				uint64_t delta = std::max<uint64_t>(m_bytes[MRU_GHOST] / m_bytes[MFU_GHOST], 1) * size;
+
+				m_target = m_target > delta ? m_target - delta : 0;
+
+				m_stats.mfu_ghost_hits++;
+
+				Replace(size, true);
+			}
+
+			Unlink(e);
+
+			list = MFU;
+			streaming = false;
+		}
+		else
+		{
+			Replace(size, false);
+
+			e = new Entry();
+
+			e->key = key;
+
+			m_map[key] = e;
+		}
+
+		e->data = (uint8_t*)_aligned_malloc(size, 16);
+		e->size = size;
+		e->lsize = lsize;
+		e->comp = compressed ? comp : (uint8_t)ZIO_COMPRESS_OFF;
+		e->streaming = streaming;
+
+		memcpy(e->data, compressed ? src : dst, size);
+
+		Link(e, list, streaming);
+
+		m_stats.inserts++;
+
+		// the recent side and its ghosts fit in the budget, everything in twice the budget
+
+		while(m_bytes[MRU] + m_bytes[MRU_GHOST] > m_budget && !m_list[MRU_GHOST].empty())
+		{
+			Remove(m_list[MRU_GHOST].back());
+		}
+
+		while(m_bytes[MRU] + m_bytes[MFU] + m_bytes[MRU_GHOST] + m_bytes[MFU_GHOST] > m_budget * 2 && !m_list[MFU_GHOST].empty())
+		{
+			Remove(m_list[MFU_GHOST].back());
+		}
+	}
+
+	void BlockCache::Link(Entry* e, int list, bool cold)
+	{
+		e->list = list;
+		e->pos = cold ? m_list[list].insert(m_list[list].end(), e) : m_list[list].insert(m_list[list].begin(), e);
+
+		m_bytes[list] += e->size;
+
+		if(e->data != NULL)
+		{
+			m_logical += e->lsize;
+		}
+	}
+
+	void BlockCache::Unlink(Entry* e)
+	{
+		m_list[e->list].erase(e->pos);
+		m_bytes[e->list] -= e->size;
+
+		if(e->data != NULL)
+		{
+			m_logical -= e->lsize;
+		}
+	}
+
+	void BlockCache::Remove(Entry* e)
+	{
+		Unlink(e);
+
+		m_map.erase(e->key);
+
+		if(e->data != NULL)
+		{
+			_aligned_free(e->data);
+		}
+
+		delete e;
+	}
+
+	void BlockCache::Evict(int list)
+	{
+		Entry* e = m_list[list].back();
+
+		m_stats.evictions++;
+
+		if(e->streaming)
+		{
+			Remove(e); // read once, not worth remembering
+
+			return;
+		}
+
+		Unlink(e);
+
+		if(m_l2 != NULL)
+		{
+			Spill s = {e->key, e->data, e->size, e->lsize, e->comp};
+
+			m_spill.push_back(s);
+		}
+		else
+		{
+			_aligned_free(e->data);
+		}
+
+		e->data = NULL;
+
+		Link(e, list == MRU ? MRU_GHOST : MFU_GHOST);
+	}
+
+	void BlockCache::Replace(size_t size, bool mfu_ghost_hit)
+	{
+		while(m_bytes[MRU] + m_bytes[MFU] + size > m_budget)
+		{
+			if(!m_list[MRU].empty() && (m_bytes[MRU] > m_target || (mfu_ghost_hit && m_bytes[MRU] == m_target) || m_list[MFU].empty()))
+			{
+				Evict(MRU);
+			}
+			else
+			{
+				Evict(MFU);
+			}
+		}
+	}
+
+	void BlockCache::AddHot(const BlockKey& key, const uint8_t* src, size_t size)
+	{
+		if(size > m_hot_budget)
+		{
+			return;
+		}
+
+		while(m_hot_bytes + size > m_hot_budget)
+		{
+			RemoveHot(m_hot_list.back());
+		}
+
+		HotEntry* h = new HotEntry();
+
+		h->key = key;
+		h->data = (uint8_t*)_aligned_malloc(size, 16);
+		h->size = size;
+		h->pos = m_hot_list.insert(m_hot_list.begin(), h);
+
+		memcpy(h->data, src, size);
+
+		m_hot_map[key] = h;
+		m_hot_bytes += size;
+	}
+
+	void BlockCache::RemoveHot(HotEntry* h)
+	{
+		m_hot_list.erase(h->pos);
+		m_hot_map.erase(h->key);
+		m_hot_bytes -= h->size;
+
+		_aligned_free(h->data);
+
+		delete h;
+	}
+}
@@ -0,0 +1,160 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "zfs.h"
+
+namespace ZFS
+{
+	struct BlockKey
+	{
+		uint64_t vdev;
+		uint64_t offset;
+		uint64_t birth;
+
+		bool operator == (const BlockKey& key) const {return offset == key.offset && vdev == key.vdev && birth == key.birth;}
+	};
+
+	struct BlockKeyHash
+	{
+		size_t operator () (const BlockKey& key) const
+		{
+			uint64_t h = (key.offset ^ (key.vdev << 48)) * 0x9e3779b97f4a7c15ULL ^ key.birth;
+
+			return (size_t)(h ^ (h >> 29));
+		}
+	};
+
+	class L2Cache;
+
+	struct BlockCacheStats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t inserts;
+		uint64_t evictions;
+		uint64_t mru_ghost_hits; // evicted from the recent list too early, it grows
+		uint64_t mfu_ghost_hits; // evicted from the frequent list too early, it grows
+		uint64_t decompressed; // hits on compressed blocks
+		uint64_t hot_hits; // served from the decompressed tier
+	};
+
+	// verified blocks, adaptive replacement: recently and frequently used lists,
+	// each with a ghost list remembering what was evicted from it to steer their share of the budget
+	//
+	// in compressed mode blocks are kept as they are on disk and decompressed on every hit,
+	// except for the hottest ones, a small tier of decompressed copies is in front of them
+
+	class BlockCache
+	{
+		enum {MRU, MFU, MRU_GHOST, MFU_GHOST, LISTS};
+
+		struct Entry
+		{
+			BlockKey key;
+			uint8_t* data; // NULL for ghosts
+			size_t size;
+			size_t lsize;
+			uint8_t comp; // data is compressed with this, or ZIO_COMPRESS_OFF
+			int list;
+			bool streaming;
+			std::list<Entry*>::iterator pos;
+		};
+
+		struct Spill
+		{
+			BlockKey key;
+			uint8_t* data;
+			size_t size;
+			size_t lsize;
+			uint8_t comp;
+		};
+
+		struct HotEntry
+		{
+			BlockKey key;
+			uint8_t* data;
+			size_t size;
+			std::list<HotEntry*>::iterator pos;
+		};
+
+		std::unordered_map<BlockKey, Entry*, BlockKeyHash> m_map;
+		std::list<Entry*> m_list[LISTS]; // most recent at the front
+		uint64_t m_bytes[LISTS];
+		uint64_t m_budget;
+		uint64_t m_target; // of the budget, how much the recent list may keep
+		uint64_t m_logical; // size of the cached blocks decompressed
+		bool m_compressed;
+		std::mutex m_lock;
+
+		std::unordered_map<BlockKey, HotEntry*, BlockKeyHash> m_hot_map;
+		std::list<HotEntry*> m_hot_list;
+		uint64_t m_hot_bytes;
+		uint64_t m_hot_budget;
+
+		L2Cache* m_l2;
+		std::vector<Spill> m_spill; // evicted, to be written to the second level once the lock is released
+
+		void Link(Entry* e, int list, bool cold = false);
+		void Unlink(Entry* e);
+		void Remove(Entry* e);
+		void Evict(int list);
+		void Replace(size_t size, bool mfu_ghost_hit);
+		void AddHot(const BlockKey& key, const uint8_t* src, size_t size);
+		void RemoveHot(HotEntry* e);
+		void Resize(uint64_t budget);
+		bool Find(const BlockKey& key, uint8_t* dst, size_t size);
+		void Flush();
+		void Store(const BlockKey& key, const uint8_t* src, size_t psize, const uint8_t* dst, size_t lsize, uint8_t comp, bool streaming);
+
+	public:
+		BlockCacheStats m_stats;
+
+	public:
+		BlockCache(uint64_t budget = 128 << 20, bool compressed = true);
+		virtual ~BlockCache();
+
+		void SetBudget(uint64_t budget); // in bytes, the decompressed tier included, 0 turns the cache off
+		void SetCompressed(bool compressed);
+		uint64_t GetBudget() const {return m_budget + m_hot_budget;}
+		uint64_t GetTarget() const {return m_target;}
+		uint64_t GetSize(bool frequent) const {return m_bytes[frequent ? MFU : MRU];}
+		uint64_t GetLogicalSize() const {return m_logical;}
+		uint64_t GetHotSize() const {return m_hot_bytes;}
+		bool IsCompressed() const {return m_compressed;}
+		void Clear();
+
+		// evicted blocks go to the second level and are looked up there on a miss, Persist hands it everything still in memory
+
+		void SetL2(L2Cache* l2);
+		void Persist();
+
+		static bool GetKey(const blkptr_t* bp, BlockKey& key);
+
+		bool Lookup(const BlockKey& key, uint8_t* dst, size_t size);
+
+		// src is the verified block as read (NULL if not at hand), dst is what it decompressed to,
+		// streaming blocks are evicted first and leave no ghost
+
+		void Insert(const BlockKey& key, const uint8_t* src, size_t psize, const uint8_t* dst, size_t lsize, uint8_t comp, bool streaming = false);
+	};
+}
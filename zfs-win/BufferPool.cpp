@@ -0,0 +1,351 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "BufferPool.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace ZFS
+{
+	// per thread buffers, a class holds at most 256 KB or two buffers, half of it moves at a time
+
+	struct BufferCache
+	{
+		enum {MAX_BUFFERS = 64, MAX_BYTES = 256 << 10};
+
+		void* slots[BufferPool::CLASSES][MAX_BUFFERS];
+		uint32_t count[BufferPool::CLASSES];
+
+		BufferCache()
+		{
+			memset(count, 0, sizeof(count));
+		}
+
+		~BufferCache()
+		{
+			BufferPool& pool = BufferPool::Get();
+
+			for(int i = 0; i < BufferPool::CLASSES; i++)
+			{
+				while(count[i] > 0)
+				{
+					pool.Push(i, (uint8_t*)slots[i][--count[i]]);
+				}
+			}
+		}
+
+		static uint32_t GetMax(int cls)
+		{
+			return (uint32_t)std::min<size_t>(std::max<size_t>(MAX_BYTES >> (cls + BufferPool::MIN_SHIFT), 2), MAX_BUFFERS);
+		}
+	};
+
+	static thread_local BufferCache t_cache;
+
+	BufferPool::BufferPool()
+		: m_base(NULL)
+		, m_reserved(0)
+		, m_next(0)
+		, m_huge(false)
+		, m_large(0)
+	{
+		for(int i = 0; i < CLASSES; i++)
+		{
+			m_head[i] = 0;
+			m_slabs[i] = 0;
+			m_used[i] = 0;
+			m_free[i] = 0;
+		}
+
+		// address space only, slabs are committed one by one
+
+		size_t size = sizeof(void*) == 8 ? (size_t)64 << 30 : (size_t)256 << 20;
+
+		#ifdef _WIN32
+
+		void* p = VirtualAlloc(NULL, size + SLAB_SIZE, MEM_RESERVE, PAGE_NOACCESS);
+
+		#else
+
+		void* p = mmap(NULL, size + SLAB_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+		if(p == MAP_FAILED) p = NULL;
+
+		#endif
+
+		if(p != NULL)
+		{
+			m_base = (uint8_t*)(((UINT_PTR)p + SLAB_SIZE - 1) & ~(UINT_PTR)(SLAB_SIZE - 1));
+			m_reserved = size;
+			m_class.resize(size / SLAB_SIZE);
+		}
+	}
+
+	BufferPool& BufferPool::Get()
+	{
+		// never destroyed, thread caches may return their buffers at any time during exit
+
+		static BufferPool* pool = new BufferPool();
+
+		return *pool;
+	}
+
+	int BufferPool::GetClass(size_t size)
+	{
+		int cls = 0;
+
+		while(((size_t)1 << (cls + MIN_SHIFT)) < size)
+		{
+			cls++;
+		}
+
+		return cls;
+	}
+
+	void BufferPool::SetHugePages(bool enable)
+	{
+		m_huge = enable;
+	}
+
+	void* BufferPool::Alloc(size_t size)
+	{
+		if(size > ((size_t)1 << MAX_SHIFT) || m_base == NULL)
+		{
+			m_large++;
+
+			return _aligned_malloc(size, 16);
+		}
+
+		int cls = GetClass(size);
+
+		uint32_t& count = t_cache.count[cls];
+		void** cache = t_cache.slots[cls];
+
+		uint8_t* p;
+
+		if(count > 0)
+		{
+			p = (uint8_t*)cache[--count];
+		}
+		else
+		{
+			// refill half of the thread's share, from the shared list or a new slab
+
+			uint32_t max = BufferCache::GetMax(cls);
+
+			while(count < max / 2 - 1 && (p = Pop(cls)) != NULL)
+			{
+				cache[count++] = p;
+			}
+
+			p = count > 0 ? (uint8_t*)cache[--count] : Pop(cls);
+
+			if(p == NULL)
+			{
+				p = Carve(cls, cache, count, max / 2);
+			}
+
+			if(p == NULL)
+			{
+				m_large++;
+
+				return _aligned_malloc(size, 16);
+			}
+		}
+
+		m_used[cls]++;
+
+		return p;
+	}
+
+	void BufferPool::Free(void* p)
+	{
+		if(p == NULL)
+		{
+			return;
+		}
+
+		if(!Contains(p))
+		{
+			m_large--;
+
+			_aligned_free(p);
+
+			return;
+		}
+
+		int cls = m_class[((uint8_t*)p - m_base) / SLAB_SIZE];
+
+		m_used[cls]--;
+
+		uint32_t& count = t_cache.count[cls];
+		void** cache = t_cache.slots[cls];
+
+		uint32_t max = BufferCache::GetMax(cls);
+
+		if(count == max)
+		{
+			while(count > max / 2)
+			{
+				Push(cls, (uint8_t*)cache[--count]);
+			}
+		}
+
+		cache[count++] = p;
+	}
+
+	bool BufferPool::Commit(uint8_t* slab)
+	{
+		#ifdef _WIN32
+
+		return VirtualAlloc(slab, SLAB_SIZE, MEM_COMMIT, PAGE_READWRITE) != NULL;
+
+		#else
+
+		if(mprotect(slab, SLAB_SIZE, PROT_READ | PROT_WRITE) != 0)
+		{
+			return false;
+		}
+
+		#ifdef MADV_HUGEPAGE
+
+		if(m_huge)
+		{
+			madvise(slab, SLAB_SIZE, MADV_HUGEPAGE);
+		}
+
+		#endif
+
+		return true;
+
+		#endif
+	}
+
+	uint8_t* BufferPool::Carve(int cls, void** cache, uint32_t& count, uint32_t max)
+	{
+		// the slab is only taken once it is committed, a failed commit leaves it to the next try,
+		// a thread losing the race to take it has committed it for nothing and moves on to the next one
+
+		size_t index = m_next;
+
+		for(;;)
+		{
+			if(index >= m_class.size() || !Commit(m_base + index * SLAB_SIZE))
+			{
+				return NULL;
+			}
+
+			if(m_next.compare_exchange_weak(index, index + 1))
+			{
+				break;
+			}
+		}
+
+		uint8_t* slab = m_base + index * SLAB_SIZE;
+
+		m_class[index] = (uint8_t)cls;
+
+		m_slabs[cls]++;
+
+		// the first one is returned, some go to the thread, the rest is shared
+
+		size_t size = (size_t)1 << (cls + MIN_SHIFT);
+
+		for(size_t offset = size; offset < SLAB_SIZE; offset += size)
+		{
+			if(count < max)
+			{
+				cache[count++] = slab + offset;
+			}
+			else
+			{
+				Push(cls, slab + offset);
+			}
+		}
+
+		return slab;
+	}
+
+	// a tagged index instead of a pointer keeps the list safe from ABA, a stale next is harmless as slabs stay mapped
+
+	uint8_t* BufferPool::Pop(int cls)
+	{
+		uint64_t head = m_head[cls].load();
+
+		for(;;)
+		{
+			uint32_t index = (uint32_t)head;
+
+			if(index == 0)
+			{
+				return NULL;
+			}
+
+			uint8_t* p = m_base + ((size_t)(index - 1) << MIN_SHIFT);
+
+			uint32_t next = *(volatile uint32_t*)p;
+
+			uint64_t tag = (head >> 32) + 1;
+
+			if(m_head[cls].compare_exchange_weak(head, (tag << 32) | next))
+			{
+				m_free[cls]--;
+
+				return p;
+			}
+		}
+	}
+
+	void BufferPool::Push(int cls, uint8_t* p)
+	{
+		uint32_t index = (uint32_t)(((size_t)(p - m_base) >> MIN_SHIFT) + 1);
+
+		uint64_t head = m_head[cls].load();
+
+		for(;;)
+		{
+			*(volatile uint32_t*)p = (uint32_t)head;
+
+			uint64_t tag = (head >> 32) + 1;
+
+			if(m_head[cls].compare_exchange_weak(head, (tag << 32) | index))
+			{
+				m_free[cls]++;
+
+				return;
+			}
+		}
+	}
+
+	void BufferPool::GetStats(BufferPoolStats stats[CLASSES]) const
+	{
+		for(int i = 0; i < CLASSES; i++)
+		{
+			stats[i].size = (size_t)1 << (i + MIN_SHIFT);
+			stats[i].slabs = m_slabs[i];
+			stats[i].used = (uint64_t)std::max<int64_t>(m_used[i], 0);
+			stats[i].free = (uint64_t)std::max<int64_t>(m_free[i], 0);
+		}
+	}
+}
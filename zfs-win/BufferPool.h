@@ -0,0 +1,82 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+namespace ZFS
+{
+	struct BufferPoolStats
+	{
+		size_t size; // of the buffers in the class
+		uint64_t slabs;
+		uint64_t used; // handed out
+		uint64_t free; // in the shared free list, the rest of the slabs sits in thread caches
+	};
+
+	// power of two buffers from 512 bytes to 1 MB, aligned to their size, carved from 2 MB slabs of one reserved
+	// address range, so a pointer alone tells its class; slabs are never given back, freed buffers are reused
+	//
+	// each thread keeps a few buffers per class, behind that is a lock-free list per class,
+	// larger buffers and anything beyond the reserved range come from _aligned_malloc
+
+	class BufferPool
+	{
+	public:
+		enum {MIN_SHIFT = 9, MAX_SHIFT = 20, CLASSES = MAX_SHIFT - MIN_SHIFT + 1, SLAB_SIZE = 2 << 20};
+
+	private:
+		uint8_t* m_base;
+		size_t m_reserved;
+		std::atomic<size_t> m_next; // first uncommitted slab
+		std::vector<uint8_t> m_class; // of each slab
+		bool m_huge;
+
+		std::atomic<uint64_t> m_head[CLASSES]; // tag << 32 | index of the first free buffer + 1
+		std::atomic<uint64_t> m_slabs[CLASSES];
+		std::atomic<int64_t> m_used[CLASSES];
+		std::atomic<int64_t> m_free[CLASSES];
+		std::atomic<int64_t> m_large;
+
+		static int GetClass(size_t size);
+
+		bool Contains(const void* p) const {return (const uint8_t*)p >= m_base && (const uint8_t*)p < m_base + m_reserved;}
+		bool Commit(uint8_t* slab); // committing it again is harmless
+		uint8_t* Carve(int cls, void** cache, uint32_t& count, uint32_t max);
+		uint8_t* Pop(int cls);
+		void Push(int cls, uint8_t* p);
+
+		friend struct BufferCache;
+
+	public:
+		BufferPool();
+
+		static BufferPool& Get();
+
+		void* Alloc(size_t size);
+		void Free(void* p);
+
+		void SetHugePages(bool enable); // slabs allocated after this are backed by huge pages where the os allows
+		bool GetHugePages() const {return m_huge;}
+
+		void GetStats(BufferPoolStats stats[CLASSES]) const;
+		int64_t GetLargeCount() const {return m_large;} // outstanding buffers not from the slabs
+	};
+}
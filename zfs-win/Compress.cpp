@@ -1,338 +1,543 @@
-/*
- * CDDL HEADER START
- *
- * The contents of this file are subject to the terms of the
- * Common Development and Distribution License (the "License").
- * You may not use this file except in compliance with the License.
- *
- * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
- * or http://www.opensolaris.org/os/licensing.
- * See the License for the specific language governing permissions
- * and limitations under the License.
- *
- * When distributing Covered Code, include this CDDL HEADER in each
- * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
- * If applicable, add the following below this CDDL HEADER, with the
- * fields enclosed by brackets "[]" replaced with your own identifying
- * information: Portions Copyright [yyyy] [name of copyright owner]
- *
- * CDDL HEADER END
- */
-
-/*
- * Copyright (c) 2005, 2010, Oracle and/or its affiliates. All rights reserved.
- */
-
-#include "stdafx.h"
-#include "Compress.h"
-#include "../zlib/zlib.h"
-
-#define NBBY 8
-#define	MATCH_BITS	6
-#define	MATCH_MIN	3
-#define	MATCH_MAX	((1 << MATCH_BITS) + (MATCH_MIN - 1))
-#define	OFFSET_MASK	((1 << (16 - MATCH_BITS)) - 1)
-#define	LEMPEL_SIZE	1024
-
-/*
- * We keep our own copy of this algorithm for 3 main reasons:
- *	1. If we didn't, anyone modifying common/os/compress.c would
- *         directly break our on disk format
- *	2. Our version of lzjb does not have a number of checks that the
- *         common/os version needs and uses
- *	3. We initialize the lempel to ensure deterministic results,
- *	   so that identical blocks can always be deduplicated.
- * In particular, we are adding the "feature" that compress() can
- * take a destination buffer size and returns the compressed length, or the
- * source length if compression would overflow the destination buffer.
- */
-
-size_t lzjb_compress(void* s_start, void* d_start, size_t s_len, size_t d_len, int n)
-{
-	uint8_t* src = (uint8_t*)s_start;
-	uint8_t* dst = (uint8_t*)d_start;
-	uint8_t* cpy;
-	uint8_t* copymap;
-	int copymask = 1 << (NBBY - 1);
-	int mlen, offset, hash;
-	uint16_t* hp;
-	uint16_t lempel[LEMPEL_SIZE] = { 0 };
-
-	while(src < (uint8_t*)s_start + s_len)
-	{
-		if((copymask <<= 1) == (1 << NBBY))
-		{
-			if(dst >= (uint8_t *)d_start + d_len - 1 - 2 * NBBY)
-			{
-				return s_len;
-			}
-
-			copymask = 1;
-			copymap = dst;
-			*dst++ = 0;
-		}
-
-		if(src > (uint8_t*)s_start + s_len - MATCH_MAX)
-		{
-			*dst++ = *src++;
-
-			continue;
-		}
-
-		hash = (src[0] << 16) + (src[1] << 8) + src[2];
-		hash += hash >> 9;
-		hash += hash >> 5;
-		hp = &lempel[hash & (LEMPEL_SIZE - 1)];
-		offset = (intptr_t)(src - *hp) & OFFSET_MASK;
-		*hp = (uint16_t)(uintptr_t)src;
-		cpy = src - offset;
-
-		if(cpy >= (uint8_t *)s_start && cpy != src && src[0] == cpy[0] && src[1] == cpy[1] && src[2] == cpy[2])
-		{
-			*copymap |= copymask;
-
-			for(mlen = MATCH_MIN; mlen < MATCH_MAX; mlen++)
-			{
-				if(src[mlen] != cpy[mlen])
-				{
-					break;
-				}
-			}
-
-			*dst++ = ((mlen - MATCH_MIN) << (NBBY - MATCH_BITS)) | (offset >> NBBY);
-			*dst++ = (uint8_t)offset;
-			src += mlen;
-		}
-		else
-		{
-			*dst++ = *src++;
-		}
-	}
-
-	return dst - (uint8_t*)d_start;
-}
-
-int lzjb_decompress(void* s_start, void* d_start, size_t s_len, size_t d_len)
-{
-	uint8_t* src = (uint8_t*)s_start;
-	uint8_t* dst = (uint8_t*)d_start;
-	uint8_t* d_end = (uint8_t*)d_start + d_len;
-	uint8_t* cpy;
-	uint8_t copymap;
-	int copymask = 1 << (NBBY - 1);
-
-	while(dst < d_end)
-	{
-		if((copymask <<= 1) == (1 << NBBY))
-		{
-			copymask = 1;
-			copymap = *src++;
-		}
-
-		if(copymap & copymask)
-		{
-			int mlen = (src[0] >> (NBBY - MATCH_BITS)) + MATCH_MIN;
-			int offset = ((src[0] << NBBY) | src[1]) & OFFSET_MASK;
-
-			src += 2;
-			
-			if((cpy = dst - offset) < (uint8_t*)d_start)
-			{
-				return -1;
-			}
-
-			while(--mlen >= 0 && dst < d_end)
-			{
-				*dst++ = *cpy++;
-			}
-		}
-		else
-		{
-			*dst++ = *src++;
-		}
-	}
-
-	return 0;
-}
-
-size_t gzip_compress(void* s_start, void* d_start, size_t s_len, size_t d_len, int n)
-{
-	size_t dstlen = d_len;
-
-	ASSERT(d_len <= s_len);
-
-	uLongf len = dstlen;
-
-	if(compress2((Bytef*)d_start, &len, (Bytef*)s_start, s_len, n) != Z_OK)
-	{
-		if(d_len != s_len)
-		{
-			return s_len;
-		}
-
-		memcpy(s_start, d_start, s_len);
-
-		return s_len;
-	}
-
-	dstlen = len;
-
-	return dstlen;
-}
-
-int gzip_decompress(void* s_start, void* d_start, size_t s_len, size_t d_len)
-{
-	size_t dstlen = d_len;
-
-	ASSERT(d_len >= s_len);
-
-	uLongf len = dstlen;
-
-	if(uncompress((Bytef*)d_start, &len, (Bytef*)s_start, s_len) != Z_OK)
-	{
-		return -1;
-	}
-
-	dstlen = len;
-
-	return 0;
-}
-
-/*
- * Zero-length encoding.  This is a fast and simple algorithm to eliminate
- * runs of zeroes.  Each chunk of compressed data begins with a length byte, b.
- * If b < n (where n is the compression parameter) then the next b + 1 bytes
- * are literal values.  If b >= n then the next (256 - b + 1) bytes are zero.
- */
-
-size_t zle_compress(void* s_start, void* d_start, size_t s_len, size_t d_len, int n)
-{
-	uint8_t* src = (uint8_t*)s_start;
-	uint8_t* dst = (uint8_t*)d_start;
-	uint8_t* s_end = src + s_len;
-	uint8_t* d_end = dst + d_len;
-
-	while(src < s_end && dst < d_end - 1)
-	{
-		uint8_t* first = src;
-		uint8_t* len = dst++;
-
-		if(src[0] == 0)
-		{
-			uint8_t* last = src + (256 - n);
-
-			while(src < std::min<uint8_t*>(last, s_end) && src[0] == 0)
-			{
-				src++;
-			}
-
-			*len = src - first - 1 + n;
-		}
-		else
-		{
-			uint8_t* last = src + n;
-			
-			if(d_end - dst < n)
-			{
-				break;
-			}
-
-			while(src < std::min<uint8_t*>(last, s_end) - 1 && (src[0] | src[1]))
-			{
-				*dst++ = *src++;
-			}
-
-			if(src[0])
-			{
-				*dst++ = *src++;
-			}
-
-			*len = src - first - 1;
-		}
-	}
-
-	return src == s_end ? dst - (uint8_t*)d_start : s_len;
-}
-
-int zle_decompress_64(void* s_start, void* d_start, size_t s_len, size_t d_len)
-{
-	const int n = 64;
-
-	uint8_t* src = (uint8_t*)s_start;
-	uint8_t* dst = (uint8_t*)d_start;
-	uint8_t* s_end = src + s_len;
-	uint8_t* d_end = dst + d_len;
-
-	while(src < s_end && dst < d_end)
-	{
-		int len = 1 + *src++;
-
-		if(len <= n)
-		{
-			while(len-- != 0)
-			{
-				*dst++ = *src++;
-			}
-		}
-		else
-		{
-			len -= n;
-		
-			while(len-- != 0)
-			{
-				*dst++ = 0;
-			}
-		}
-	}
-
-	return dst == d_end ? 0 : -1;
-}
-
-int copy_decompress(void* s_start, void* d_start, size_t s_len, size_t d_len)
-{
-	ASSERT(s_len == d_len);
-
-	size_t size = std::min<size_t>(s_len, d_len);
-
-	memcpy(d_start, s_start, size);
-
-	return size;
-}
-
-typedef int (*decompress_func_t)(void* s_start, void* d_start, size_t s_len, size_t d_len);
-
-static decompress_func_t s_decompress_func[] = 
-{
-	NULL, // ZIO_COMPRESS_INHERIT
-	lzjb_decompress, // ZIO_COMPRESS_ON
-	copy_decompress, // ZIO_COMPRESS_OFF
-	lzjb_decompress, // ZIO_COMPRESS_LZJB
-	NULL, // ZIO_COMPRESS_EMPTY
-	gzip_decompress, // ZIO_COMPRESS_GZIP_1
-	gzip_decompress, // ZIO_COMPRESS_GZIP_2
-	gzip_decompress, // ZIO_COMPRESS_GZIP_3
-	gzip_decompress, // ZIO_COMPRESS_GZIP_4
-	gzip_decompress, // ZIO_COMPRESS_GZIP_5
-	gzip_decompress, // ZIO_COMPRESS_GZIP_6
-	gzip_decompress, // ZIO_COMPRESS_GZIP_7
-	gzip_decompress, // ZIO_COMPRESS_GZIP_8
-	gzip_decompress, // ZIO_COMPRESS_GZIP_9
-	zle_decompress_64, // ZIO_COMPRESS_ZLE
-};
-
-bool ZFS::decompress(void* src, void* dst, size_t psize, size_t lsize, uint8_t comp_type)
-{
-	if(comp_type < sizeof(s_decompress_func) / sizeof(s_decompress_func[0]))
-	{
-		decompress_func_t f = s_decompress_func[comp_type];
-
-		if(f != NULL)
-		{
-			f(src, dst, psize, lsize);
-
-			return true;
-		}
-	}
-
-	return false;
-}
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * Copyright (c) 2005, 2010, Oracle and/or its affiliates. All rights reserved.
+ */
+
+#include "stdafx.h"
+#include "Compress.h"
+#include "Kernel.h"
+#include "../zlib/zlib.h"
+
+#define NBBY 8
+#define	MATCH_BITS	6
+#define	MATCH_MIN	3
+#define	MATCH_MAX	((1 << MATCH_BITS) + (MATCH_MIN - 1))
+#define	OFFSET_MASK	((1 << (16 - MATCH_BITS)) - 1)
+#define	LEMPEL_SIZE	1024
+
+/*
+ * We keep our own copy of this algorithm for 3 main reasons:
+ *	1. If we didn't, anyone modifying common/os/compress.c would
+ *         directly break our on disk format
+ *	2. Our version of lzjb does not have a number of checks that the
+ *         common/os version needs and uses
+ *	3. We initialize the lempel to ensure deterministic results,
+ *	   so that identical blocks can always be deduplicated.
+ * In particular, we are adding the "feature" that compress() can
+ * take a destination buffer size and returns the compressed length, or the
+ * source length if compression would overflow the destination buffer.
+ */
+
+size_t lzjb_compress(void* s_start, void* d_start, size_t s_len, size_t d_len, int n)
+{
+	uint8_t* src = (uint8_t*)s_start;
+	uint8_t* dst = (uint8_t*)d_start;
+	uint8_t* cpy;
+	uint8_t* copymap;
+	int copymask = 1 << (NBBY - 1);
+	int mlen, offset, hash;
+	uint16_t* hp;
+	uint16_t lempel[LEMPEL_SIZE] = { 0 };
+
+	while(src < (uint8_t*)s_start + s_len)
+	{
+		if((copymask <<= 1) == (1 << NBBY))
+		{
+			if(dst >= (uint8_t *)d_start + d_len - 1 - 2 * NBBY)
+			{
+				return s_len;
+			}
+
+			copymask = 1;
+			copymap = dst;
+			*dst++ = 0;
+		}
+
+		if(src > (uint8_t*)s_start + s_len - MATCH_MAX)
+		{
+			*dst++ = *src++;
+
+			continue;
+		}
+
+		hash = (src[0] << 16) + (src[1] << 8) + src[2];
+		hash += hash >> 9;
+		hash += hash >> 5;
+		hp = &lempel[hash & (LEMPEL_SIZE - 1)];
+		offset = (intptr_t)(src - *hp) & OFFSET_MASK;
+		*hp = (uint16_t)(uintptr_t)src;
+		cpy = src - offset;
+
+		if(cpy >= (uint8_t *)s_start && cpy != src && src[0] == cpy[0] && src[1] == cpy[1] && src[2] == cpy[2])
+		{
+			*copymap |= copymask;
+
+			for(mlen = MATCH_MIN; mlen < MATCH_MAX; mlen++)
+			{
+				if(src[mlen] != cpy[mlen])
+				{
+					break;
+				}
+			}
+
+			*dst++ = ((mlen - MATCH_MIN) << (NBBY - MATCH_BITS)) | (offset >> NBBY);
+			*dst++ = (uint8_t)offset;
+			src += mlen;
+		}
+		else
+		{
+			*dst++ = *src++;
+		}
+	}
+
+	return dst - (uint8_t*)d_start;
+}
+
+int lzjb_decompress(void* s_start, void* d_start, size_t s_len, size_t d_len)
+{
+	uint8_t* src = (uint8_t*)s_start;
+	uint8_t* dst = (uint8_t*)d_start;
+	uint8_t* d_end = (uint8_t*)d_start + d_len;
+	uint8_t* cpy;
+	uint8_t copymap;
+	int copymask = 1 << (NBBY - 1);
+
+	while(dst < d_end)
+	{
+		if((copymask <<= 1) == (1 << NBBY))
+		{
+			copymask = 1;
+			copymap = *src++;
+		}
+
+		if(copymap & copymask)
+		{
+			int mlen = (src[0] >> (NBBY - MATCH_BITS)) + MATCH_MIN;
+			int offset = ((src[0] << NBBY) | src[1]) & OFFSET_MASK;
+
+			src += 2;
+			
+			if((cpy = dst - offset) < (uint8_t*)d_start)
+			{
+				return -1;
+			}
+
+			while(--mlen >= 0 && dst < d_end)
+			{
+				*dst++ = *cpy++;
+			}
+		}
+		else
+		{
+			*dst++ = *src++;
+		}
+	}
+
+	return 0;
+}
+
+int lzjb_decompress_wide(void* s_start, void* d_start, size_t s_len, size_t d_len)
+{
+	// the same, but eight literals in a row and matches at least a word back are copied a word at a time,
+	// that overshoots the match by up to seven bytes, so only where there is room left for it
+
+	uint8_t* src = (uint8_t*)s_start;
+	uint8_t* dst = (uint8_t*)d_start;
+	uint8_t* d_end = (uint8_t*)d_start + d_len;
+	uint8_t* cpy;
+	uint8_t copymap;
+	int copymask = 1 << (NBBY - 1);
+
+	while(dst < d_end)
+	{
+		if((copymask <<= 1) == (1 << NBBY))
+		{
+			copymask = 1;
+			copymap = *src++;
+
+			if(copymap == 0 && d_end - dst >= NBBY)
+			{
+				memcpy(dst, src, NBBY);
+
+				dst += NBBY;
+				src += NBBY;
+
+				copymask = 1 << (NBBY - 1);
+
+				continue;
+			}
+		}
+
+		if(copymap & copymask)
+		{
+			int mlen = (src[0] >> (NBBY - MATCH_BITS)) + MATCH_MIN;
+			int offset = ((src[0] << NBBY) | src[1]) & OFFSET_MASK;
+
+			src += 2;
+			
+			if((cpy = dst - offset) < (uint8_t*)d_start)
+			{
+				return -1;
+			}
+
+			if(offset >= 8 && d_end - dst >= mlen + 7)
+			{
+				uint8_t* end = dst + mlen;
+
+				do
+				{
+					memcpy(dst, cpy, 8);
+
+					dst += 8;
+					cpy += 8;
+				}
+				while(dst < end);
+
+				dst = end;
+			}
+			else
+			{
+				while(--mlen >= 0 && dst < d_end)
+				{
+					*dst++ = *cpy++;
+				}
+			}
+		}
+		else
+		{
+			*dst++ = *src++;
+		}
+	}
+
+	return 0;
+}
+
+size_t gzip_compress(void* s_start, void* d_start, size_t s_len, size_t d_len, int n)
+{
+	size_t dstlen = d_len;
+
+	ASSERT(d_len <= s_len);
+
+	uLongf len = dstlen;
+
+	if(compress2((Bytef*)d_start, &len, (Bytef*)s_start, s_len, n) != Z_OK)
+	{
+		if(d_len != s_len)
+		{
+			return s_len;
+		}
+
+		memcpy(s_start, d_start, s_len);
+
+		return s_len;
+	}
+
+	dstlen = len;
+
+	return dstlen;
+}
+
+int gzip_decompress(void* s_start, void* d_start, size_t s_len, size_t d_len)
+{
+	size_t dstlen = d_len;
+
+	ASSERT(d_len >= s_len);
+
+	uLongf len = dstlen;
+
+	if(uncompress((Bytef*)d_start, &len, (Bytef*)s_start, s_len) != Z_OK)
+	{
+		return -1;
+	}
+
+	dstlen = len;
+
+	return 0;
+}
+
+/*
+ * Zero-length encoding.  This is a fast and simple algorithm to eliminate
+ * runs of zeroes.  Each chunk of compressed data begins with a length byte, b.
+ * If b < n (where n is the compression parameter) then the next b + 1 bytes
+ * are literal values.  If b >= n then the next (256 - b + 1) bytes are zero.
+ */
+
+size_t zle_compress(void* s_start, void* d_start, size_t s_len, size_t d_len, int n)
+{
+	uint8_t* src = (uint8_t*)s_start;
+	uint8_t* dst = (uint8_t*)d_start;
+	uint8_t* s_end = src + s_len;
+	uint8_t* d_end = dst + d_len;
+
+	while(src < s_end && dst < d_end - 1)
+	{
+		uint8_t* first = src;
+		uint8_t* len = dst++;
+
+		if(src[0] == 0)
+		{
+			uint8_t* last = src + (256 - n);
+
+			while(src < std::min<uint8_t*>(last, s_end) && src[0] == 0)
+			{
+				src++;
+			}
+
+			*len = src - first - 1 + n;
+		}
+		else
+		{
+			uint8_t* last = src + n;
+			
+			if(d_end - dst < n)
+			{
+				break;
+			}
+
+			while(src < std::min<uint8_t*>(last, s_end) - 1 && (src[0] | src[1]))
+			{
+				*dst++ = *src++;
+			}
+
+			if(src[0])
+			{
+				*dst++ = *src++;
+			}
+
+			*len = src - first - 1;
+		}
+	}
+
+	return src == s_end ? dst - (uint8_t*)d_start : s_len;
+}
+
+int zle_decompress_64(void* s_start, void* d_start, size_t s_len, size_t d_len)
+{
+	const int n = 64;
+
+	uint8_t* src = (uint8_t*)s_start;
+	uint8_t* dst = (uint8_t*)d_start;
+	uint8_t* s_end = src + s_len;
+	uint8_t* d_end = dst + d_len;
+
+	while(src < s_end && dst < d_end)
+	{
+		int len = 1 + *src++;
+
+		if(len <= n)
+		{
+			while(len-- != 0)
+			{
+				*dst++ = *src++;
+			}
+		}
+		else
+		{
+			len -= n;
+		
+			while(len-- != 0)
+			{
+				*dst++ = 0;
+			}
+		}
+	}
+
+	return dst == d_end ? 0 : -1;
+}
+
+int zle_decompress_64_wide(void* s_start, void* d_start, size_t s_len, size_t d_len)
+{
+	// whole runs at once, a run that does not fit is an error instead of writing past the end
+
+	const size_t n = 64;
+
+	uint8_t* src = (uint8_t*)s_start;
+	uint8_t* dst = (uint8_t*)d_start;
+	uint8_t* s_end = src + s_len;
+	uint8_t* d_end = dst + d_len;
+
+	while(src < s_end && dst < d_end)
+	{
+		size_t len = 1 + *src++;
+
+		if(len <= n)
+		{
+			if(len > (size_t)(d_end - dst) || len > (size_t)(s_end - src))
+			{
+				return -1;
+			}
+
+			memcpy(dst, src, len);
+
+			src += len;
+		}
+		else
+		{
+			len -= n;
+
+			if(len > (size_t)(d_end - dst))
+			{
+				return -1;
+			}
+
+			memset(dst, 0, len);
+		}
+
+		dst += len;
+	}
+
+	return dst == d_end ? 0 : -1;
+}
+
+int copy_decompress(void* s_start, void* d_start, size_t s_len, size_t d_len)
+{
+	ASSERT(s_len == d_len);
+
+	size_t size = std::min<size_t>(s_len, d_len);
+
+	memcpy(d_start, s_start, size);
+
+	return size;
+}
+
+typedef int (*decompress_func_t)(void* s_start, void* d_start, size_t s_len, size_t d_len);
+typedef size_t (*compress_func_t)(void* s_start, void* d_start, size_t s_len, size_t d_len, int n);
+
+class DecompressKernel : public ZFS::Kernel
+{
+	compress_func_t m_compress;
+	int m_level;
+	std::vector<uint8_t> m_src;
+
+	void Prepare()
+	{
+		const std::vector<uint8_t>& data = GetTestData();
+
+		m_src.resize(data.size());
+
+		size_t psize = m_compress((void*)data.data(), m_src.data(), data.size(), m_src.size(), m_level);
+
+		m_src.resize(psize);
+	}
+
+	size_t Run(size_t index, std::vector<uint8_t>& out)
+	{
+		size_t lsize = GetTestData().size();
+
+		out.resize(lsize);
+
+		m_funcs[index](m_src.data(), out.data(), m_src.size(), lsize);
+
+		return lsize;
+	}
+
+	void Release()
+	{
+		std::vector<uint8_t>().swap(m_src);
+	}
+
+public:
+	std::vector<decompress_func_t> m_funcs;
+
+	DecompressKernel(const char* name, compress_func_t compress, int level)
+		: ZFS::Kernel(name)
+		, m_compress(compress)
+		, m_level(level)
+	{
+	}
+
+	void Add(const char* name, decompress_func_t func)
+	{
+		Kernel::Add(name);
+
+		m_funcs.push_back(func);
+	}
+};
+
+static struct decompress_kernel_struct
+{
+	DecompressKernel lzjb;
+	DecompressKernel zle;
+
+	decompress_kernel_struct()
+		: lzjb("lzjb", lzjb_compress, 0)
+		, zle("zle", zle_compress, 64)
+	{
+		lzjb.Add("bytewise", lzjb_decompress);
+		lzjb.Add("wide", lzjb_decompress_wide);
+
+		zle.Add("bytewise", zle_decompress_64);
+		zle.Add("wide", zle_decompress_64_wide);
+	}
+
+} s_decompress_kernel;
+
+int lzjb_decompress_selected(void* s_start, void* d_start, size_t s_len, size_t d_len)
+{
+	DecompressKernel& k = s_decompress_kernel.lzjb;
+
+	return k.m_funcs[k.Get()](s_start, d_start, s_len, d_len);
+}
+
+int zle_decompress_selected(void* s_start, void* d_start, size_t s_len, size_t d_len)
+{
+	DecompressKernel& k = s_decompress_kernel.zle;
+
+	return k.m_funcs[k.Get()](s_start, d_start, s_len, d_len);
+}
+
+static decompress_func_t s_decompress_func[] = 
+{
+	NULL, // ZIO_COMPRESS_INHERIT
+	lzjb_decompress_selected, // ZIO_COMPRESS_ON
+	copy_decompress, // ZIO_COMPRESS_OFF
+	lzjb_decompress_selected, // ZIO_COMPRESS_LZJB
+	NULL, // ZIO_COMPRESS_EMPTY
+	gzip_decompress, // ZIO_COMPRESS_GZIP_1
+	gzip_decompress, // ZIO_COMPRESS_GZIP_2
+	gzip_decompress, // ZIO_COMPRESS_GZIP_3
+	gzip_decompress, // ZIO_COMPRESS_GZIP_4
+	gzip_decompress, // ZIO_COMPRESS_GZIP_5
+	gzip_decompress, // ZIO_COMPRESS_GZIP_6
+	gzip_decompress, // ZIO_COMPRESS_GZIP_7
+	gzip_decompress, // ZIO_COMPRESS_GZIP_8
+	gzip_decompress, // ZIO_COMPRESS_GZIP_9
+	zle_decompress_selected, // ZIO_COMPRESS_ZLE
+};
+
+bool ZFS::decompress(void* src, void* dst, size_t psize, size_t lsize, uint8_t comp_type)
+{
+	if(comp_type < sizeof(s_decompress_func) / sizeof(s_decompress_func[0]))
+	{
+		decompress_func_t f = s_decompress_func[comp_type];
+
+		if(f != NULL)
+		{
+			f(src, dst, psize, lsize);
+
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,106 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "Cpu.h"
+
+static uint64_t xgetbv(uint32_t index)
+{
+	#ifdef _MSC_VER
+
+	return _xgetbv(index);
+
+	#else
+
+	uint32_t lo, hi;
+
+	__asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(index));
+
+	return ((uint64_t)hi << 32) | lo;
+
+	#endif
+}
+
+namespace ZFS
+{
+	Cpu::Cpu()
+		: sse2(false)
+		, ssse3(false)
+		, sse41(false)
+		, avx(false)
+		, avx2(false)
+		, avx512f(false)
+		, avx512bw(false)
+		, sha(false)
+	{
+		int buff[4];
+
+		__cpuid(buff, 0);
+
+		int levels = buff[0];
+
+		if(levels < 1)
+		{
+			return;
+		}
+
+		__cpuid(buff, 1);
+
+		sse2 = (buff[3] & (1 << 26)) != 0;
+		ssse3 = (buff[2] & (1 << 9)) != 0;
+		sse41 = (buff[2] & (1 << 19)) != 0;
+
+		// the os has to save the ymm/zmm registers too
+
+		bool osxsave = (buff[2] & (1 << 27)) != 0;
+		bool ymm = false;
+		bool zmm = false;
+
+		if(osxsave)
+		{
+			uint64_t xcr0 = xgetbv(0);
+
+			ymm = (xcr0 & 0x06) == 0x06;
+			zmm = (xcr0 & 0xe6) == 0xe6;
+		}
+
+		avx = ymm && (buff[2] & (1 << 28)) != 0;
+
+		if(levels >= 7)
+		{
+			__cpuidex(buff, 7, 0);
+
+			avx2 = avx && (buff[1] & (1 << 5)) != 0;
+			avx512f = zmm && (buff[1] & (1 << 16)) != 0;
+			avx512bw = avx512f && (buff[1] & (1 << 30)) != 0;
+			sha = (buff[1] & (1 << 29)) != 0;
+		}
+	}
+
+	const Cpu& Cpu::Get()
+	{
+		// constructed on first use, static initializers of other files may get here first
+
+		static Cpu s_cpu;
+
+		return s_cpu;
+	}
+}
@@ -0,0 +1,44 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+namespace ZFS
+{
+	// instruction set extensions usable by the process (cpu and os support both checked)
+
+	class Cpu
+	{
+	public:
+		bool sse2;
+		bool ssse3;
+		bool sse41;
+		bool avx;
+		bool avx2;
+		bool avx512f;
+		bool avx512bw;
+		bool sha;
+
+		Cpu();
+
+		static const Cpu& Get();
+	};
+}
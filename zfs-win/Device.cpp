@@ -1,413 +1,1799 @@
-/* 
- *	Copyright (C) 2010 Gabest
- *	http://code.google.com/p/zfs-win/
- *
- *  This Program is free software; you can redistribute it and/or modify
- *  it under the terms of the GNU General Public License as published by
- *  the Free Software Foundation; either version 2, or (at your option)
- *  any later version.
- *   
- *  This Program is distributed in the hope that it will be useful,
- *  but WITHOUT ANY WARRANTY; without even the implied warranty of
- *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
- *  GNU General Public License for more details.
- *   
- *  You should have received a copy of the GNU General Public License
- *  along with GNU Make; see the file COPYING.  If not, write to
- *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
- *  http://www.gnu.org/copyleft/gpl.html
- *
- */
-
-#include "stdafx.h"
-#include "Device.h"
-#include "Hash.h"
-
-namespace ZFS
-{
-	// VirtualDevice
-
-	void VirtualDevice::Init(NameValueList* nvl)
-	{
-		dev = NULL;
-		type = nvl->at("type")->str[0];
-		id = nvl->at("id")->u64[0];
-		guid = nvl->at("guid")->u64[0];
-		metaslab_array = nvl->find("metaslab_array") != nvl->end() ? nvl->at("metaslab_array")->u64[0] : 0;
-		metaslab_shift = nvl->find("metaslab_shift") != nvl->end() ? nvl->at("metaslab_shift")->u64[0] : 0;
-		ashift = nvl->find("ashift") != nvl->end() ? nvl->at("ashift")->u64[0] : 0;
-		asize = nvl->find("asize") != nvl->end() ? nvl->at("asize")->u64[0] : 0;
-		if(nvl->find("path") != nvl->end()) path = nvl->at("path")->str[0];
-		if(nvl->find("devid") != nvl->end()) devid = nvl->at("devid")->str[0];
-		nparity = nvl->find("nparity") != nvl->end() ? nvl->at("nparity")->u64[0] : 0;
-		whole_disk = nvl->find("whole_disk") != nvl->end() ? nvl->at("whole_disk")->u64[0] : 0;
-		is_log = nvl->find("is_log") != nvl->end() ? nvl->at("is_log")->u64[0] : 0;
-
-		if(nvl->find("children") != nvl->end())
-		{
-			NameValuePair* nvp = nvl->at("children");
-
-			children.resize(nvp->count);
-
-			for(uint32_t i = 0; i < nvp->count; i++)
-			{
-				children[i].Init(&nvp->list[i]);
-			}
-		}
-	}
-
-	bool VirtualDevice::Read(uint8_t* buff, size_t size, uint64_t offset)
-	{
-		// TODO: handle chksum errors
-		// TODO: read recursively to allow nested vdevs
-
-		if(type == "disk" || type == "file")
-		{
-			if(dev != NULL)
-			{
-				if(dev->Read(buff, size, offset + 0x400000) == size)
-				{
-					return true;
-				}
-			}
-		}
-		else if(type == "mirror")
-		{
-			for(auto i = children.begin(); i != children.end(); i++)
-			{
-				VirtualDevice& vdev = *i;
-
-				if(vdev.dev != NULL)
-				{
-					if(vdev.dev->Read(buff, size, offset + 0x400000) == size)
-					{
-						return true;
-					}
-				}
-			}
-		}
-		else if(type == "raidz")
-		{
-			raidz_map_t rm(offset, size, (uint32_t)ashift, children.size(), (uint32_t)nparity);
-
-			uint64_t total = 0;
-
-			for(size_t i = 1; i < rm.m_col.size(); i++)
-			{
-				total += rm.m_col[i].size;
-			}
-
-			if(total > size)
-			{
-				return false;
-			}
-
-			uint8_t* p = buff;
-
-			for(size_t i = 1; i < rm.m_col.size(); i++) // TODO: nparity > 1
-			{
-				VirtualDevice& vdev = children[(size_t)rm.m_col[i].devidx];
-
-				if(vdev.dev != NULL)
-				{
-					vdev.dev->BeginRead(p, rm.m_col[i].size, rm.m_col[i].offset + 0x400000);
-				}
-
-				p += rm.m_col[i].size;
-			}
-
-			size_t succeeded = 1;
-
-			for(size_t i = 1; i < rm.m_col.size(); i++) // TODO: nparity > 1
-			{
-				VirtualDevice& vdev = children[(size_t)rm.m_col[i].devidx];
-
-				if(vdev.dev != NULL)
-				{
-					if(vdev.dev->EndRead() == rm.m_col[i].size)
-					{
-						succeeded++;
-					}
-				}
-			}
-
-			if(succeeded < rm.m_col.size())
-			{
-				// TODO: reconstruct data
-
-				return false;
-			}
-
-			return true;
-		}
-		else 
-		{
-			ASSERT(0);
-		}
-
-		return false;
-	}
-
-	VirtualDevice* VirtualDevice::Find(uint64_t guid_to_find)
-	{
-		if(guid == guid_to_find)
-		{
-			return this;
-		}
-
-		for(auto i = children.begin(); i != children.end(); i++)
-		{
-			VirtualDevice* vdev = i->Find(guid_to_find);
-
-			if(vdev != NULL)
-			{
-				return vdev;
-			}
-		}
-
-		return NULL;
-	}
-
-	void VirtualDevice::GetLeaves(std::list<VirtualDevice*>& leaves)
-	{
-		if(children.empty())
-		{
-			leaves.push_back(this);
-		}
-		else
-		{
-			for(auto i = children.begin(); i != children.end(); i++)
-			{
-				i->GetLeaves(leaves);
-			}
-		}
-	}
-
-	// Device
-
-	Device::Device()
-		: m_handle(NULL)
-		, m_start(0)
-		, m_size(0)
-		, m_bytes(0)
-		, m_label(NULL)
-		, m_active(NULL)
-	{
-		memset(&m_overlapped, 0, sizeof(m_overlapped));
-
-		m_overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);  
-	}
-
-	Device::~Device()
-	{
-		Close();
-
-		CloseHandle(m_overlapped.hEvent); 
-	}
-
-	bool Device::Open(const wchar_t* path, uint32_t partition)
-	{
-		Close();
-
-		m_handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED, (HANDLE)NULL);
-
-		if(m_handle == INVALID_HANDLE_VALUE)
-		{
-			wprintf(L"Cannot open device %s\n", path);
-
-			m_handle = NULL;
-
-			return false;
-		}
-
-		if(!GetFileSizeEx(m_handle, (LARGE_INTEGER*)&m_size))
-		{
-			DISK_GEOMETRY_EX dg;
-			DWORD sz;
-		
-			if(DeviceIoControl(m_handle, IOCTL_DISK_GET_DRIVE_GEOMETRY_EX, NULL, 0, &dg, sizeof(dg), &sz, NULL))
-			{
-				m_size = dg.DiskSize.QuadPart;
-			}
-		}
-
-		if(wcsstr(path, L".vdi") != NULL)
-		{
-			m_start += 0x2000;
-			m_size -= 0x2000;
-		}
-		else
-
-		for(int i = 0; i < 2; i++, partition >>= 8)
-		{
-			uint8_t mbr[0x200];
-
-			Read(mbr, sizeof(mbr), 0);
-
-			if(mbr[0x1fe] == 0x55 || mbr[0x1ff] == 0xaa)
-			{
-				uint8_t* ptr = &mbr[0x1be];
-
-				for(int i = 0; i < 4; i++)
-				{
-					if((partition & 0xff) == i)
-					{
-						uint64_t start = *(uint32_t*)&ptr[i * 16 + 8];
-						uint64_t size = *(uint32_t*)&ptr[i * 16 + 12];
-
-						if(start != 0 && size != 0)
-						{
-							m_start += start << 9;
-							m_size = size << 9;
-						}
-
-						break;
-					}
-				}
-			}
-		}
-
-		m_label = new vdev_label_t();
-
-		Read(m_label, sizeof(vdev_label_t), 0);
-
-		if(m_label->vdev_phys.zbt.magic != ZEC_MAGIC)
-		{
-			return false;
-		}
-
-		// TODO: verify m_label->vdev_phys.zbt.chksum (but which part of m_label does it hash ???)
-
-		if(!m_desc.Init(m_label->vdev_phys))
-		{
-			return false;
-		}
-
-		for(size_t i = 0; i < sizeof(m_label->uberblock); i += m_desc.ub_size)
-		{
-			uberblock_t* ub = (uberblock_t*)&m_label->uberblock[i];
-
-			if(ub->magic == BSWAP_64(UBERBLOCK_MAGIC))
-			{
-				// TODO: be <-> le
-			}
-
-			if(ub->magic != UBERBLOCK_MAGIC)
-			{
-				continue;
-			}
-
-			zio_eck_t* eck = (zio_eck_t*)&m_label->uberblock[i + m_desc.ub_size] - 1;
-/*
-
-extern void UnixTimeToSystemTime(uint64_t t, SYSTEMTIME* st);
-
-SYSTEMTIME st;
-UnixTimeToSystemTime(ub->timestamp, &st);
-
-printf("%d %I64d (%d-%02d-%02d %d:%02d:%02d)\n", 
-	i / m_desc.ub_size, ub->txg, 
-	st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond); 
-*/
-			if(m_active == NULL || ub->txg > m_active->txg)
-			{
-				m_active = ub;
-			}
-		}
-
-		return m_active != NULL;
-	}
-
-	void Device::Close()
-	{
-		if(m_handle != NULL)
-		{
-			CancelIo(m_handle);
-
-			CloseHandle(m_handle);
-
-			m_handle = NULL;
-		}
-
-		if(m_label != NULL)
-		{
-			delete m_label;
-
-			m_label = NULL;
-		}
-
-		m_start = 0;
-		m_size = 0;
-		m_bytes = 0;
-
-		m_active = NULL;
-	}
-
-	size_t Device::Read(void* buff, size_t size, uint64_t offset)
-	{
-		return BeginRead(buff, size, offset) ? EndRead() : 0;
-	}
-
-	bool Device::BeginRead(void* buff, size_t size, uint64_t offset)
-	{
-		offset += m_start;
-
-		m_overlapped.Offset = (DWORD)offset;
-		m_overlapped.OffsetHigh = (DWORD)(offset >> 32);
-
-		if(!ReadFile(m_handle, buff, size, NULL, &m_overlapped))
-		{
-			switch(GetLastError())
-			{
-			case ERROR_IO_PENDING:
-				break;
-			case ERROR_HANDLE_EOF:
-				return false;
-			}
-		}
-
-		return true;
-	}
-
-	size_t Device::EndRead()
-	{
-		DWORD size;
-
-		if(GetOverlappedResult(m_handle, &m_overlapped, &size, TRUE))
-		{
-			return (size_t)size;
-		}
-
-		return 0;
- 	}
-
-	// DeviceDesc
-
-	bool DeviceDesc::Init(vdev_phys_t& vd)
-	{
-		NameValueList nvl;
-
-		nvl.Init(vd.nvlist, sizeof(vd.nvlist));
-
-		try
-		{
-			guid = nvl.at("guid")->u64[0];
-			top_guid = nvl.at("top_guid")->u64[0];
-			state = nvl.at("state")->u64[0];
-			host.id = nvl.at("hostid")->u64[0];
-			host.name = nvl.at("hostname")->str[0];
-			pool.guid = nvl.at("pool_guid")->u64[0];
-			pool.name = nvl.at("name")->str[0];
-			txg = nvl.at("txg")->u64[0];
-			version = nvl.at("version")->u64[0];
-			top.Init(nvl.at("vdev_tree")->list);
-			ub_size = 1 << std::max<size_t>((size_t)top.ashift, UBERBLOCK_SHIFT);
-		}
-		catch(...)
-		{
-			return false;
-		}
-
-		return true;
-	}
-}
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "Device.h"
+#include "Hash.h"
+#include "Raidz.h"
+
+namespace ZFS
+{
+	// VirtualDevice
+
+	void VirtualDevice::Init(NameValueList* nvl)
+	{
+		dev = NULL;
+		type = nvl->at("type")->str[0];
+		id = nvl->at("id")->u64[0];
+		guid = nvl->at("guid")->u64[0];
+		metaslab_array = nvl->find("metaslab_array") != nvl->end() ? nvl->at("metaslab_array")->u64[0] : 0;
+		metaslab_shift = nvl->find("metaslab_shift") != nvl->end() ? nvl->at("metaslab_shift")->u64[0] : 0;
+		ashift = nvl->find("ashift") != nvl->end() ? nvl->at("ashift")->u64[0] : 0;
+		asize = nvl->find("asize") != nvl->end() ? nvl->at("asize")->u64[0] : 0;
+		if(nvl->find("path") != nvl->end()) path = nvl->at("path")->str[0];
+		if(nvl->find("devid") != nvl->end()) devid = nvl->at("devid")->str[0];
+		nparity = nvl->find("nparity") != nvl->end() ? nvl->at("nparity")->u64[0] : 0;
+		whole_disk = nvl->find("whole_disk") != nvl->end() ? nvl->at("whole_disk")->u64[0] : 0;
+		is_log = nvl->find("is_log") != nvl->end() ? nvl->at("is_log")->u64[0] : 0;
+		policy = MIRROR_LEAST_OUTSTANDING;
+		rotor = 0;
+
+		if(nvl->find("children") != nvl->end())
+		{
+			NameValuePair* nvp = nvl->at("children");
+
+			children.resize(nvp->count);
+
+			for(uint32_t i = 0; i < nvp->count; i++)
+			{
+				children[i].Init(&nvp->list[i]);
+			}
+		}
+
+		if(type == "raidz" && !children.empty())
+		{
+			geometry = std::make_shared<RaidzGeometry>((uint32_t)ashift, (uint32_t)children.size(), (uint32_t)nparity);
+		}
+	}
+
+	bool VirtualDevice::Read(uint8_t* buff, size_t size, uint64_t offset, const Verifier& verify)
+	{
+		// TODO: read recursively to allow nested vdevs
+
+		if(type == "mirror")
+		{
+			// the selected child first, then the rest in order, children known to be bad there only as a last resort,
+			// a child returning data that does not verify is passed over like one that cannot be read
+
+			VirtualDevice* first = Select(offset, size);
+
+			if(first == NULL)
+			{
+				return false;
+			}
+
+			size_t index = first - children.data();
+
+			std::vector<VirtualDevice*> passed; // bad ones, only skipped if they are not needed in the end
+
+			for(int pass = 0; pass < 2; pass++)
+			{
+				for(size_t i = 0; i < children.size(); i++)
+				{
+					VirtualDevice& vdev = children[(index + i) % children.size()];
+
+					if(vdev.dev == NULL)
+					{
+						continue;
+					}
+
+					if(vdev.IsBad(offset, size) == (pass > 0))
+					{
+						if(vdev.dev->Read(buff, size, offset + 0x400000) == size && vdev.Check(buff, size, offset, verify))
+						{
+							for(auto j = passed.begin(); j != passed.end(); j++)
+							{
+								(*j)->dev->m_bad.Skip();
+							}
+
+							return true;
+						}
+					}
+					else if(pass == 0)
+					{
+						passed.push_back(&vdev);
+					}
+				}
+
+				passed.clear();
+			}
+
+			return false;
+		}
+		else if(type == "raidz")
+		{
+			if(!ReadRaidz(buff, size, offset))
+			{
+				return false;
+			}
+
+			return verify == nullptr || verify(buff, size) || ReconstructRaidz(buff, size, offset, verify);
+		}
+
+		IoBatch batch;
+
+		if(!Queue(batch, buff, size, offset))
+		{
+			return false;
+		}
+
+		batch.Execute();
+
+		return batch.Succeeded(0, batch.GetCount()) && Check(buff, size, offset, verify);
+	}
+
+	bool VirtualDevice::Check(const uint8_t* buff, size_t size, uint64_t offset, const Verifier& verify)
+	{
+		if(verify == nullptr)
+		{
+			return true;
+		}
+
+		if(!verify(buff, size))
+		{
+			printf("cksum error (vdev=%lld guid=%016llx offset=%lld)\n", (long long)id, (unsigned long long)guid, (long long)offset);
+
+			MarkBad(offset, size);
+
+			return false;
+		}
+
+		MarkGood(offset, size);
+
+		return true;
+	}
+
+	const raidz_map_t* VirtualDevice::GetRaidzMap(uint64_t offset, size_t size, uint64_t& row, raidz_map_t& tmp)
+	{
+		// column offsets are relative to row
+
+		if(geometry != NULL)
+		{
+			return geometry->Get(offset, (uint32_t)size, row, tmp);
+		}
+
+		tmp.Init(offset, (uint32_t)size, (uint32_t)ashift, children.size(), (uint32_t)nparity);
+
+		row = 0;
+
+		return &tmp;
+	}
+
+	bool VirtualDevice::ReadRaidz(uint8_t* buff, size_t size, uint64_t offset)
+	{
+		// the columns are whole sectors, a block not ending on one is read padded
+
+		size_t padded = roundup(size, (size_t)1 << ashift);
+
+		if(padded != size)
+		{
+			uint8_t* tmp = (uint8_t*)DeviceBackend::AllocBuffer(padded);
+
+			bool ok = ReadRaidz(tmp, padded, offset);
+
+			if(ok)
+			{
+				memcpy(buff, tmp, size);
+			}
+
+			DeviceBackend::FreeBuffer(tmp);
+
+			return ok;
+		}
+
+		raidz_map_t tmp;
+		uint64_t row;
+
+		const raidz_map_t& rm = *GetRaidzMap(offset, size, row, tmp);
+
+		std::vector<uint8_t*> cols(rm.m_cols, (uint8_t*)NULL);
+		std::vector<size_t> index(rm.m_cols, (size_t)-1);
+
+		uint8_t* p = buff;
+
+		for(uint32_t c = rm.m_firstdatacol; c < rm.m_cols; c++)
+		{
+			cols[c] = p;
+
+			p += rm.m_col[c].size;
+		}
+
+		if(p > buff + size)
+		{
+			return false;
+		}
+
+		// columns on regions known to be bad are not read if parity can make up for them
+
+		std::vector<bool> skip(rm.m_cols, false);
+
+		uint32_t skipped = 0;
+
+		for(uint32_t c = 0; c < rm.m_cols; c++)
+		{
+			VirtualDevice& vdev = children[(size_t)rm.m_col[c].devidx];
+
+			if(vdev.dev == NULL || vdev.IsBad(row + rm.m_col[c].offset, rm.m_col[c].size))
+			{
+				skip[c] = vdev.dev != NULL;
+				skipped++;
+			}
+		}
+
+		if(skipped > rm.m_firstdatacol)
+		{
+			skip.assign(rm.m_cols, false);
+		}
+
+		IoBatch batch;
+
+		for(uint32_t c = rm.m_firstdatacol; c < rm.m_cols; c++)
+		{
+			VirtualDevice& vdev = children[(size_t)rm.m_col[c].devidx];
+
+			if(vdev.dev != NULL && !skip[c])
+			{
+				index[c] = batch.GetCount();
+
+				batch.Add(vdev.dev, cols[c], rm.m_col[c].size, row + rm.m_col[c].offset + 0x400000);
+			}
+			else if(skip[c])
+			{
+				vdev.dev->m_bad.Skip();
+			}
+		}
+
+		batch.Execute();
+
+		std::vector<uint32_t> bad;
+
+		for(uint32_t c = rm.m_firstdatacol; c < rm.m_cols; c++)
+		{
+			if(index[c] == (size_t)-1 || !batch.Succeeded(index[c], index[c] + 1))
+			{
+				bad.push_back(c);
+			}
+		}
+
+		if(bad.empty())
+		{
+			return true;
+		}
+
+		if(bad.size() > rm.m_firstdatacol)
+		{
+			return false;
+		}
+
+		// the parity columns are only read when needed, all of them at once
+
+		IoBatch pbatch;
+
+		for(uint32_t c = 0; c < rm.m_firstdatacol; c++)
+		{
+			VirtualDevice& vdev = children[(size_t)rm.m_col[c].devidx];
+
+			if(vdev.dev != NULL && !skip[c])
+			{
+				cols[c] = (uint8_t*)DeviceBackend::AllocBuffer(rm.m_col[c].size);
+				index[c] = pbatch.GetCount();
+
+				pbatch.Add(vdev.dev, cols[c], rm.m_col[c].size, row + rm.m_col[c].offset + 0x400000);
+			}
+		}
+
+		pbatch.Execute();
+
+		std::vector<uint8_t*> parity(cols.begin(), cols.begin() + rm.m_firstdatacol);
+
+		for(uint32_t c = 0; c < rm.m_firstdatacol; c++)
+		{
+			if(cols[c] != NULL && !pbatch.Succeeded(index[c], index[c] + 1))
+			{
+				cols[c] = NULL;
+			}
+		}
+
+		bool ok = raidz_reconstruct(rm, cols.data(), bad.data(), (uint32_t)bad.size());
+
+		for(auto i = parity.begin(); i != parity.end(); i++)
+		{
+			if(*i != NULL)
+			{
+				DeviceBackend::FreeBuffer(*i);
+			}
+		}
+
+		return ok;
+	}
+
+	bool VirtualDevice::ReconstructRaidz(uint8_t* buff, size_t size, uint64_t offset, const Verifier& verify)
+	{
+		// the columns were read but the block does not verify, one of the disks returned the wrong data,
+		// every combination of data columns the parity can make up for is rebuilt until the checksum matches
+
+		size_t padded = roundup(size, (size_t)1 << ashift);
+
+		if(padded != size)
+		{
+			uint8_t* tmp = (uint8_t*)DeviceBackend::AllocBuffer(padded);
+
+			bool ok = ReconstructRaidz(tmp, padded, offset, [&] (const uint8_t* b, size_t) -> bool {return verify(b, size);});
+
+			if(ok)
+			{
+				memcpy(buff, tmp, size);
+			}
+
+			DeviceBackend::FreeBuffer(tmp);
+
+			return ok;
+		}
+
+		raidz_map_t tmp;
+		uint64_t row;
+
+		const raidz_map_t& rm = *GetRaidzMap(offset, size, row, tmp);
+
+		uint64_t total = 0;
+
+		for(uint32_t c = rm.m_firstdatacol; c < rm.m_cols; c++)
+		{
+			total += rm.m_col[c].size;
+		}
+
+		if(total > size)
+		{
+			return false;
+		}
+
+		// all of it again, parity included, a column that cannot be read is in every combination
+
+		uint8_t* data = (uint8_t*)DeviceBackend::AllocBuffer(size);
+
+		std::vector<uint8_t*> cols(rm.m_cols, (uint8_t*)NULL);
+		std::vector<uint8_t*> parity(rm.m_firstdatacol, (uint8_t*)NULL);
+		std::vector<size_t> index(rm.m_cols, (size_t)-1);
+
+		IoBatch batch;
+
+		uint8_t* p = data;
+
+		for(uint32_t c = 0; c < rm.m_cols; c++)
+		{
+			if(c < rm.m_firstdatacol)
+			{
+				cols[c] = parity[c] = (uint8_t*)DeviceBackend::AllocBuffer(rm.m_col[c].size);
+			}
+			else
+			{
+				cols[c] = p;
+
+				p += rm.m_col[c].size;
+			}
+
+			VirtualDevice& vdev = children[(size_t)rm.m_col[c].devidx];
+
+			if(vdev.dev != NULL)
+			{
+				index[c] = batch.GetCount();
+
+				batch.Add(vdev.dev, cols[c], rm.m_col[c].size, row + rm.m_col[c].offset + 0x400000);
+			}
+		}
+
+		batch.Execute();
+
+		std::vector<uint32_t> missing;
+		std::vector<uint32_t> present;
+
+		uint32_t available = 0;
+
+		for(uint32_t c = 0; c < rm.m_cols; c++)
+		{
+			bool ok = index[c] != (size_t)-1 && batch.Succeeded(index[c], index[c] + 1);
+
+			if(c < rm.m_firstdatacol)
+			{
+				if(ok) available++;
+				else cols[c] = NULL;
+			}
+			else
+			{
+				(ok ? present : missing).push_back(c);
+			}
+		}
+
+		// smaller combinations first, a single bad column also verifies as part of any pair
+
+		std::vector<uint32_t> found;
+
+		for(uint32_t k = 1; missing.size() + k <= available && found.empty(); k++)
+		{
+			std::vector<std::vector<uint32_t>> candidates;
+
+			std::vector<uint32_t> set = missing;
+
+			std::function<void (size_t, uint32_t)> enumerate = [&] (size_t first, uint32_t left)
+			{
+				if(left == 0)
+				{
+					candidates.push_back(set);
+
+					return;
+				}
+
+				for(size_t i = first; i + left <= present.size(); i++)
+				{
+					set.push_back(present[i]);
+
+					enumerate(i + 1, left - 1);
+
+					set.pop_back();
+				}
+			};
+
+			enumerate(0, k);
+
+			// each worker rebuilds into its own copy of the block, the first one to verify is copied out
+
+			std::atomic<size_t> next(0);
+			std::atomic<int> winner(-1);
+
+			auto worker = [&] ()
+			{
+				uint8_t* work = (uint8_t*)DeviceBackend::AllocBuffer(size);
+
+				memcpy(work, data, size);
+
+				std::vector<uint8_t*> wcols(cols);
+
+				for(uint32_t c = rm.m_firstdatacol; c < rm.m_cols; c++)
+				{
+					wcols[c] = work + (cols[c] - data);
+				}
+
+				for(size_t i; winner < 0 && (i = next++) < candidates.size(); )
+				{
+					const std::vector<uint32_t>& bad = candidates[i];
+
+					if(raidz_reconstruct(rm, wcols.data(), bad.data(), (uint32_t)bad.size()) && verify(work, size))
+					{
+						int expected = -1;
+
+						if(winner.compare_exchange_strong(expected, (int)i))
+						{
+							memcpy(buff, work, size);
+						}
+
+						break;
+					}
+
+					for(auto j = bad.begin(); j != bad.end(); j++)
+					{
+						memcpy(wcols[*j], cols[*j], rm.m_col[*j].size);
+					}
+				}
+
+				DeviceBackend::FreeBuffer(work);
+			};
+
+			// a thread costs more than a few tries, only wide raidz2/3 have enough combinations to share out
+
+			size_t workers = std::max<size_t>(std::min<size_t>(std::thread::hardware_concurrency(), candidates.size() / RECONSTRUCT_PER_THREAD), 1);
+
+			std::vector<std::thread> threads;
+
+			for(size_t i = 1; i < workers; i++)
+			{
+				threads.push_back(std::thread(worker));
+			}
+
+			worker();
+
+			for(auto i = threads.begin(); i != threads.end(); i++)
+			{
+				i->join();
+			}
+
+			if(winner >= 0)
+			{
+				found = candidates[winner];
+			}
+		}
+
+		for(auto i = parity.begin(); i != parity.end(); i++)
+		{
+			DeviceBackend::FreeBuffer(*i);
+		}
+
+		DeviceBackend::FreeBuffer(data);
+
+		if(found.empty())
+		{
+			return false;
+		}
+
+		// the culprit is reported and avoided from now on
+
+		for(auto i = found.begin(); i != found.end(); i++)
+		{
+			VirtualDevice& vdev = children[(size_t)rm.m_col[*i].devidx];
+
+			if(vdev.dev == NULL)
+			{
+				continue;
+			}
+
+			printf("raidz column %d was bad (vdev=%lld child=%lld guid=%016llx offset=%lld), reconstructed\n", 
+				(int)*i, (long long)id, (long long)rm.m_col[*i].devidx, (unsigned long long)vdev.guid, (long long)offset);
+
+			vdev.MarkBad(row + rm.m_col[*i].offset, rm.m_col[*i].size);
+		}
+
+		return true;
+	}
+
+	bool VirtualDevice::QueueStripes(IoBatch& batch, uint8_t* const* buffs, const size_t* sizes, const uint64_t* offsets, size_t count)
+	{
+		// consecutive raidz blocks, each child reads the whole range their columns cover in one go,
+		// parity and skipped sectors in between included, and the columns are copied out when done
+
+		if(type != "raidz")
+		{
+			return false;
+		}
+
+		std::vector<uint64_t> start(children.size(), ~0ULL);
+		std::vector<uint64_t> end(children.size(), 0);
+
+		raidz_map_t tmp;
+		uint64_t row;
+
+		size_t sector = (size_t)1 << ashift;
+
+		for(size_t i = 0; i < count; i++)
+		{
+			const raidz_map_t& rm = *GetRaidzMap(offsets[i], roundup(sizes[i], sector), row, tmp);
+
+			for(uint32_t c = 0; c < rm.m_cols; c++)
+			{
+				uint32_t devidx = rm.m_col[c].devidx;
+
+				if(children[devidx].dev == NULL || children[devidx].IsBad(row + rm.m_col[c].offset, rm.m_col[c].size))
+				{
+					return false;
+				}
+
+				start[devidx] = std::min<uint64_t>(start[devidx], row + rm.m_col[c].offset);
+				end[devidx] = std::max<uint64_t>(end[devidx], row + rm.m_col[c].offset + rm.m_col[c].size);
+			}
+		}
+
+		std::vector<size_t> index(children.size());
+
+		for(size_t i = 0; i < children.size(); i++)
+		{
+			if(start[i] < end[i])
+			{
+				index[i] = batch.GetCount();
+
+				batch.AddStaged(children[i].dev, (size_t)(end[i] - start[i]), start[i] + 0x400000);
+			}
+		}
+
+		for(size_t i = 0; i < count; i++)
+		{
+			const raidz_map_t& rm = *GetRaidzMap(offsets[i], roundup(sizes[i], sector), row, tmp);
+
+			// the last column may hold the padding of a block not ending on a sector
+
+			size_t done = 0;
+
+			for(uint32_t c = rm.m_firstdatacol; c < rm.m_cols && done < sizes[i]; c++)
+			{
+				uint32_t devidx = rm.m_col[c].devidx;
+
+				size_t n = std::min<size_t>(rm.m_col[c].size, sizes[i] - done);
+
+				batch.Scatter(index[devidx], (size_t)(row + rm.m_col[c].offset - start[devidx]), buffs[i] + done, n);
+
+				done += n;
+			}
+		}
+
+		return true;
+	}
+
+	bool VirtualDevice::Queue(IoBatch& batch, uint8_t* buff, size_t size, uint64_t offset)
+	{
+		if(type == "disk" || type == "file")
+		{
+			if(dev != NULL)
+			{
+				batch.Add(dev, buff, size, offset + 0x400000);
+
+				return true;
+			}
+		}
+		else if(type == "mirror")
+		{
+			VirtualDevice* vdev = Select(offset, size);
+
+			if(vdev != NULL)
+			{
+				batch.Add(vdev->dev, buff, size, offset + 0x400000);
+
+				return true;
+			}
+		}
+		else if(type == "raidz")
+		{
+			if(size & ((1ULL << ashift) - 1))
+			{
+				return false; // padded, Read takes care of it
+			}
+
+			raidz_map_t tmp;
+			uint64_t row;
+
+			const raidz_map_t& rm = *GetRaidzMap(offset, size, row, tmp);
+
+			uint64_t total = 0;
+
+			for(size_t i = rm.m_firstdatacol; i < rm.m_cols; i++)
+			{
+				total += rm.m_col[i].size;
+			}
+
+			if(total > size)
+			{
+				return false;
+			}
+
+			uint8_t* p = buff;
+
+			for(size_t i = rm.m_firstdatacol; i < rm.m_cols; i++)
+			{
+				VirtualDevice& vdev = children[(size_t)rm.m_col[i].devidx];
+
+				if(vdev.dev == NULL || vdev.IsBad(row + rm.m_col[i].offset, rm.m_col[i].size))
+				{
+					return false; // degraded, Read reconstructs it from parity
+				}
+
+				batch.Add(vdev.dev, p, rm.m_col[i].size, row + rm.m_col[i].offset + 0x400000);
+
+				p += rm.m_col[i].size;
+			}
+
+			return true;
+		}
+		else 
+		{
+			ASSERT(0);
+		}
+
+		return false;
+	}
+
+	void VirtualDevice::SetPolicy(uint32_t p)
+	{
+		policy = p;
+
+		for(auto i = children.begin(); i != children.end(); i++)
+		{
+			i->SetPolicy(p);
+		}
+	}
+
+	VirtualDevice* VirtualDevice::Select(uint64_t offset, size_t size)
+	{
+		// picks a mirror child to read from, one known to be bad there only if all of them are
+
+		VirtualDevice* best = NULL;
+		uint64_t best_cost = 0;
+		bool best_bad = false;
+
+		size_t n = children.size();
+
+		rotor++;
+
+		for(size_t i = 0; i < n; i++)
+		{
+			VirtualDevice* vdev = &children[(rotor + i) % n];
+
+			if(vdev->dev == NULL)
+			{
+				continue;
+			}
+
+			uint64_t cost = 0;
+
+			switch(policy)
+			{
+			case MIRROR_LEAST_OUTSTANDING:
+				cost = vdev->dev->GetOutstanding();
+				break;
+			case MIRROR_LOCALITY:
+				{
+					uint64_t last = vdev->dev->GetLastOffset();
+					uint64_t pos = offset + 0x400000 + vdev->dev->m_start;
+					cost = pos > last ? pos - last : last - pos;
+				}
+				break;
+			}
+
+			bool bad = vdev->IsBad(offset, size);
+
+			if(best == NULL || bad < best_bad || (bad == best_bad && cost < best_cost))
+			{
+				best = vdev;
+				best_cost = cost;
+				best_bad = bad;
+			}
+		}
+
+		return best;
+	}
+
+	uint8_t* VirtualDevice::Map(uint64_t offset, size_t size, const Verifier& verify)
+	{
+		if(type == "disk" || type == "file")
+		{
+			if(dev != NULL)
+			{
+				uint8_t* mapped = dev->Map(offset + 0x400000, size);
+
+				if(mapped != NULL && Check(mapped, size, offset, verify))
+				{
+					return mapped;
+				}
+			}
+		}
+		else if(type == "mirror")
+		{
+			for(auto i = children.begin(); i != children.end(); i++)
+			{
+				if(i->dev != NULL)
+				{
+					uint8_t* mapped = i->Map(offset, size, verify);
+
+					if(mapped != NULL || verify == nullptr)
+					{
+						return mapped;
+					}
+				}
+			}
+		}
+
+		// raidz columns are scattered over the children, never contiguous
+
+		return NULL;
+	}
+
+	VirtualDevice* VirtualDevice::Find(uint64_t guid_to_find)
+	{
+		if(guid == guid_to_find)
+		{
+			return this;
+		}
+
+		for(auto i = children.begin(); i != children.end(); i++)
+		{
+			VirtualDevice* vdev = i->Find(guid_to_find);
+
+			if(vdev != NULL)
+			{
+				return vdev;
+			}
+		}
+
+		return NULL;
+	}
+
+	void VirtualDevice::GetLeaves(std::list<VirtualDevice*>& leaves)
+	{
+		if(children.empty())
+		{
+			leaves.push_back(this);
+		}
+		else
+		{
+			for(auto i = children.begin(); i != children.end(); i++)
+			{
+				i->GetLeaves(leaves);
+			}
+		}
+	}
+
+	bool VirtualDevice::IsBad(uint64_t offset, size_t size) const
+	{
+		// only leaves know, a raidz column or a mirror child is asked one by one
+
+		return dev != NULL && children.empty() && dev->m_bad.Contains(offset + 0x400000, size);
+	}
+
+	void VirtualDevice::MarkBad(uint64_t offset, size_t size)
+	{
+		if(dev != NULL && children.empty())
+		{
+			dev->m_bad.Add(offset + 0x400000, size, true);
+		}
+	}
+
+	void VirtualDevice::MarkGood(uint64_t offset, size_t size)
+	{
+		if(dev != NULL && children.empty())
+		{
+			dev->m_bad.Remove(offset + 0x400000, size, true);
+		}
+	}
+
+	// BadExtentMap
+
+	void BadExtentMap::Add(uint64_t offset, size_t size, bool cksum)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		uint64_t start = offset;
+		uint64_t end = offset + size;
+		uint32_t failures = 0;
+
+		// swallow everything overlapping or touching it, the failure count goes on from the worst one overlapping
+
+		auto i = m_extents.upper_bound(start);
+
+		if(i != m_extents.begin())
+		{
+			auto prev = i;
+
+			if((--prev)->second.end >= start)
+			{
+				i = prev;
+			}
+		}
+
+		while(i != m_extents.end() && i->first <= end)
+		{
+			start = std::min<uint64_t>(start, i->first);
+			end = std::max<uint64_t>(end, i->second.end);
+			if(i->first < offset + size && i->second.end > offset)
+			{
+				failures = std::max<uint32_t>(failures, i->second.failures); // the same region failed again
+			}
+
+			cksum = cksum || i->second.cksum;
+
+			i = m_extents.erase(i);
+		}
+
+		Extent e;
+
+		e.end = end;
+		e.failures = failures + 1;
+		e.cksum = cksum;
+		e.until = std::chrono::steady_clock::now() + std::chrono::milliseconds((int64_t)QUARANTINE_MS << std::min<uint32_t>(failures, MAX_DOUBLING));
+
+		m_extents[start] = e;
+
+		m_count = m_extents.size();
+	}
+
+	void BadExtentMap::Remove(uint64_t offset, size_t size, bool verified)
+	{
+		if(m_count == 0)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		uint64_t start = offset;
+		uint64_t end = offset + size;
+
+		// what is left on either side of the good range stays bad
+
+		auto i = m_extents.upper_bound(start);
+
+		if(i != m_extents.begin())
+		{
+			auto prev = i;
+
+			if((--prev)->second.end > start)
+			{
+				i = prev;
+			}
+		}
+
+		while(i != m_extents.end() && i->first < end)
+		{
+			if(i->second.cksum && !verified)
+			{
+				i++;
+
+				continue;
+			}
+
+			uint64_t first = i->first;
+
+			Extent e = i->second;
+
+			i = m_extents.erase(i);
+
+			if(first < start)
+			{
+				Extent left = e;
+
+				left.end = start;
+
+				m_extents[first] = left;
+			}
+
+			if(e.end > end)
+			{
+				i = m_extents.insert(i, std::make_pair(end, e));
+
+				break;
+			}
+		}
+
+		m_count = m_extents.size();
+	}
+
+	bool BadExtentMap::Contains(uint64_t offset, size_t size) const
+	{
+		if(m_count == 0)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		auto now = std::chrono::steady_clock::now();
+
+		auto i = m_extents.upper_bound(offset);
+
+		if(i != m_extents.begin())
+		{
+			auto prev = i;
+
+			if((--prev)->second.end > offset)
+			{
+				i = prev;
+			}
+		}
+
+		// once the quarantine is over the region is read again, it either comes back or goes away for longer
+
+		for(; i != m_extents.end() && i->first < offset + size; i++)
+		{
+			if(now < i->second.until)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void BadExtentMap::Clear()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		m_extents.clear();
+
+		m_count = 0;
+	}
+
+	void BadExtentMap::GetExtents(std::vector<BadExtent>& extents) const
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		auto now = std::chrono::steady_clock::now();
+
+		extents.clear();
+
+		for(auto i = m_extents.begin(); i != m_extents.end(); i++)
+		{
+			BadExtent e;
+
+			e.start = i->first;
+			e.end = i->second.end;
+			e.failures = i->second.failures;
+			e.cksum = i->second.cksum;
+			e.retry_ms = std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(i->second.until - now).count(), 0);
+
+			extents.push_back(e);
+		}
+	}
+
+	// LatencyHistogram
+
+	LatencyHistogram::LatencyHistogram()
+	{
+		Reset();
+	}
+
+	void LatencyHistogram::Reset()
+	{
+		memset(m_bucket, 0, sizeof(m_bucket));
+
+		m_count = 0;
+		m_recent = 0;
+	}
+
+	void LatencyHistogram::Add(uint64_t us)
+	{
+		m_recent = m_count > 0 ? (m_recent * 7 + us) / 8 : us;
+
+		int i = 0;
+
+		while(us > 1 && i < BUCKETS - 1)
+		{
+			us >>= 1;
+			i++;
+		}
+
+		m_bucket[i]++;
+		m_count++;
+	}
+
+	uint64_t LatencyHistogram::GetPercentile(double p) const
+	{
+		uint64_t n = (uint64_t)(p * m_count);
+		uint64_t sum = 0;
+
+		for(int i = 0; i < BUCKETS; i++)
+		{
+			sum += m_bucket[i];
+
+			if(sum > n || sum == m_count)
+			{
+				return 2ULL << i; // upper bound of the bucket
+			}
+		}
+
+		return 0;
+	}
+
+	// bounce buffers for direct devices, a few of each size are kept around so the footprint stays flat
+
+	static class BouncePool
+	{
+		enum {MAX_CACHED = 4 << 20};
+
+		std::mutex m_lock;
+		std::map<size_t, std::vector<void*>> m_free;
+		size_t m_cached;
+
+		static size_t SizeClass(size_t size)
+		{
+			size_t n = 4096;
+
+			while(n < size) n <<= 1;
+
+			return n;
+		}
+
+	public:
+		BouncePool() : m_cached(0) {}
+
+		void* Alloc(size_t size, size_t align)
+		{
+			size = SizeClass(std::max<size_t>(size, align));
+
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+
+				std::vector<void*>& v = m_free[size];
+
+				if(!v.empty())
+				{
+					void* p = v.back();
+
+					v.pop_back();
+
+					m_cached -= size;
+
+					return p;
+				}
+			}
+
+			// power of two sizes from 4k are aligned to themselves, up to 64k
+
+			return _aligned_malloc(size, std::min<size_t>(size, 0x10000));
+		}
+
+		void Free(void* p, size_t size)
+		{
+			size = SizeClass(size);
+
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+
+				if(m_cached + size <= MAX_CACHED)
+				{
+					m_free[size].push_back(p);
+
+					m_cached += size;
+
+					return;
+				}
+			}
+
+			_aligned_free(p);
+		}
+
+	} s_bounce;
+
+	// Device
+
+	Device::Device()
+		: m_depth(0)
+		, m_inflight(0)
+		, m_queued(0)
+		, m_last(0)
+		, m_backend(NULL)
+		, m_start(0)
+		, m_size(0)
+		, m_bytes(0)
+		, m_label(NULL)
+		, m_active(NULL)
+		, m_merge_gap(MERGE_GAP)
+	{
+		m_single = DeviceRequest();
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	Device::~Device()
+	{
+		Close();
+	}
+
+	bool Device::Open(const wchar_t* path, uint32_t partition, uint32_t flags)
+	{
+		Close();
+
+		m_backend = DeviceBackend::Create(flags);
+
+		if(!m_backend->Open(path))
+		{
+			wprintf(L"Cannot open device %ls\n", path);
+
+			delete m_backend;
+
+			m_backend = NULL;
+
+			return false;
+		}
+
+		m_size = m_backend->GetSize();
+
+		if(wcsstr(path, L".vdi") != NULL)
+		{
+			m_start += 0x2000;
+			m_size -= 0x2000;
+		}
+		else
+
+		for(int i = 0; i < 2; i++, partition >>= 8)
+		{
+			uint8_t mbr[0x200];
+
+			Read(mbr, sizeof(mbr), 0);
+
+			if(mbr[0x1fe] == 0x55 || mbr[0x1ff] == 0xaa)
+			{
+				uint8_t* ptr = &mbr[0x1be];
+
+				for(int i = 0; i < 4; i++)
+				{
+					if((partition & 0xff) == i)
+					{
+						uint64_t start = *(uint32_t*)&ptr[i * 16 + 8];
+						uint64_t size = *(uint32_t*)&ptr[i * 16 + 12];
+
+						if(start != 0 && size != 0)
+						{
+							m_start += start << 9;
+							m_size = size << 9;
+						}
+
+						break;
+					}
+				}
+			}
+		}
+
+		m_label = new vdev_label_t();
+
+		Read(m_label, sizeof(vdev_label_t), 0);
+
+		if(m_label->vdev_phys.zbt.magic != ZEC_MAGIC)
+		{
+			return false;
+		}
+
+		// TODO: verify m_label->vdev_phys.zbt.chksum (but which part of m_label does it hash ???)
+
+		if(!m_desc.Init(m_label->vdev_phys))
+		{
+			return false;
+		}
+
+		// direct reads are done in whole allocation units from now on
+
+		m_backend->SetAlignment((size_t)1 << m_desc.top.ashift);
+
+		for(size_t i = 0; i < sizeof(m_label->uberblock); i += m_desc.ub_size)
+		{
+			uberblock_t* ub = (uberblock_t*)&m_label->uberblock[i];
+
+			if(ub->magic == BSWAP_64(UBERBLOCK_MAGIC))
+			{
+				// TODO: be <-> le
+			}
+
+			if(ub->magic != UBERBLOCK_MAGIC)
+			{
+				continue;
+			}
+
+			zio_eck_t* eck = (zio_eck_t*)&m_label->uberblock[i + m_desc.ub_size] - 1;
+/*
+
+extern void UnixTimeToSystemTime(uint64_t t, SYSTEMTIME* st);
+
+SYSTEMTIME st;
+UnixTimeToSystemTime(ub->timestamp, &st);
+
+printf("%d %I64d (%d-%02d-%02d %d:%02d:%02d)\n", 
+	i / m_desc.ub_size, ub->txg, 
+	st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond); 
+*/
+			if(m_active == NULL || ub->txg > m_active->txg)
+			{
+				m_active = ub;
+			}
+		}
+
+		return m_active != NULL;
+	}
+
+	void Device::Close()
+	{
+		if(m_backend != NULL)
+		{
+			if(!m_pending.empty() || !m_abandoned.empty())
+			{
+				m_backend->Wait();
+
+				Collect();
+			}
+
+			m_backend->Close();
+
+			delete m_backend;
+
+			m_backend = NULL;
+		}
+
+		if(m_label != NULL)
+		{
+			delete m_label;
+
+			m_label = NULL;
+		}
+
+		m_start = 0;
+		m_size = 0;
+		m_bytes = 0;
+
+		m_active = NULL;
+
+		memset(&m_stats, 0, sizeof(m_stats));
+
+		m_latency.Reset();
+
+		m_bad.Clear();
+	}
+
+	size_t Device::Read(void* buff, size_t size, uint64_t offset)
+	{
+		return BeginRead(buff, size, offset) ? EndRead() : 0;
+	}
+
+	bool Device::BeginRead(void* buff, size_t size, uint64_t offset)
+	{
+		m_single.buff = buff;
+		m_single.size = size;
+		m_single.offset = offset;
+		m_single.result = 0;
+
+		DeviceRequest* req = &m_single;
+
+		return Submit(&req, 1);
+	}
+
+	size_t Device::EndRead()
+	{
+		Wait();
+
+		return m_single.result;
+ 	}
+
+	bool Device::Submit(DeviceRequest* const* reqs, size_t count)
+	{
+		// the elevator: sorted by offset, neighbours closer than m_merge_gap are read in one go into a bounce buffer,
+		// so are misaligned requests of direct devices, widened to whole sectors
+
+		size_t align = m_backend->GetAlignment();
+
+		std::vector<DeviceRequest*> sorted(reqs, reqs + count);
+
+		std::stable_sort(sorted.begin(), sorted.end(), [] (const DeviceRequest* a, const DeviceRequest* b) -> bool {return a->offset < b->offset;});
+
+		std::vector<DeviceRequest*> ios;
+
+		auto now = std::chrono::steady_clock::now();
+
+		for(size_t i = 0; i < sorted.size(); )
+		{
+			uint64_t start = sorted[i]->offset + m_start;
+			uint64_t end = start + sorted[i]->size;
+			uint64_t gap = 0;
+
+			size_t j = i + 1;
+
+			for(; j < sorted.size(); j++)
+			{
+				uint64_t next = sorted[j]->offset + m_start;
+
+				if(next > end + m_merge_gap || std::max<uint64_t>(end, next + sorted[j]->size) - start > MAX_MERGE)
+				{
+					break;
+				}
+
+				if(next > end)
+				{
+					gap += next - end;
+				}
+
+				end = std::max<uint64_t>(end, next + sorted[j]->size);
+			}
+
+			m_pending.push_back(Pending());
+
+			Pending& p = m_pending.back();
+
+			p.io.buff = sorted[i]->buff;
+			p.io.size = (size_t)(end - start);
+			p.io.offset = start;
+			p.io.result = 0;
+			p.io.done = false;
+			p.bounce = NULL;
+
+			for(size_t k = i; k < j; k++)
+			{
+				sorted[k]->result = 0;
+				sorted[k]->done = false;
+
+				Part part = {sorted[k], (size_t)(sorted[k]->offset + m_start - start)};
+
+				p.parts.push_back(part);
+			}
+
+			bool aligned = align <= 1 || (start % align == 0 && end % align == 0 && (UINT_PTR)p.io.buff % align == 0);
+
+			if(j - i > 1 || !aligned)
+			{
+				if(align > 1)
+				{
+					uint64_t astart = start - start % align;
+					uint64_t aend = (end + align - 1) / align * align;
+
+					for(auto k = p.parts.begin(); k != p.parts.end(); k++)
+					{
+						k->skip += (size_t)(start - astart);
+					}
+
+					p.io.offset = astart;
+					p.io.size = (size_t)(aend - astart);
+				}
+
+				p.bounce = (uint8_t*)s_bounce.Alloc(p.io.size, std::max<size_t>(align, 16));
+				p.io.buff = p.bounce;
+			}
+
+			ios.push_back(&p.io);
+
+			p.submitted = now;
+
+			m_last = end;
+
+			m_stats.reads += j - i;
+			m_stats.merged += j - i - 1;
+			m_stats.gap_bytes += gap;
+
+			i = j;
+		}
+
+		m_stats.ios += ios.size();
+
+		m_inflight += count;
+
+		m_depth += ios.size();
+
+		m_stats.max_depth = std::max<uint64_t>(m_stats.max_depth, m_depth);
+
+		return m_backend->Submit(ios.data(), ios.size());
+	}
+
+	bool Device::Wait(int64_t timeout)
+	{
+		// requests are completed one by one as the backend finishes them, abandoned ones are not waited for
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(std::max<int64_t>(timeout, 0));
+
+		if(m_pending.empty() && !m_abandoned.empty())
+		{
+			m_backend->WaitAny(0);
+		}
+
+		for(;;)
+		{
+			Collect();
+
+			if(m_pending.empty())
+			{
+				return true;
+			}
+
+			int64_t left = -1;
+
+			if(timeout >= 0)
+			{
+				left = std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count(), 0);
+			}
+
+			if(!m_backend->WaitAny(left))
+			{
+				Collect();
+
+				return m_pending.empty();
+			}
+		}
+	}
+
+	void Device::Complete(Pending& p)
+	{
+		// the latency is the device's own, from submission to when the backend saw the request complete
+
+		m_bytes += p.io.result;
+
+		m_latency.Add((uint64_t)std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(p.io.completed - p.submitted).count(), 0));
+
+		for(auto j = p.parts.begin(); j != p.parts.end(); j++)
+		{
+			DeviceRequest* req = j->req;
+
+			if(req == NULL) continue; // abandoned
+
+			if(p.bounce != NULL)
+			{
+				size_t n = p.io.result > j->skip ? std::min<size_t>(p.io.result - j->skip, req->size) : 0;
+
+				memcpy(req->buff, p.bounce + j->skip, n);
+
+				req->result = n;
+			}
+			else
+			{
+				req->result = p.io.result;
+			}
+
+			req->completed = p.io.completed;
+			req->done = true;
+
+			Account(req);
+		}
+
+		if(p.bounce != NULL)
+		{
+			s_bounce.Free(p.bounce, p.io.size);
+		}
+
+		for(auto i = p.orphans.begin(); i != p.orphans.end(); i++)
+		{
+			DeviceBackend::FreeBuffer(*i);
+		}
+
+		m_inflight -= std::min<size_t>(m_inflight, p.parts.size());
+
+		m_depth -= std::min<size_t>(m_depth, 1);
+	}
+
+	void Device::Collect()
+	{
+		for(auto i = m_pending.begin(); i != m_pending.end(); )
+		{
+			if(i->io.done)
+			{
+				Complete(*i);
+
+				i = m_pending.erase(i);
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		for(auto i = m_abandoned.begin(); i != m_abandoned.end(); )
+		{
+			if(i->io.done)
+			{
+				Complete(*i);
+
+				i = m_abandoned.erase(i);
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	void Device::Account(const DeviceRequest* req)
+	{
+		if(req->result != req->size)
+		{
+			m_bad.Add(req->offset, req->size);
+		}
+		else
+		{
+			m_bad.Remove(req->offset, req->size);
+		}
+	}
+
+	void Device::Abandon(DeviceRequest* req, void* buff)
+	{
+		// the caller is gone, buff was allocated by DeviceBackend::AllocBuffer and is released when the read completes,
+		// a read left with nobody waiting for it moves aside so that Wait does not block on it
+
+		for(auto i = m_pending.begin(); i != m_pending.end(); )
+		{
+			bool found = false;
+			bool orphaned = true;
+
+			for(auto j = i->parts.begin(); j != i->parts.end(); j++)
+			{
+				if(j->req == req)
+				{
+					j->req = NULL;
+
+					found = true;
+				}
+
+				if(j->req != NULL)
+				{
+					orphaned = false;
+				}
+			}
+
+			if(found)
+			{
+				i->orphans.push_back(buff);
+
+				if(orphaned)
+				{
+					m_abandoned.splice(m_abandoned.end(), m_pending, i);
+				}
+
+				return;
+			}
+
+			i++;
+		}
+
+		DeviceBackend::FreeBuffer(buff); // already completed
+	}
+
+	uint8_t* Device::Map(uint64_t offset, size_t size)
+	{
+		return m_backend->Map(offset + m_start, size);
+	}
+
+	// IoBatch
+
+	void IoBatch::Add(Device* dev, void* buff, size_t size, uint64_t offset)
+	{
+		ASSERT(!m_executed);
+
+		Entry e;
+
+		e.dev = dev;
+		e.req.buff = buff;
+		e.req.size = size;
+		e.req.offset = offset;
+		e.req.result = 0;
+
+		m_entries.push_back(e);
+
+		dev->m_queued++;
+		dev->m_last = offset + dev->m_start + size;
+	}
+
+	void IoBatch::AddStaged(Device* dev, size_t size, uint64_t offset)
+	{
+		void* buff = DeviceBackend::AllocBuffer(size);
+
+		m_staging.push_back(buff);
+
+		Add(dev, buff, size, offset);
+	}
+
+	void IoBatch::Scatter(size_t entry, size_t skip, uint8_t* dst, size_t size)
+	{
+		ASSERT(skip + size <= m_entries[entry].req.size);
+
+		Copy c = {entry, skip, dst, size};
+
+		m_copies.push_back(c);
+	}
+
+	void IoBatch::Submit()
+	{
+		ASSERT(!m_executed);
+
+		std::map<Device*, std::vector<DeviceRequest*>> queues;
+
+		for(auto i = m_entries.begin(); i != m_entries.end(); i++)
+		{
+			queues[i->dev].push_back(&i->req);
+
+			i->dev->m_queued--;
+		}
+
+		m_executed = true;
+
+		// everything is submitted before waiting on anything, so the devices work in parallel
+
+		for(auto i = queues.begin(); i != queues.end(); i++)
+		{
+			i->first->Submit(i->second.data(), i->second.size());
+
+			m_devices.push_back(i->first);
+		}
+	}
+
+	void IoBatch::Wait()
+	{
+		// the devices are looked at in turn, so that a fast one is not left unattended while a slow one is waited on,
+		// only the last one left is waited on without a limit
+
+		while(!m_devices.empty())
+		{
+			for(auto i = m_devices.begin(); i != m_devices.end(); )
+			{
+				if((*i)->Wait(0))
+				{
+					i = m_devices.erase(i);
+				}
+				else
+				{
+					i++;
+				}
+			}
+
+			if(!m_devices.empty() && m_devices.front()->Wait(m_devices.size() > 1 ? WAIT_SLICE_US : -1))
+			{
+				m_devices.erase(m_devices.begin());
+			}
+		}
+
+		for(auto i = m_copies.begin(); i != m_copies.end(); i++)
+		{
+			const DeviceRequest& req = m_entries[i->entry].req;
+
+			if(req.result == req.size)
+			{
+				memcpy(i->dst, (uint8_t*)req.buff + i->skip, i->size);
+			}
+		}
+	}
+
+	void IoBatch::Poll()
+	{
+		for(auto i = m_devices.begin(); i != m_devices.end(); i++)
+		{
+			(*i)->Wait(0);
+		}
+	}
+
+	void IoBatch::Clear()
+	{
+		Wait(); // nothing is freed under the devices' feet
+
+		if(!m_executed)
+		{
+			for(auto i = m_entries.begin(); i != m_entries.end(); i++)
+			{
+				i->dev->m_queued--;
+			}
+		}
+
+		for(auto i = m_staging.begin(); i != m_staging.end(); i++)
+		{
+			DeviceBackend::FreeBuffer(*i);
+		}
+
+		m_entries.clear();
+		m_copies.clear();
+		m_staging.clear();
+
+		m_executed = false;
+	}
+
+	bool IoBatch::Succeeded(size_t first, size_t last) const
+	{
+		for(size_t i = first; i < last; i++)
+		{
+			if(m_entries[i].req.result != m_entries[i].req.size)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// DeviceDesc
+
+	bool DeviceDesc::Init(vdev_phys_t& vd)
+	{
+		NameValueList nvl;
+
+		nvl.Init(vd.nvlist, sizeof(vd.nvlist));
+
+		try
+		{
+			guid = nvl.at("guid")->u64[0];
+			top_guid = nvl.at("top_guid")->u64[0];
+			state = nvl.at("state")->u64[0];
+			host.id = nvl.at("hostid")->u64[0];
+			host.name = nvl.at("hostname")->str[0];
+			pool.guid = nvl.at("pool_guid")->u64[0];
+			pool.name = nvl.at("name")->str[0];
+			txg = nvl.at("txg")->u64[0];
+			version = nvl.at("version")->u64[0];
+			top.Init(nvl.at("vdev_tree")->list);
+			ub_size = 1 << std::max<size_t>((size_t)top.ashift, UBERBLOCK_SHIFT);
+		}
+		catch(...)
+		{
+			return false;
+		}
+
+		return true;
+	}
+}
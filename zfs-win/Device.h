@@ -1,94 +1,272 @@
-/* 
- *	Copyright (C) 2010 Gabest
- *	http://code.google.com/p/zfs-win/
- *
- *  This Program is free software; you can redistribute it and/or modify
- *  it under the terms of the GNU General Public License as published by
- *  the Free Software Foundation; either version 2, or (at your option)
- *  any later version.
- *   
- *  This Program is distributed in the hope that it will be useful,
- *  but WITHOUT ANY WARRANTY; without even the implied warranty of
- *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
- *  GNU General Public License for more details.
- *   
- *  You should have received a copy of the GNU General Public License
- *  along with GNU Make; see the file COPYING.  If not, write to
- *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
- *  http://www.gnu.org/copyleft/gpl.html
- *
- */
-
-#pragma once
-
-#include "zfs.h"
-#include "NameValueList.h"
-
-namespace ZFS
-{
-	class Device;
-
-	class VirtualDevice
-	{
-	public:
-		Device* dev;
-		std::string type;
-		uint64_t id;
-		uint64_t guid;
-		uint64_t metaslab_array;
-		uint64_t metaslab_shift;
-		uint64_t ashift;
-		uint64_t asize;
-		std::string path;
-		std::string devid;
-		uint64_t nparity;
-		uint64_t whole_disk;
-		uint64_t is_log;
-		std::vector<VirtualDevice> children;
-
-		void Init(NameValueList* nvl);
-		bool Read(uint8_t* buff, size_t size, uint64_t offset);
-		VirtualDevice* Find(uint64_t guid_to_find);
-		void GetLeaves(std::list<VirtualDevice*>& leaves);
-	};
-
-	class DeviceDesc
-	{
-	public:
-		uint64_t guid;
-		uint64_t top_guid;
-		uint64_t state;
-		struct {uint64_t id; std::string name;} host;
-		struct {uint64_t guid; std::string name;} pool;
-		uint64_t txg;
-		uint64_t version;
-		VirtualDevice top;
-		size_t ub_size;
-
-		bool Init(vdev_phys_t& vd);
-	};
-
-	class Device
-	{
-	public:
-		DeviceDesc m_desc;
-		HANDLE m_handle;
-		uint64_t m_start;
-		uint64_t m_size;
-		uint64_t m_bytes;
-		vdev_label_t* m_label;
-		uberblock_t* m_active;
-		OVERLAPPED m_overlapped;
-
-	public:
-		Device();
-		virtual ~Device();
-
-		bool Open(const wchar_t* path, uint32_t partition = 0); // partition 0x0000EEPP (PP primary, EE extended, zero based index)
-		void Close();
-
-		size_t Read(void* buff, size_t size, uint64_t offset);
-		bool BeginRead(void* buff, size_t size, uint64_t offset);
-		size_t EndRead();
-	};
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "zfs.h"
+#include "NameValueList.h"
+#include "DeviceBackend.h"
+
+namespace ZFS
+{
+	class Device;
+
+	enum MirrorPolicy
+	{
+		MIRROR_ROUND_ROBIN,
+		MIRROR_LEAST_OUTSTANDING, // ties are broken round robin
+		MIRROR_LOCALITY, // the child whose last read ended closest to the offset
+	};
+
+	// reads gathered from any number of devices, each device gets its share in a single submission
+
+	class IoBatch
+	{
+		enum {WAIT_SLICE_US = 100}; // how long Wait sleeps on one device while others may be finishing
+
+		struct Entry {Device* dev; DeviceRequest req;};
+		struct Copy {size_t entry; size_t skip; uint8_t* dst; size_t size;};
+
+		std::vector<Entry> m_entries;
+		std::vector<Copy> m_copies;
+		std::vector<void*> m_staging;
+		std::vector<Device*> m_devices; // submitted to, waited on
+		bool m_executed;
+
+	public:
+		IoBatch() : m_executed(false) {}
+		~IoBatch() {Clear();}
+
+		size_t GetCount() const {return m_entries.size();}
+
+		void Add(Device* dev, void* buff, size_t size, uint64_t offset);
+		void AddStaged(Device* dev, size_t size, uint64_t offset); // into a buffer of the batch, Scatter tells where it goes
+		void Scatter(size_t entry, size_t skip, uint8_t* dst, size_t size);
+		void Execute() {Submit(); Wait();}
+		void Submit();
+		void Wait();
+		void Poll(); // picks up what has completed so far without waiting, completion times stay accurate
+		bool Succeeded(size_t first, size_t last) const;
+		void Clear();
+	};
+
+	class RaidzGeometry;
+
+	// checks what was read, mirrors try their next child when it says no
+
+	typedef std::function<bool (const uint8_t* buff, size_t size)> Verifier;
+
+	class VirtualDevice
+	{
+		enum {RECONSTRUCT_PER_THREAD = 16}; // combinations to try before another thread is worth starting
+
+	public:
+		Device* dev;
+		std::string type;
+		uint64_t id;
+		uint64_t guid;
+		uint64_t metaslab_array;
+		uint64_t metaslab_shift;
+		uint64_t ashift;
+		uint64_t asize;
+		std::string path;
+		std::string devid;
+		uint64_t nparity;
+		uint64_t whole_disk;
+		uint64_t is_log;
+		std::vector<VirtualDevice> children;
+		uint32_t policy; // MirrorPolicy
+		size_t rotor;
+		std::shared_ptr<RaidzGeometry> geometry;
+
+		void Init(NameValueList* nvl);
+		void SetPolicy(uint32_t p);
+		VirtualDevice* Select(uint64_t offset, size_t size);
+		bool Read(uint8_t* buff, size_t size, uint64_t offset, const Verifier& verify = nullptr);
+		bool ReadRaidz(uint8_t* buff, size_t size, uint64_t offset);
+		bool ReconstructRaidz(uint8_t* buff, size_t size, uint64_t offset, const Verifier& verify);
+		bool Check(const uint8_t* buff, size_t size, uint64_t offset, const Verifier& verify); // a leaf's read, marked bad or good accordingly
+		bool QueueStripes(IoBatch& batch, uint8_t* const* buffs, const size_t* sizes, const uint64_t* offsets, size_t count);
+		const raidz_map_t* GetRaidzMap(uint64_t offset, size_t size, uint64_t& row, raidz_map_t& tmp);
+		bool Queue(IoBatch& batch, uint8_t* buff, size_t size, uint64_t offset);
+		uint8_t* Map(uint64_t offset, size_t size, const Verifier& verify = nullptr);
+		VirtualDevice* Find(uint64_t guid_to_find);
+		void GetLeaves(std::list<VirtualDevice*>& leaves);
+		bool IsBad(uint64_t offset, size_t size) const;
+		void MarkBad(uint64_t offset, size_t size);
+		void MarkGood(uint64_t offset, size_t size);
+	};
+
+	class DeviceDesc
+	{
+	public:
+		uint64_t guid;
+		uint64_t top_guid;
+		uint64_t state;
+		struct {uint64_t id; std::string name;} host;
+		struct {uint64_t guid; std::string name;} pool;
+		uint64_t txg;
+		uint64_t version;
+		VirtualDevice top;
+		size_t ub_size;
+
+		bool Init(vdev_phys_t& vd);
+	};
+
+	struct DeviceStats
+	{
+		uint64_t reads; // requests from above
+		uint64_t ios; // requests sent to the backend
+		uint64_t merged; // requests that rode along with another one
+		uint64_t gap_bytes; // read only to bridge merged requests
+		uint64_t max_depth; // most backend requests in flight at once
+	};
+
+	// log2 buckets of microseconds, percentiles are rounded up to a power of two
+
+	class LatencyHistogram
+	{
+		enum {BUCKETS = 32};
+
+		uint64_t m_bucket[BUCKETS];
+		uint64_t m_count;
+		uint64_t m_recent; // moving average, the last few reads count the most
+
+	public:
+		LatencyHistogram();
+
+		void Reset();
+		void Add(uint64_t us);
+		uint64_t GetCount() const {return m_count;}
+		uint64_t GetPercentile(double p) const;
+		uint64_t GetRecent() const {return m_recent;}
+	};
+
+	// regions of a device that failed to read or verify, a region is not read again until its quarantine is over,
+	// the quarantine doubles with every failure and a successful read forgets the region (a verified one if it failed to verify)
+
+	struct BadExtent
+	{
+		uint64_t start;
+		uint64_t end;
+		uint32_t failures;
+		bool cksum; // read fine, but the data was wrong
+		int64_t retry_ms; // until the next attempt, 0 if it is allowed now
+	};
+
+	class BadExtentMap
+	{
+		enum {QUARANTINE_MS = 1000, MAX_DOUBLING = 10};
+
+		struct Extent
+		{
+			uint64_t end;
+			uint32_t failures;
+			bool cksum;
+			std::chrono::steady_clock::time_point until;
+		};
+
+		std::map<uint64_t, Extent> m_extents; // by start, never overlapping
+		mutable std::mutex m_lock;
+		std::atomic<size_t> m_count;
+		std::atomic<uint64_t> m_skipped;
+
+	public:
+		BadExtentMap() : m_count(0), m_skipped(0) {}
+
+		void Add(uint64_t offset, size_t size, bool cksum = false);
+		void Remove(uint64_t offset, size_t size, bool verified = false);
+		bool Contains(uint64_t offset, size_t size) const; // true while quarantined
+		void Skip() {m_skipped++;} // a read was not issued because of it
+		void Clear();
+		void GetExtents(std::vector<BadExtent>& extents) const;
+		size_t GetCount() const {return m_count;}
+		uint64_t GetSkipped() const {return m_skipped;}
+	};
+
+	class Device
+	{
+		enum {MERGE_GAP = 8 << 10, MAX_MERGE = 1 << 20};
+
+		struct Part
+		{
+			DeviceRequest* req;
+			size_t skip;
+		};
+
+		struct Pending
+		{
+			DeviceRequest io; // what the backend sees, absolute and aligned
+			uint8_t* bounce; // NULL if io goes straight into the only requester's buffer
+			std::vector<Part> parts;
+			std::vector<void*> orphans; // buffers of abandoned parts, freed when io completes
+			std::chrono::steady_clock::time_point submitted;
+		};
+
+		std::list<Pending> m_pending;
+		std::list<Pending> m_abandoned; // nobody waits for these, they are collected as they complete
+		DeviceRequest m_single;
+		size_t m_depth;
+		size_t m_inflight;
+
+		friend class IoBatch;
+
+		void Account(const DeviceRequest* req); // failed reads go to m_bad, good ones come off it
+		void Complete(Pending& p);
+		void Collect(); // completes what the backend finished
+
+		size_t m_queued; // in an IoBatch, not yet submitted
+		uint64_t m_last; // where the last read ended, for the mirror locality policy
+
+	public:
+		DeviceDesc m_desc;
+		DeviceBackend* m_backend;
+		uint64_t m_start;
+		uint64_t m_size;
+		uint64_t m_bytes;
+		vdev_label_t* m_label;
+		uberblock_t* m_active;
+		DeviceStats m_stats;
+		LatencyHistogram m_latency;
+		BadExtentMap m_bad; // offsets as passed to Read and Submit
+		size_t m_merge_gap; // requests closer than this are read together
+
+	public:
+		Device();
+		virtual ~Device();
+
+		bool Open(const wchar_t* path, uint32_t partition = 0, uint32_t flags = 0); // partition 0x0000EEPP (PP primary, EE extended, zero based index), flags DEVICE_*
+		void Close();
+
+		size_t Read(void* buff, size_t size, uint64_t offset);
+		bool BeginRead(void* buff, size_t size, uint64_t offset);
+		size_t EndRead();
+
+		bool Submit(DeviceRequest* const* reqs, size_t count);
+		bool Wait(int64_t timeout = -1);
+		void Abandon(DeviceRequest* req, void* buff);
+
+		uint8_t* Map(uint64_t offset, size_t size);
+
+		size_t GetOutstanding() const {return m_queued + m_inflight;}
+		uint64_t GetLastOffset() const {return m_last;}
+	};
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "DeviceBackend.h"
+#include "Win32Backend.h"
+#include "PosixBackend.h"
+#include "UringBackend.h"
+#include "MappedBackend.h"
+#include "BufferPool.h"
+
+namespace ZFS
+{
+	DeviceBackend* DeviceBackend::Create(uint32_t flags)
+	{
+		// the mapping goes through the page cache, direct wins when both are asked for
+
+		if((flags & DEVICE_MAPPED) && !(flags & DEVICE_DIRECT))
+		{
+			return new MappedBackend(flags);
+		}
+
+		#ifdef _WIN32
+
+		return new Win32Backend(flags);
+
+		#else
+
+		#ifdef __linux__
+
+		return new UringBackend(flags);
+
+		#else
+
+		return new PosixBackend(flags);
+
+		#endif
+
+		#endif
+	}
+
+	bool DeviceBackend::Submit(DeviceRequest* const* reqs, size_t count)
+	{
+		// one at a time, for backends without a queue
+
+		for(size_t i = 0; i < count; i++)
+		{
+			DeviceRequest* req = reqs[i];
+
+			req->result = BeginRead(req->buff, req->size, req->offset) ? EndRead() : 0;
+			req->completed = std::chrono::steady_clock::now();
+			req->done = true;
+		}
+
+		return true;
+	}
+
+	bool DeviceBackend::Wait(int64_t /*timeout*/)
+	{
+		return true;
+	}
+
+	bool DeviceBackend::WaitAny(int64_t /*timeout*/)
+	{
+		return true;
+	}
+
+	void* DeviceBackend::AllocBuffer(size_t size)
+	{
+		#if defined(__linux__)
+
+		return UringBackend::AllocBuffer(size);
+
+		#else
+
+		return BufferPool::Get().Alloc(size);
+
+		#endif
+	}
+
+	void DeviceBackend::FreeBuffer(void* buff)
+	{
+		#if defined(__linux__)
+
+		UringBackend::FreeBuffer(buff);
+
+		#else
+
+		BufferPool::Get().Free(buff);
+
+		#endif
+	}
+}
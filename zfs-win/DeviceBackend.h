@@ -0,0 +1,81 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+namespace ZFS
+{
+	enum
+	{
+		DEVICE_MAPPED = 1, // image files are memory mapped, blocks can be used in place
+		DEVICE_DIRECT = 2, // bypass the host cache, requests are aligned by Device
+	};
+
+	struct DeviceRequest
+	{
+		void* buff;
+		size_t size;
+		uint64_t offset;
+		size_t result; // bytes read, valid once done
+		bool done; // set by the backend when the request completes
+		std::chrono::steady_clock::time_point completed; // when the backend saw it complete
+	};
+
+	// raw access to an image file or a disk, Device layers the partition table and the labels on top of it
+
+	class DeviceBackend
+	{
+	public:
+		virtual ~DeviceBackend() {}
+
+		virtual bool Open(const wchar_t* path) = 0;
+		virtual void Close() = 0;
+
+		virtual uint64_t GetSize() = 0;
+
+		// offset, size and buffer alignment required by the device, 1 if anything goes
+
+		virtual size_t GetAlignment() {return 1;}
+		virtual void SetAlignment(size_t /*align*/) {}
+
+		virtual bool BeginRead(void* buff, size_t size, uint64_t offset) = 0;
+		virtual size_t EndRead() = 0;
+
+		// any number of requests can be in flight, Wait returns true when all of them completed,
+		// WaitAny when at least one did or none is left, both false if the timeout (microseconds, 
+		// negative is infinite) expired first
+
+		virtual bool Submit(DeviceRequest* const* reqs, size_t count);
+		virtual bool Wait(int64_t timeout = -1);
+		virtual bool WaitAny(int64_t timeout = -1);
+
+		// pointer into the device, stays valid until Close, NULL if the backend does not map
+
+		virtual uint8_t* Map(uint64_t /*offset*/, size_t /*size*/) {return NULL;}
+
+		static DeviceBackend* Create(uint32_t flags = 0);
+
+		// buffers from here can be read into without copying by backends registering them with the kernel
+
+		static void* AllocBuffer(size_t size);
+		static void FreeBuffer(void* buff);
+	};
+}
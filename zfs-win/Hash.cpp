@@ -1,347 +1,1217 @@
-/*
- * CDDL HEADER START
- *
- * The contents of this file are subject to the terms of the
- * Common Development and Distribution License (the "License").
- * You may not use this file except in compliance with the License.
- *
- * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
- * or http://www.opensolaris.org/os/licensing.
- * See the License for the specific language governing permissions
- * and limitations under the License.
- *
- * When distributing Covered Code, include this CDDL HEADER in each
- * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
- * If applicable, add the following below this CDDL HEADER, with the
- * fields enclosed by brackets "[]" replaced with your own identifying
- * information: Portions Copyright [yyyy] [name of copyright owner]
- *
- * CDDL HEADER END
- */
-/*
- * Copyright 2009 Sun Microsystems, Inc.  All rights reserved.
- * Use is subject to license terms.
- */
-
-/*
- * Fletcher Checksums
- * ------------------
- *
- * ZFS's 2nd and 4th order Fletcher checksums are defined by the following
- * recurrence relations:
- *
- *	a  = a    + f
- *	 i    i-1    i-1
- *
- *	b  = b    + a
- *	 i    i-1    i
- *
- *	c  = c    + b		(fletcher-4 only)
- *	 i    i-1    i
- *
- *	d  = d    + c		(fletcher-4 only)
- *	 i    i-1    i
- *
- * Where
- *	a_0 = b_0 = c_0 = d_0 = 0
- * and
- *	f_0 .. f_(n-1) are the input data.
- *
- * Using standard techniques, these translate into the following series:
- *
- *	     __n_			     __n_
- *	     \   |			     \   |
- *	a  =  >     f			b  =  >     i * f
- *	 n   /___|   n - i		 n   /___|	 n - i
- *	     i = 1			     i = 1
- *
- *
- *	     __n_			     __n_
- *	     \   |  i*(i+1)		     \   |  i*(i+1)*(i+2)
- *	c  =  >     ------- f		d  =  >     ------------- f
- *	 n   /___|     2     n - i	 n   /___|	  6	   n - i
- *	     i = 1			     i = 1
- *
- * For fletcher-2, the f_is are 64-bit, and [ab]_i are 64-bit accumulators.
- * Since the additions are done mod (2^64), errors in the high bits may not
- * be noticed.  For this reason, fletcher-2 is deprecated.
- *
- * For fletcher-4, the f_is are 32-bit, and [abcd]_i are 64-bit accumulators.
- * A conservative estimate of how big the buffer can get before we overflow
- * can be estimated using f_i = 0xffffffff for all i:
- *
- * % bc
- *  f=2^32-1;d=0; for (i = 1; d<2^64; i++) { d += f*i*(i+1)*(i+2)/6 }; (i-1)*4
- * 2264
- *  quit
- * %
- *
- * So blocks of up to 2k will not overflow.  Our largest block size is
- * 128k, which has 32k 4-byte words, so we can compute the largest possible
- * accumulators, then divide by 2^64 to figure the max amount of overflow:
- *
- * % bc
- *  a=b=c=d=0; f=2^32-1; for (i=1; i<=32*1024; i++) { a+=f; b+=a; c+=b; d+=c }
- *  a/2^64;b/2^64;c/2^64;d/2^64
- * 0
- * 0
- * 1365
- * 11186858
- *  quit
- * %
- *
- * So a and b cannot overflow.  To make sure each bit of input has some
- * effect on the contents of c and d, we can look at what the factors of
- * the coefficients in the equations for c_n and d_n are.  The number of 2s
- * in the factors determines the lowest set bit in the multiplier.  Running
- * through the cases for n*(n+1)/2 reveals that the highest power of 2 is
- * 2^14, and for n*(n+1)*(n+2)/6 it is 2^15.  So while some data may overflow
- * the 64-bit accumulators, every bit of every f_i effects every accumulator,
- * even for 128k blocks.
- *
- * If we wanted to make a stronger version of fletcher4 (fletcher4c?),
- * we could do our calculations mod (2^32 - 1) by adding in the carries
- * periodically, and store the number of carries in the top 32-bits.
- *
- * --------------------
- * Checksum Performance
- * --------------------
- *
- * There are two interesting components to checksum performance: cached and
- * uncached performance.  With cached data, fletcher-2 is about four times
- * faster than fletcher-4.  With uncached data, the performance difference is
- * negligible, since the cost of a cache fill dominates the processing time.
- * Even though fletcher-4 is slower than fletcher-2, it is still a pretty
- * efficient pass over the data.
- *
- * In normal operation, the data which is being checksummed is in a buffer
- * which has been filled either by:
- *
- *	1. a compression step, which will be mostly cached, or
- *	2. a bcopy() or copyin(), which will be uncached (because the
- *	   copy is cache-bypassing).
- *
- * For both cached and uncached data, both fletcher checksums are much faster
- * than sha-256, and slower than 'off', which doesn't touch the data at all.
- */
-
-#include "stdafx.h"
-#include "Hash.h"
-
-static void fletcher_2(const void* buf, uint64_t size, cksum_t* zcp)
-{
-	const uint64_t* ip = (const uint64_t*)buf;
-	const uint64_t* ipend = ip + (size / sizeof(uint64_t));
-
-	uint64_t a0, b0, a1, b1;
-
-	for(a0 = b0 = a1 = b1 = 0; ip < ipend; ip += 2)
-	{
-		a0 += ip[0];
-		a1 += ip[1];
-		b0 += a0;
-		b1 += a1;
-	}
-
-	zcp->set(a0, a1, b0, b1);
-}
-
-static void fletcher_2_sse2(const void* buf, uint64_t size, cksum_t* zcp) // ~25% faster
-{
-	const __m128i* p = (__m128i*)buf;
-	
-	__m128i a = _mm_setzero_si128();
-	__m128i b = _mm_setzero_si128();
-
-	for(size_t i = 0, j = (size_t)(size >> 4); i < j; i++)
-	{
-		__m128i r = _mm_load_si128(&p[i]);
-
-		a = _mm_add_epi64(a, r);
-		b = _mm_add_epi64(b, a);
-	}
-
-	zcp->set(a.m128i_u64[0], a.m128i_u64[1], b.m128i_u64[0], b.m128i_u64[1]);
-}
-
-static void fletcher_4(const void* buf, uint64_t size, cksum_t* zcp)
-{
-	const uint32_t* ip = (const uint32_t*)buf;
-	const uint32_t* ipend = ip + (size / sizeof(uint32_t));
-
-	uint64_t a, b, c, d;
-
-	for(a = b = c = d = 0; ip < ipend; ip++)
-	{
-		a += ip[0];
-		b += a;
-		c += b;
-		d += c;
-	}
-
-	zcp->set(a, b, c, d);
-}
-
-/*
-#define	Ch(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
-#define	Maj(x, y, z)	(((x) & (y)) ^ ((z) & ((x) ^ (y))))
-#define	Rot32(x, s)	(((x) >> s) | ((x) << (32 - s)))
-#define	SIGMA0(x)	(Rot32(x, 2) ^ Rot32(x, 13) ^ Rot32(x, 22))
-#define	SIGMA1(x)	(Rot32(x, 6) ^ Rot32(x, 11) ^ Rot32(x, 25))
-#define	sigma0(x)	(Rot32(x, 7) ^ Rot32(x, 18) ^ ((x) >> 3))
-#define	sigma1(x)	(Rot32(x, 17) ^ Rot32(x, 19) ^ ((x) >> 10))
-
-static const uint32_t SHA256_K[64] = {
-	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
-	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
-	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
-	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
-	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-};
-
-static void SHA256Transform(uint32_t *H, const uint8_t *cp)
-{
-	uint32_t a, b, c, d, e, f, g, h, t, T1, T2, W[64];
-
-	for (t = 0; t < 16; t++, cp += 4)
-		W[t] = (cp[0] << 24) | (cp[1] << 16) | (cp[2] << 8) | cp[3];
-
-	for (t = 16; t < 64; t++)
-		W[t] = sigma1(W[t - 2]) + W[t - 7] +
-		    sigma0(W[t - 15]) + W[t - 16];
-
-	a = H[0]; b = H[1]; c = H[2]; d = H[3];
-	e = H[4]; f = H[5]; g = H[6]; h = H[7];
-
-	for (t = 0; t < 64; t++) {
-		T1 = h + SIGMA1(e) + Ch(e, f, g) + SHA256_K[t] + W[t];
-		T2 = SIGMA0(a) + Maj(a, b, c);
-		h = g; g = f; f = e; e = d + T1;
-		d = c; c = b; b = a; a = T1 + T2;
-	}
-
-	H[0] += a; H[1] += b; H[2] += c; H[3] += d;
-	H[4] += e; H[5] += f; H[6] += g; H[7] += h;
-}
-
-static void sha256(const void *buf, uint64_t size, cksum_t *zcp)
-{
-	uint32_t H[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
-	    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
-	uint8_t pad[128];
-	int padsize = size & 63;
-	int i;
-
-	for (i = 0; i < size - padsize; i += 64)
-		SHA256Transform(H, (uint8_t *)buf + i);
-
-	for (i = 0; i < padsize; i++)
-		pad[i] = ((uint8_t *)buf)[i];
-
-	for (pad[padsize++] = 0x80; (padsize & 63) != 56; padsize++)
-		pad[padsize] = 0;
-
-	for (i = 0; i < 8; i++)
-		pad[padsize++] = (size << 3) >> (56 - 8 * i);
-
-	for (i = 0; i < padsize; i += 64)
-		SHA256Transform(H, pad + i);
-
-	zcp->set(
-		(uint64_t)H[0] << 32 | H[1],
-	    (uint64_t)H[2] << 32 | H[3],
-	    (uint64_t)H[4] << 32 | H[5],
-	    (uint64_t)H[6] << 32 | H[7]);
-}
-*/
-static void sha256(const void* buf, uint64_t size, cksum_t* zcp)
-{
-	HCRYPTPROV hCryptProv; 
-	HCRYPTHASH hHash; 
-
-	if(CryptAcquireContext(&hCryptProv, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT)) 
-	{
-		if(CryptCreateHash(hCryptProv, CALG_SHA_256, 0, 0, &hHash)) 
-		{
-			if(CryptHashData(hHash, (BYTE*)buf, (DWORD)size, 0))
-			{
-				DWORD dwHashLen = sizeof(cksum_t);
-
-				if(CryptGetHashParam(hHash, HP_HASHVAL, (BYTE*)zcp, &dwHashLen, 0))
-				{
-					zcp->word[0] = BSWAP_64(zcp->word[0]);
-					zcp->word[1] = BSWAP_64(zcp->word[1]);
-					zcp->word[2] = BSWAP_64(zcp->word[2]);
-					zcp->word[3] = BSWAP_64(zcp->word[3]);
-				}
-			}
-		}
-	}
-
-	CryptDestroyHash(hHash); 
-	CryptReleaseContext(hCryptProv, 0);
-}
-
-typedef void (*cksum_func_t)(const void* buf, uint64_t size, cksum_t* zcp);
-
-static struct cksum_func_struct
-{
-	cksum_func_t f[ZIO_CHECKSUM_FUNCTIONS];
-
-	struct cksum_func_struct()
-	{
-		f[ZIO_CHECKSUM_INHERIT] = NULL;
-		f[ZIO_CHECKSUM_ON] = fletcher_2;
-		f[ZIO_CHECKSUM_OFF] = NULL;
-		f[ZIO_CHECKSUM_LABEL] = sha256;
-		f[ZIO_CHECKSUM_GANG_HEADER] = sha256;
-		f[ZIO_CHECKSUM_ZILOG] = fletcher_2;
-		f[ZIO_CHECKSUM_FLETCHER_2] = fletcher_2;
-		f[ZIO_CHECKSUM_FLETCHER_4] = fletcher_4;
-		f[ZIO_CHECKSUM_SHA256] = sha256;
-		f[ZIO_CHECKSUM_ZILOG2] = fletcher_4;
-
-		int buff[4];
-
-		__cpuid(buff, 0x80000000);
-
-		if((DWORD)buff[0] >= 1)
-		{
-			__cpuid(buff, 1);
-
-			if(buff[3] & (1 << 26)) // SSE2
-			{
-				f[ZIO_CHECKSUM_ON] = fletcher_2_sse2;
-				f[ZIO_CHECKSUM_ZILOG] = fletcher_2_sse2;
-				f[ZIO_CHECKSUM_FLETCHER_2] = fletcher_2_sse2;
-			}
-		}
-	}
-
-} s_cksum_func;
-
-void ZFS::hash(const void* buf, uint64_t size, cksum_t* zcp, uint8_t cksum_type)
-{
-	memset(zcp, 0, sizeof(*zcp));
-
-	if(cksum_type < sizeof(s_cksum_func.f) / sizeof(s_cksum_func.f[0]))
-	{
-		cksum_func_t f = s_cksum_func.f[cksum_type];
-
-		if(f != NULL)
-		{
-			f(buf, size, zcp);
-		}
-	}
-}
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright 2009 Sun Microsystems, Inc.  All rights reserved.
+ * Use is subject to license terms.
+ */
+
+/*
+ * Fletcher Checksums
+ * ------------------
+ *
+ * ZFS's 2nd and 4th order Fletcher checksums are defined by the following
+ * recurrence relations:
+ *
+ *	a  = a    + f
+ *	 i    i-1    i-1
+ *
+ *	b  = b    + a
+ *	 i    i-1    i
+ *
+ *	c  = c    + b		(fletcher-4 only)
+ *	 i    i-1    i
+ *
+ *	d  = d    + c		(fletcher-4 only)
+ *	 i    i-1    i
+ *
+ * Where
+ *	a_0 = b_0 = c_0 = d_0 = 0
+ * and
+ *	f_0 .. f_(n-1) are the input data.
+ *
+ * Using standard techniques, these translate into the following series:
+ *
+ *	     __n_			     __n_
+ *	     \   |			     \   |
+ *	a  =  >     f			b  =  >     i * f
+ *	 n   /___|   n - i		 n   /___|	 n - i
+ *	     i = 1			     i = 1
+ *
+ *
+ *	     __n_			     __n_
+ *	     \   |  i*(i+1)		     \   |  i*(i+1)*(i+2)
+ *	c  =  >     ------- f		d  =  >     ------------- f
+ *	 n   /___|     2     n - i	 n   /___|	  6	   n - i
+ *	     i = 1			     i = 1
+ *
+ * For fletcher-2, the f_is are 64-bit, and [ab]_i are 64-bit accumulators.
+ * Since the additions are done mod (2^64), errors in the high bits may not
+ * be noticed.  For this reason, fletcher-2 is deprecated.
+ *
+ * For fletcher-4, the f_is are 32-bit, and [abcd]_i are 64-bit accumulators.
+ * A conservative estimate of how big the buffer can get before we overflow
+ * can be estimated using f_i = 0xffffffff for all i:
+ *
+ * % bc
+ *  f=2^32-1;d=0; for (i = 1; d<2^64; i++) { d += f*i*(i+1)*(i+2)/6 }; (i-1)*4
+ * 2264
+ *  quit
+ * %
+ *
+ * So blocks of up to 2k will not overflow.  Our largest block size is
+ * 128k, which has 32k 4-byte words, so we can compute the largest possible
+ * accumulators, then divide by 2^64 to figure the max amount of overflow:
+ *
+ * % bc
+ *  a=b=c=d=0; f=2^32-1; for (i=1; i<=32*1024; i++) { a+=f; b+=a; c+=b; d+=c }
+ *  a/2^64;b/2^64;c/2^64;d/2^64
+ * 0
+ * 0
+ * 1365
+ * 11186858
+ *  quit
+ * %
+ *
+ * So a and b cannot overflow.  To make sure each bit of input has some
+ * effect on the contents of c and d, we can look at what the factors of
+ * the coefficients in the equations for c_n and d_n are.  The number of 2s
+ * in the factors determines the lowest set bit in the multiplier.  Running
+ * through the cases for n*(n+1)/2 reveals that the highest power of 2 is
+ * 2^14, and for n*(n+1)*(n+2)/6 it is 2^15.  So while some data may overflow
+ * the 64-bit accumulators, every bit of every f_i effects every accumulator,
+ * even for 128k blocks.
+ *
+ * If we wanted to make a stronger version of fletcher4 (fletcher4c?),
+ * we could do our calculations mod (2^32 - 1) by adding in the carries
+ * periodically, and store the number of carries in the top 32-bits.
+ *
+ * --------------------
+ * Checksum Performance
+ * --------------------
+ *
+ * There are two interesting components to checksum performance: cached and
+ * uncached performance.  With cached data, fletcher-2 is about four times
+ * faster than fletcher-4.  With uncached data, the performance difference is
+ * negligible, since the cost of a cache fill dominates the processing time.
+ * Even though fletcher-4 is slower than fletcher-2, it is still a pretty
+ * efficient pass over the data.
+ *
+ * In normal operation, the data which is being checksummed is in a buffer
+ * which has been filled either by:
+ *
+ *	1. a compression step, which will be mostly cached, or
+ *	2. a bcopy() or copyin(), which will be uncached (because the
+ *	   copy is cache-bypassing).
+ *
+ * For both cached and uncached data, both fletcher checksums are much faster
+ * than sha-256, and slower than 'off', which doesn't touch the data at all.
+ */
+
+#include "stdafx.h"
+#include "Hash.h"
+#include "Cpu.h"
+#include "Kernel.h"
+
+static void fletcher_2(const void* buf, uint64_t size, cksum_t* zcp)
+{
+	const uint64_t* ip = (const uint64_t*)buf;
+	const uint64_t* ipend = ip + (size / sizeof(uint64_t));
+
+	uint64_t a0, b0, a1, b1;
+
+	for(a0 = b0 = a1 = b1 = 0; ip < ipend; ip += 2)
+	{
+		a0 += ip[0];
+		a1 += ip[1];
+		b0 += a0;
+		b1 += a1;
+	}
+
+	zcp->set(a0, a1, b0, b1);
+}
+
+static void fletcher_2_sse2(const void* buf, uint64_t size, cksum_t* zcp) // ~25% faster
+{
+	const __m128i* p = (__m128i*)buf;
+	
+	__m128i a = _mm_setzero_si128();
+	__m128i b = _mm_setzero_si128();
+
+	for(size_t i = 0, j = (size_t)(size >> 4); i < j; i++)
+	{
+		__m128i r = _mm_load_si128(&p[i]);
+
+		a = _mm_add_epi64(a, r);
+		b = _mm_add_epi64(b, a);
+	}
+
+	uint64_t r[4];
+
+	_mm_storeu_si128((__m128i*)&r[0], a);
+	_mm_storeu_si128((__m128i*)&r[2], b);
+
+	zcp->set(r[0], r[1], r[2], r[3]);
+}
+
+static void fletcher_4(const void* buf, uint64_t size, cksum_t* zcp)
+{
+	const uint32_t* ip = (const uint32_t*)buf;
+	const uint32_t* ipend = ip + (size / sizeof(uint32_t));
+
+	uint64_t a, b, c, d;
+
+	for(a = b = c = d = 0; ip < ipend; ip++)
+	{
+		a += ip[0];
+		b += a;
+		c += b;
+		d += c;
+	}
+
+	zcp->set(a, b, c, d);
+}
+
+/*
+ * The vector versions keep n independent fletcher-4 sums, lane j takes words j, n + j, 2n + j, ...
+ * With r the number of words a lane has seen from word i on (including it), word i = kn + j of the
+ * whole buffer is weighted by n * r - j in b, and so on, which gives back the real sums as
+ *
+ *	a = sum(a_j)
+ *	b = sum(n * b_j - j * a_j)
+ *	c = sum(n^2 * c_j - n(n + 2j - 1)/2 * b_j + j(j - 1)/2 * a_j)
+ *	d = sum(n^3 * d_j - n^2(n + j - 1) * c_j + n(n^2 + 3nj - 3n + 3j^2 - 6j + 2)/6 * b_j - j(j - 1)(j - 2)/6 * a_j)
+ *
+ * all of it modulo 2^64 like the scalar code, so the results are bit exact.
+ * Words left over at the end are added one by one.
+ */
+
+static void fletcher_4_fini(const uint64_t* a, const uint64_t* b, const uint64_t* c, const uint64_t* d, uint64_t n, const void* buf, uint64_t size, uint64_t done, cksum_t* zcp)
+{
+	uint64_t A = 0, B = 0, C = 0, D = 0;
+
+	for(uint64_t j = 0; j < n; j++)
+	{
+		A += a[j];
+		B += n * b[j] - j * a[j];
+		C += n * n * c[j] - n * (n + 2 * j - 1) / 2 * b[j] + j * (j - 1) / 2 * a[j];
+		D += n * n * n * d[j] - n * n * (n + j - 1) * c[j] + n * (n * n + 3 * n * j - 3 * n + 3 * j * j - 6 * j + 2) / 6 * b[j] - j * (j - 1) * (j - 2) / 6 * a[j];
+	}
+
+	const uint32_t* ip = (const uint32_t*)buf + done / sizeof(uint32_t);
+	const uint32_t* ipend = (const uint32_t*)buf + size / sizeof(uint32_t);
+
+	for(; ip < ipend; ip++)
+	{
+		A += ip[0];
+		B += A;
+		C += B;
+		D += C;
+	}
+
+	zcp->set(A, B, C, D);
+}
+
+TARGET("sse4.1") static void fletcher_4_sse41(const void* buf, uint64_t size, cksum_t* zcp)
+{
+	// 4 lanes, in two registers each
+
+	const __m128i* p = (const __m128i*)buf;
+
+	__m128i a0 = _mm_setzero_si128(), a1 = _mm_setzero_si128();
+	__m128i b0 = _mm_setzero_si128(), b1 = _mm_setzero_si128();
+	__m128i c0 = _mm_setzero_si128(), c1 = _mm_setzero_si128();
+	__m128i d0 = _mm_setzero_si128(), d1 = _mm_setzero_si128();
+
+	size_t count = (size_t)(size >> 4);
+
+	for(size_t i = 0; i < count; i++)
+	{
+		__m128i r = _mm_loadu_si128(&p[i]);
+
+		a0 = _mm_add_epi64(a0, _mm_cvtepu32_epi64(r));
+		a1 = _mm_add_epi64(a1, _mm_cvtepu32_epi64(_mm_srli_si128(r, 8)));
+		b0 = _mm_add_epi64(b0, a0);
+		b1 = _mm_add_epi64(b1, a1);
+		c0 = _mm_add_epi64(c0, b0);
+		c1 = _mm_add_epi64(c1, b1);
+		d0 = _mm_add_epi64(d0, c0);
+		d1 = _mm_add_epi64(d1, c1);
+	}
+
+	uint64_t a[4], b[4], c[4], d[4];
+
+	_mm_storeu_si128((__m128i*)&a[0], a0); _mm_storeu_si128((__m128i*)&a[2], a1);
+	_mm_storeu_si128((__m128i*)&b[0], b0); _mm_storeu_si128((__m128i*)&b[2], b1);
+	_mm_storeu_si128((__m128i*)&c[0], c0); _mm_storeu_si128((__m128i*)&c[2], c1);
+	_mm_storeu_si128((__m128i*)&d[0], d0); _mm_storeu_si128((__m128i*)&d[2], d1);
+
+	fletcher_4_fini(a, b, c, d, 4, buf, size, (uint64_t)count << 4, zcp);
+}
+
+#ifdef HAVE_AVX2
+
+TARGET("avx2") static void fletcher_4_avx2(const void* buf, uint64_t size, cksum_t* zcp)
+{
+	const __m128i* p = (const __m128i*)buf;
+
+	__m256i a = _mm256_setzero_si256();
+	__m256i b = _mm256_setzero_si256();
+	__m256i c = _mm256_setzero_si256();
+	__m256i d = _mm256_setzero_si256();
+
+	size_t count = (size_t)(size >> 4);
+
+	for(size_t i = 0; i < count; i++)
+	{
+		a = _mm256_add_epi64(a, _mm256_cvtepu32_epi64(_mm_loadu_si128(&p[i])));
+		b = _mm256_add_epi64(b, a);
+		c = _mm256_add_epi64(c, b);
+		d = _mm256_add_epi64(d, c);
+	}
+
+	uint64_t ra[4], rb[4], rc[4], rd[4];
+
+	_mm256_storeu_si256((__m256i*)ra, a);
+	_mm256_storeu_si256((__m256i*)rb, b);
+	_mm256_storeu_si256((__m256i*)rc, c);
+	_mm256_storeu_si256((__m256i*)rd, d);
+
+	_mm256_zeroupper();
+
+	fletcher_4_fini(ra, rb, rc, rd, 4, buf, size, (uint64_t)count << 4, zcp);
+}
+
+// two buffers of the same size side by side, the dependency chains of the sums are twice as many
+
+TARGET("avx2") static void fletcher_4_avx2_x2(const void* const* bufs, uint64_t size, cksum_t* out)
+{
+	const __m128i* p0 = (const __m128i*)bufs[0];
+	const __m128i* p1 = (const __m128i*)bufs[1];
+
+	__m256i a0 = _mm256_setzero_si256(), a1 = _mm256_setzero_si256();
+	__m256i b0 = _mm256_setzero_si256(), b1 = _mm256_setzero_si256();
+	__m256i c0 = _mm256_setzero_si256(), c1 = _mm256_setzero_si256();
+	__m256i d0 = _mm256_setzero_si256(), d1 = _mm256_setzero_si256();
+
+	size_t count = (size_t)(size >> 4);
+
+	for(size_t i = 0; i < count; i++)
+	{
+		a0 = _mm256_add_epi64(a0, _mm256_cvtepu32_epi64(_mm_loadu_si128(&p0[i])));
+		a1 = _mm256_add_epi64(a1, _mm256_cvtepu32_epi64(_mm_loadu_si128(&p1[i])));
+		b0 = _mm256_add_epi64(b0, a0);
+		b1 = _mm256_add_epi64(b1, a1);
+		c0 = _mm256_add_epi64(c0, b0);
+		c1 = _mm256_add_epi64(c1, b1);
+		d0 = _mm256_add_epi64(d0, c0);
+		d1 = _mm256_add_epi64(d1, c1);
+	}
+
+	uint64_t ra[2][4], rb[2][4], rc[2][4], rd[2][4];
+
+	_mm256_storeu_si256((__m256i*)ra[0], a0); _mm256_storeu_si256((__m256i*)ra[1], a1);
+	_mm256_storeu_si256((__m256i*)rb[0], b0); _mm256_storeu_si256((__m256i*)rb[1], b1);
+	_mm256_storeu_si256((__m256i*)rc[0], c0); _mm256_storeu_si256((__m256i*)rc[1], c1);
+	_mm256_storeu_si256((__m256i*)rd[0], d0); _mm256_storeu_si256((__m256i*)rd[1], d1);
+
+	_mm256_zeroupper();
+
+	fletcher_4_fini(ra[0], rb[0], rc[0], rd[0], 4, bufs[0], size, (uint64_t)count << 4, &out[0]);
+	fletcher_4_fini(ra[1], rb[1], rc[1], rd[1], 4, bufs[1], size, (uint64_t)count << 4, &out[1]);
+}
+
+#endif
+
+#ifdef HAVE_AVX512
+
+TARGET("avx512f") static void fletcher_4_avx512(const void* buf, uint64_t size, cksum_t* zcp)
+{
+	const __m256i* p = (const __m256i*)buf;
+
+	__m512i a = _mm512_setzero_si512();
+	__m512i b = _mm512_setzero_si512();
+	__m512i c = _mm512_setzero_si512();
+	__m512i d = _mm512_setzero_si512();
+
+	size_t count = (size_t)(size >> 5);
+
+	for(size_t i = 0; i < count; i++)
+	{
+		a = _mm512_add_epi64(a, _mm512_cvtepu32_epi64(_mm256_loadu_si256(&p[i])));
+		b = _mm512_add_epi64(b, a);
+		c = _mm512_add_epi64(c, b);
+		d = _mm512_add_epi64(d, c);
+	}
+
+	uint64_t ra[8], rb[8], rc[8], rd[8];
+
+	_mm512_storeu_si512(ra, a);
+	_mm512_storeu_si512(rb, b);
+	_mm512_storeu_si512(rc, c);
+	_mm512_storeu_si512(rd, d);
+
+	_mm256_zeroupper();
+
+	fletcher_4_fini(ra, rb, rc, rd, 8, buf, size, (uint64_t)count << 5, zcp);
+}
+
+#endif
+
+#define	Ch(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define	Maj(x, y, z)	(((x) & (y)) ^ ((z) & ((x) ^ (y))))
+#define	Rot32(x, s)	(((x) >> s) | ((x) << (32 - s)))
+#define	SIGMA0(x)	(Rot32(x, 2) ^ Rot32(x, 13) ^ Rot32(x, 22))
+#define	SIGMA1(x)	(Rot32(x, 6) ^ Rot32(x, 11) ^ Rot32(x, 25))
+#define	sigma0(x)	(Rot32(x, 7) ^ Rot32(x, 18) ^ ((x) >> 3))
+#define	sigma1(x)	(Rot32(x, 17) ^ Rot32(x, 19) ^ ((x) >> 10))
+
+static const uint32_t SHA256_K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// the 64 rounds of one block, wk[t] is the message schedule with the round constant already added
+
+static inline void SHA256Rounds(uint32_t* H, const uint32_t* wk)
+{
+	uint32_t a, b, c, d, e, f, g, h, t, T1, T2;
+
+	a = H[0]; b = H[1]; c = H[2]; d = H[3];
+	e = H[4]; f = H[5]; g = H[6]; h = H[7];
+
+	for (t = 0; t < 64; t++) {
+		T1 = h + SIGMA1(e) + Ch(e, f, g) + wk[t];
+		T2 = SIGMA0(a) + Maj(a, b, c);
+		h = g; g = f; f = e; e = d + T1;
+		d = c; c = b; b = a; a = T1 + T2;
+	}
+
+	H[0] += a; H[1] += b; H[2] += c; H[3] += d;
+	H[4] += e; H[5] += f; H[6] += g; H[7] += h;
+}
+
+static void SHA256Transform(uint32_t *H, const uint8_t *cp, size_t blocks)
+{
+	uint32_t t, W[64];
+
+	for (; blocks > 0; blocks--) {
+		for (t = 0; t < 16; t++, cp += 4)
+			W[t] = (cp[0] << 24) | (cp[1] << 16) | (cp[2] << 8) | cp[3];
+
+		for (t = 16; t < 64; t++)
+			W[t] = sigma1(W[t - 2]) + W[t - 7] +
+			    sigma0(W[t - 15]) + W[t - 16];
+
+		for (t = 0; t < 64; t++)
+			W[t] += SHA256_K[t];
+
+		SHA256Rounds(H, W);
+	}
+}
+
+// the sha extensions, two rounds per instruction, the state is kept as ABEF and CDGH
+
+#define SHA256_NI_ROUNDS(t, m) \
+	msg = _mm_add_epi32(m, _mm_loadu_si128((const __m128i*)&SHA256_K[t])); \
+	s1 = _mm_sha256rnds2_epu32(s1, s0, msg); \
+	s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(msg, 0x0e));
+
+#define SHA256_NI_SCHEDULE(next, m, prev) \
+	next = _mm_sha256msg2_epu32(_mm_add_epi32(next, _mm_alignr_epi8(m, prev, 4)), m);
+
+TARGET("sse4.1,sha") static void SHA256TransformNI(uint32_t* H, const uint8_t* cp, size_t blocks)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+	__m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&H[0]), 0xb1); // CDAB
+	__m128i s1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&H[4]), 0x1b); // EFGH
+	__m128i s0 = _mm_alignr_epi8(tmp, s1, 8); // ABEF
+	
+	s1 = _mm_blend_epi16(s1, tmp, 0xf0); // CDGH
+
+	for(; blocks > 0; blocks--, cp += 64)
+	{
+		__m128i abef = s0;
+		__m128i cdgh = s1;
+		__m128i msg;
+
+		__m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(cp + 0)), bswap);
+		__m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(cp + 16)), bswap);
+		__m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(cp + 32)), bswap);
+		__m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(cp + 48)), bswap);
+
+		SHA256_NI_ROUNDS(0, m0);
+		SHA256_NI_ROUNDS(4, m1); m0 = _mm_sha256msg1_epu32(m0, m1);
+		SHA256_NI_ROUNDS(8, m2); m1 = _mm_sha256msg1_epu32(m1, m2);
+		SHA256_NI_ROUNDS(12, m3); SHA256_NI_SCHEDULE(m0, m3, m2); m2 = _mm_sha256msg1_epu32(m2, m3);
+		SHA256_NI_ROUNDS(16, m0); SHA256_NI_SCHEDULE(m1, m0, m3); m3 = _mm_sha256msg1_epu32(m3, m0);
+		SHA256_NI_ROUNDS(20, m1); SHA256_NI_SCHEDULE(m2, m1, m0); m0 = _mm_sha256msg1_epu32(m0, m1);
+		SHA256_NI_ROUNDS(24, m2); SHA256_NI_SCHEDULE(m3, m2, m1); m1 = _mm_sha256msg1_epu32(m1, m2);
+		SHA256_NI_ROUNDS(28, m3); SHA256_NI_SCHEDULE(m0, m3, m2); m2 = _mm_sha256msg1_epu32(m2, m3);
+		SHA256_NI_ROUNDS(32, m0); SHA256_NI_SCHEDULE(m1, m0, m3); m3 = _mm_sha256msg1_epu32(m3, m0);
+		SHA256_NI_ROUNDS(36, m1); SHA256_NI_SCHEDULE(m2, m1, m0); m0 = _mm_sha256msg1_epu32(m0, m1);
+		SHA256_NI_ROUNDS(40, m2); SHA256_NI_SCHEDULE(m3, m2, m1); m1 = _mm_sha256msg1_epu32(m1, m2);
+		SHA256_NI_ROUNDS(44, m3); SHA256_NI_SCHEDULE(m0, m3, m2); m2 = _mm_sha256msg1_epu32(m2, m3);
+		SHA256_NI_ROUNDS(48, m0); SHA256_NI_SCHEDULE(m1, m0, m3); m3 = _mm_sha256msg1_epu32(m3, m0);
+		SHA256_NI_ROUNDS(52, m1); SHA256_NI_SCHEDULE(m2, m1, m0);
+		SHA256_NI_ROUNDS(56, m2); SHA256_NI_SCHEDULE(m3, m2, m1);
+		SHA256_NI_ROUNDS(60, m3);
+
+		s0 = _mm_add_epi32(s0, abef);
+		s1 = _mm_add_epi32(s1, cdgh);
+	}
+
+	tmp = _mm_shuffle_epi32(s0, 0x1b); // FEBA
+	s1 = _mm_shuffle_epi32(s1, 0xb1); // DCHG
+
+	_mm_storeu_si128((__m128i*)&H[0], _mm_blend_epi16(tmp, s1, 0xf0)); // DCBA
+	_mm_storeu_si128((__m128i*)&H[4], _mm_alignr_epi8(s1, tmp, 8)); // HGFE
+}
+
+typedef void (*sha256_transform_t)(uint32_t* H, const uint8_t* cp, size_t blocks);
+
+// one message, its whole blocks are read in place, the rest is copied next to the padding
+
+struct sha256_lane
+{
+	uint32_t H[8];
+	const uint8_t* data;
+	size_t full;
+	uint8_t pad[128];
+	size_t padded;
+
+	void init(const void* buf, uint64_t size)
+	{
+		static const uint32_t H0[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+		int padsize = size & 63;
+		int i;
+
+		memcpy(H, H0, sizeof(H));
+
+		data = (const uint8_t*)buf;
+		full = (size_t)(size >> 6);
+
+		for (i = 0; i < padsize; i++)
+			pad[i] = data[size - padsize + i];
+
+		for (pad[padsize++] = 0x80; (padsize & 63) != 56; padsize++)
+			pad[padsize] = 0;
+
+		for (i = 0; i < 8; i++)
+			pad[padsize++] = (size << 3) >> (56 - 8 * i);
+
+		padded = padsize >> 6;
+	}
+
+	const uint8_t* block(size_t i) const
+	{
+		return i < full ? data + i * 64 : pad + (i - full) * 64;
+	}
+
+	size_t blocks() const
+	{
+		return full + padded;
+	}
+
+	void finish(size_t done, sha256_transform_t transform) // from block done on
+	{
+		if(done < full)
+		{
+			transform(H, data + done * 64, full - done);
+
+			done = full;
+		}
+
+		transform(H, pad + (done - full) * 64, full + padded - done);
+	}
+
+	void get(cksum_t* zcp) const
+	{
+		zcp->set(
+			(uint64_t)H[0] << 32 | H[1],
+		    (uint64_t)H[2] << 32 | H[3],
+		    (uint64_t)H[4] << 32 | H[5],
+		    (uint64_t)H[6] << 32 | H[7]);
+	}
+};
+
+static void sha256(const void *buf, uint64_t size, cksum_t *zcp, sha256_transform_t transform)
+{
+	sha256_lane lane;
+
+	lane.init(buf, size);
+	lane.finish(0, transform);
+	lane.get(zcp);
+}
+
+/*
+ * Several messages at once, one per vector lane, each step of the rounds is done for all of them
+ * by one instruction. Blocks [begin, end) of every lane, the words of the blocks are transposed so
+ * that a register holds the same word of every message.
+ */
+
+typedef void (*sha256_transform_mb_t)(sha256_lane* const* lanes, size_t begin, size_t end);
+
+#define SHA256_MB_ROUNDS(V, ADD, XOR, AND, OR, ANDNOT, SRL, SLL, SET1) \
+	V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7]; \
+	for(int t = 0; t < 64; t++) \
+	{ \
+		if(t >= 16) \
+		{ \
+			V w2 = w[(t - 2) & 15], w15 = w[(t - 15) & 15]; \
+			V s0 = XOR(XOR(OR(SRL(w15, 7), SLL(w15, 25)), OR(SRL(w15, 18), SLL(w15, 14))), SRL(w15, 3)); \
+			V s1 = XOR(XOR(OR(SRL(w2, 17), SLL(w2, 15)), OR(SRL(w2, 19), SLL(w2, 13))), SRL(w2, 10)); \
+			w[t & 15] = ADD(ADD(w[t & 15], s0), ADD(w[(t - 7) & 15], s1)); \
+		} \
+		V S1 = XOR(XOR(OR(SRL(e, 6), SLL(e, 26)), OR(SRL(e, 11), SLL(e, 21))), OR(SRL(e, 25), SLL(e, 7))); \
+		V ch = XOR(AND(e, f), ANDNOT(e, g)); \
+		V T1 = ADD(ADD(ADD(h, S1), ADD(ch, SET1((int)SHA256_K[t]))), w[t & 15]); \
+		V S0 = XOR(XOR(OR(SRL(a, 2), SLL(a, 30)), OR(SRL(a, 13), SLL(a, 19))), OR(SRL(a, 22), SLL(a, 10))); \
+		V maj = OR(AND(a, b), AND(c, OR(a, b))); \
+		V T2 = ADD(S0, maj); \
+		h = g; g = f; f = e; e = ADD(d, T1); \
+		d = c; c = b; b = a; a = ADD(T1, T2); \
+	} \
+	s[0] = ADD(s[0], a); s[1] = ADD(s[1], b); s[2] = ADD(s[2], c); s[3] = ADD(s[3], d); \
+	s[4] = ADD(s[4], e); s[5] = ADD(s[5], f); s[6] = ADD(s[6], g); s[7] = ADD(s[7], h);
+
+static void SHA256TransformSSE2x4(sha256_lane* const* lanes, size_t begin, size_t end)
+{
+	__m128i s[8];
+
+	for(int i = 0; i < 8; i++)
+	{
+		s[i] = _mm_setr_epi32(lanes[0]->H[i], lanes[1]->H[i], lanes[2]->H[i], lanes[3]->H[i]);
+	}
+
+	for(size_t j = begin; j < end; j++)
+	{
+		__m128i w[16];
+
+		for(int k = 0; k < 4; k++)
+		{
+			__m128i r0 = _mm_loadu_si128((const __m128i*)(lanes[0]->block(j) + k * 16));
+			__m128i r1 = _mm_loadu_si128((const __m128i*)(lanes[1]->block(j) + k * 16));
+			__m128i r2 = _mm_loadu_si128((const __m128i*)(lanes[2]->block(j) + k * 16));
+			__m128i r3 = _mm_loadu_si128((const __m128i*)(lanes[3]->block(j) + k * 16));
+
+			__m128i t0 = _mm_unpacklo_epi32(r0, r1);
+			__m128i t1 = _mm_unpacklo_epi32(r2, r3);
+			__m128i t2 = _mm_unpackhi_epi32(r0, r1);
+			__m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+			w[k * 4 + 0] = _mm_unpacklo_epi64(t0, t1);
+			w[k * 4 + 1] = _mm_unpackhi_epi64(t0, t1);
+			w[k * 4 + 2] = _mm_unpacklo_epi64(t2, t3);
+			w[k * 4 + 3] = _mm_unpackhi_epi64(t2, t3);
+		}
+
+		for(int k = 0; k < 16; k++)
+		{
+			__m128i x = _mm_or_si128(_mm_slli_epi16(w[k], 8), _mm_srli_epi16(w[k], 8));
+
+			w[k] = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xb1), 0xb1);
+		}
+
+		SHA256_MB_ROUNDS(__m128i, _mm_add_epi32, _mm_xor_si128, _mm_and_si128, _mm_or_si128, _mm_andnot_si128, _mm_srli_epi32, _mm_slli_epi32, _mm_set1_epi32)
+	}
+
+	uint32_t tmp[4];
+
+	for(int i = 0; i < 8; i++)
+	{
+		_mm_storeu_si128((__m128i*)tmp, s[i]);
+
+		for(int l = 0; l < 4; l++)
+		{
+			lanes[l]->H[i] = tmp[l];
+		}
+	}
+}
+
+#ifdef HAVE_AVX2
+
+TARGET("avx2") static void SHA256TransformAVX2x8(sha256_lane* const* lanes, size_t begin, size_t end)
+{
+	const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	__m256i s[8];
+
+	for(int i = 0; i < 8; i++)
+	{
+		s[i] = _mm256_setr_epi32(lanes[0]->H[i], lanes[1]->H[i], lanes[2]->H[i], lanes[3]->H[i], lanes[4]->H[i], lanes[5]->H[i], lanes[6]->H[i], lanes[7]->H[i]);
+	}
+
+	for(size_t j = begin; j < end; j++)
+	{
+		__m256i w[16];
+
+		for(int k = 0; k < 2; k++)
+		{
+			__m256i r[8];
+
+			for(int l = 0; l < 8; l++)
+			{
+				r[l] = _mm256_loadu_si256((const __m256i*)(lanes[l]->block(j) + k * 32));
+			}
+
+			__m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+			__m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+			__m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+			__m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+			__m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+			__m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+			__m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+			__m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+			__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+			__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+			__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+			__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+			__m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+			__m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+			__m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+			__m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+			w[k * 8 + 0] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u0, u4, 0x20), bswap);
+			w[k * 8 + 1] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u1, u5, 0x20), bswap);
+			w[k * 8 + 2] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u2, u6, 0x20), bswap);
+			w[k * 8 + 3] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u3, u7, 0x20), bswap);
+			w[k * 8 + 4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u0, u4, 0x31), bswap);
+			w[k * 8 + 5] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u1, u5, 0x31), bswap);
+			w[k * 8 + 6] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u2, u6, 0x31), bswap);
+			w[k * 8 + 7] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u3, u7, 0x31), bswap);
+		}
+
+		SHA256_MB_ROUNDS(__m256i, _mm256_add_epi32, _mm256_xor_si256, _mm256_and_si256, _mm256_or_si256, _mm256_andnot_si256, _mm256_srli_epi32, _mm256_slli_epi32, _mm256_set1_epi32)
+	}
+
+	uint32_t tmp[8];
+
+	for(int i = 0; i < 8; i++)
+	{
+		_mm256_storeu_si256((__m256i*)tmp, s[i]);
+
+		for(int l = 0; l < 8; l++)
+		{
+			lanes[l]->H[i] = tmp[l];
+		}
+	}
+
+	_mm256_zeroupper();
+}
+
+#endif
+
+static void sha256_c(const void* buf, uint64_t size, cksum_t* zcp)
+{
+	sha256(buf, size, zcp, SHA256Transform);
+}
+
+static void sha256_ni(const void* buf, uint64_t size, cksum_t* zcp)
+{
+	sha256(buf, size, zcp, SHA256TransformNI);
+}
+
+class CksumKernel : public ZFS::Kernel
+{
+	uint8_t* m_buff;
+	size_t m_size;
+
+	void Prepare()
+	{
+		const std::vector<uint8_t>& data = GetTestData();
+
+		m_size = data.size();
+		m_buff = (uint8_t*)_aligned_malloc(m_size, 16); // blocks are read into aligned buffers, fletcher_2_sse2 depends on it
+
+		memcpy(m_buff, data.data(), m_size);
+	}
+
+	size_t Run(size_t index, std::vector<uint8_t>& out)
+	{
+		cksum_t sum;
+
+		m_funcs[index](m_buff, m_size, &sum);
+
+		out.assign((uint8_t*)&sum, (uint8_t*)(&sum + 1));
+
+		return m_size;
+	}
+
+	void Release()
+	{
+		_aligned_free(m_buff);
+
+		m_buff = NULL;
+	}
+
+public:
+	std::vector<ZFS::cksum_func_t> m_funcs;
+
+	CksumKernel(const char* name)
+		: ZFS::Kernel(name)
+		, m_buff(NULL)
+		, m_size(0)
+	{
+	}
+
+	void Add(const char* name, ZFS::cksum_func_t func)
+	{
+		Kernel::Add(name);
+
+		m_funcs.push_back(func);
+	}
+
+	ZFS::cksum_func_t GetFunc()
+	{
+		return m_funcs[Get()];
+	}
+};
+
+// the same checksum of several blocks at once, interleaved or one after the other, whichever is faster here
+
+typedef void (*cksum_batch_func_t)(const void* const* bufs, const uint64_t* sizes, cksum_t* out, size_t count);
+
+class BatchKernel : public ZFS::Kernel
+{
+	enum {BUFFERS = 8};
+
+	uint8_t* m_buff;
+	size_t m_size;
+
+	void Prepare()
+	{
+		const std::vector<uint8_t>& data = GetTestData();
+
+		m_size = data.size();
+		m_buff = (uint8_t*)_aligned_malloc(m_size * BUFFERS, 16);
+
+		for(size_t i = 0; i < BUFFERS; i++)
+		{
+			memcpy(m_buff + i * m_size, data.data(), m_size);
+
+			m_buff[i * m_size] ^= (uint8_t)i; // not all the same sum
+		}
+	}
+
+	size_t Run(size_t index, std::vector<uint8_t>& out)
+	{
+		const void* bufs[BUFFERS];
+		uint64_t sizes[BUFFERS];
+		cksum_t sums[BUFFERS];
+
+		for(size_t i = 0; i < BUFFERS; i++)
+		{
+			bufs[i] = m_buff + i * m_size;
+			sizes[i] = m_size;
+		}
+
+		m_funcs[index](bufs, sizes, sums, BUFFERS);
+
+		out.assign((uint8_t*)sums, (uint8_t*)(sums + BUFFERS));
+
+		return m_size * BUFFERS;
+	}
+
+	void Release()
+	{
+		_aligned_free(m_buff);
+
+		m_buff = NULL;
+	}
+
+public:
+	std::vector<cksum_batch_func_t> m_funcs;
+
+	BatchKernel(const char* name)
+		: ZFS::Kernel(name)
+		, m_buff(NULL)
+		, m_size(0)
+	{
+	}
+
+	void Add(const char* name, cksum_batch_func_t func)
+	{
+		Kernel::Add(name);
+
+		m_funcs.push_back(func);
+	}
+};
+
+static void fletcher_4_loop(const void* const* bufs, const uint64_t* sizes, cksum_t* out, size_t count);
+static void fletcher_4_pairs(const void* const* bufs, const uint64_t* sizes, cksum_t* out, size_t count);
+static void sha256_loop(const void* const* bufs, const uint64_t* sizes, cksum_t* out, size_t count);
+static void sha256_interleaved(const void* const* bufs, const uint64_t* sizes, cksum_t* out, size_t count);
+
+static struct cksum_func_struct
+{
+	CksumKernel fletcher2;
+	CksumKernel fletcher4;
+	CksumKernel sha256;
+	BatchKernel fletcher4_batch; // the first is the selected fletcher4 in a loop
+	BatchKernel sha256_batch; // the first is the selected sha256 in a loop
+	CksumKernel* k[ZIO_CHECKSUM_FUNCTIONS];
+	ZFS::cksum_impl_t impl[16];
+	size_t count;
+	sha256_transform_mb_t sha256_mb;
+	size_t sha256_lanes;
+	void (*fletcher_4_x2)(const void* const* bufs, uint64_t size, cksum_t* out);
+
+	cksum_func_struct()
+		: fletcher2("fletcher2")
+		, fletcher4("fletcher4")
+		, sha256("sha256")
+		, fletcher4_batch("fletcher4_batch")
+		, sha256_batch("sha256_batch")
+	{
+		const ZFS::Cpu& cpu = ZFS::Cpu::Get();
+
+		k[ZIO_CHECKSUM_INHERIT] = NULL;
+		k[ZIO_CHECKSUM_ON] = &fletcher2;
+		k[ZIO_CHECKSUM_OFF] = NULL;
+		k[ZIO_CHECKSUM_LABEL] = &sha256;
+		k[ZIO_CHECKSUM_GANG_HEADER] = &sha256;
+		k[ZIO_CHECKSUM_ZILOG] = &fletcher2;
+		k[ZIO_CHECKSUM_FLETCHER_2] = &fletcher2;
+		k[ZIO_CHECKSUM_FLETCHER_4] = &fletcher4;
+		k[ZIO_CHECKSUM_SHA256] = &sha256;
+		k[ZIO_CHECKSUM_ZILOG2] = &fletcher4;
+
+		count = 0;
+
+		add("scalar", ZIO_CHECKSUM_FLETCHER_2, fletcher_2);
+
+		if(cpu.sse2)
+		{
+			add("sse2", ZIO_CHECKSUM_FLETCHER_2, fletcher_2_sse2);
+		}
+
+		add("scalar", ZIO_CHECKSUM_FLETCHER_4, fletcher_4);
+
+		fletcher_4_x2 = NULL;
+
+		if(cpu.sse41)
+		{
+			add("sse4.1", ZIO_CHECKSUM_FLETCHER_4, fletcher_4_sse41);
+		}
+
+		#ifdef HAVE_AVX2
+
+		if(cpu.avx2)
+		{
+			add("avx2", ZIO_CHECKSUM_FLETCHER_4, fletcher_4_avx2);
+
+			fletcher_4_x2 = fletcher_4_avx2_x2;
+		}
+
+		#endif
+
+		#ifdef HAVE_AVX512
+
+		if(cpu.avx512f)
+		{
+			add("avx512", ZIO_CHECKSUM_FLETCHER_4, fletcher_4_avx512);
+		}
+
+		#endif
+
+		add("scalar", ZIO_CHECKSUM_SHA256, sha256_c);
+
+		sha256_mb = NULL;
+		sha256_lanes = 1;
+
+		if(cpu.sse2)
+		{
+			sha256_mb = SHA256TransformSSE2x4;
+			sha256_lanes = 4;
+		}
+
+		#ifdef HAVE_AVX2
+
+		if(cpu.avx2)
+		{
+			sha256_mb = SHA256TransformAVX2x8;
+			sha256_lanes = 8;
+		}
+
+		#endif
+
+		if(cpu.sse41 && cpu.sha)
+		{
+			add("sha-ni", ZIO_CHECKSUM_SHA256, sha256_ni);
+		}
+
+		fletcher4_batch.Add("single", fletcher_4_loop);
+
+		if(fletcher_4_x2 != NULL)
+		{
+			fletcher4_batch.Add("pairs", fletcher_4_pairs);
+		}
+
+		sha256_batch.Add("single", sha256_loop);
+
+		if(sha256_mb != NULL)
+		{
+			sha256_batch.Add("lanes", sha256_interleaved);
+		}
+	}
+
+	void add(const char* name, uint8_t cksum_type, ZFS::cksum_func_t func)
+	{
+		impl[count].name = name;
+		impl[count].cksum_type = cksum_type;
+		impl[count].func = func;
+
+		count++;
+
+		k[cksum_type]->Add(name, func);
+	}
+
+	sha256_transform_t transform(ZFS::cksum_func_t func)
+	{
+		// the single message transform of the selected sha256, what the lanes of sha256_mb finish with
+
+		return func == sha256_ni ? SHA256TransformNI : SHA256Transform;
+	}
+
+} s_cksum_func;
+
+size_t ZFS::cksum_get_impls(const cksum_impl_t** impls)
+{
+	*impls = s_cksum_func.impl;
+
+	return s_cksum_func.count;
+}
+
+const ZFS::cksum_impl_t* ZFS::cksum_get_impl(uint8_t cksum_type)
+{
+	if(cksum_type < ZIO_CHECKSUM_FUNCTIONS && s_cksum_func.k[cksum_type] != NULL)
+	{
+		CksumKernel* k = s_cksum_func.k[cksum_type];
+
+		cksum_func_t func = k->GetFunc();
+
+		for(size_t i = 0; i < s_cksum_func.count; i++)
+		{
+			if(s_cksum_func.impl[i].func == func)
+			{
+				return &s_cksum_func.impl[i];
+			}
+		}
+	}
+
+	return NULL;
+}
+
+void ZFS::hash(const void* buf, uint64_t size, cksum_t* zcp, uint8_t cksum_type)
+{
+	memset(zcp, 0, sizeof(*zcp));
+
+	if(cksum_type < ZIO_CHECKSUM_FUNCTIONS)
+	{
+		CksumKernel* k = s_cksum_func.k[cksum_type];
+
+		if(k != NULL)
+		{
+			k->GetFunc()(buf, size, zcp);
+		}
+	}
+}
+
+static void sha256_interleaved(const void* const* bufs, const uint64_t* sizes, cksum_t* out, size_t count)
+{
+	// similar sizes go together, the lanes run side by side for as many blocks as the shortest has,
+	// then each goes on alone with the single message transform of the selected sha256
+
+	sha256_transform_t transform = s_cksum_func.transform(s_cksum_func.sha256.GetFunc());
+
+	size_t n = s_cksum_func.sha256_lanes;
+
+	std::vector<size_t> order(count);
+
+	for(size_t i = 0; i < count; i++)
+	{
+		order[i] = i;
+	}
+
+	std::sort(order.begin(), order.end(), [sizes] (size_t a, size_t b) {return sizes[a] < sizes[b];});
+
+	std::vector<sha256_lane> lanes(n);
+
+	sha256_lane* ptrs[16];
+
+	for(size_t i = 0; i < count; i += n)
+	{
+		size_t m = std::min<size_t>(n, count - i);
+
+		size_t common = ~(size_t)0;
+
+		for(size_t l = 0; l < n; l++)
+		{
+			if(l < m)
+			{
+				size_t k = order[i + l];
+
+				lanes[l].init(bufs[k], sizes[k]);
+
+				common = std::min<size_t>(common, lanes[l].blocks());
+			}
+			else
+			{
+				lanes[l] = lanes[0]; // only fills the lane
+			}
+
+			ptrs[l] = &lanes[l];
+		}
+
+		if(m > 1)
+		{
+			s_cksum_func.sha256_mb(ptrs, 0, common);
+		}
+		else
+		{
+			common = 0;
+		}
+
+		for(size_t l = 0; l < m; l++)
+		{
+			lanes[l].finish(common, transform);
+			lanes[l].get(&out[order[i + l]]);
+		}
+	}
+}
+
+static void fletcher_4_loop(const void* const* bufs, const uint64_t* sizes, cksum_t* out, size_t count)
+{
+	ZFS::cksum_func_t func = s_cksum_func.fletcher4.GetFunc();
+
+	for(size_t i = 0; i < count; i++)
+	{
+		func(bufs[i], sizes[i], &out[i]);
+	}
+}
+
+static void fletcher_4_pairs(const void* const* bufs, const uint64_t* sizes, cksum_t* out, size_t count)
+{
+	// neighbours of the same size go together, the rest one by one
+
+	ZFS::cksum_func_t func = s_cksum_func.fletcher4.GetFunc();
+
+	size_t i = 0;
+
+	while(i < count)
+	{
+		if(i + 1 < count && sizes[i] == sizes[i + 1])
+		{
+			s_cksum_func.fletcher_4_x2(&bufs[i], sizes[i], &out[i]);
+
+			i += 2;
+		}
+		else
+		{
+			func(bufs[i], sizes[i], &out[i]);
+
+			i++;
+		}
+	}
+}
+
+static void sha256_loop(const void* const* bufs, const uint64_t* sizes, cksum_t* out, size_t count)
+{
+	ZFS::cksum_func_t func = s_cksum_func.sha256.GetFunc();
+
+	for(size_t i = 0; i < count; i++)
+	{
+		func(bufs[i], sizes[i], &out[i]);
+	}
+}
+
+void ZFS::hash_many(const void* const* bufs, const uint64_t* sizes, const uint8_t* types, cksum_t* out, size_t count)
+{
+	// fletcher4 and sha256 blocks are gathered and checksummed by what their batch kernels measured to be faster,
+	// interleaved or one by one, everything else goes one by one
+
+	std::vector<const void*> gathered[2];
+	std::vector<uint64_t> gathered_sizes[2];
+	std::vector<size_t> index[2];
+
+	for(size_t i = 0; i < count; i++)
+	{
+		uint8_t type = types[i];
+
+		int batch = -1;
+
+		if(type < ZIO_CHECKSUM_FUNCTIONS)
+		{
+			if(s_cksum_func.k[type] == &s_cksum_func.fletcher4) batch = 0;
+			else if(s_cksum_func.k[type] == &s_cksum_func.sha256) batch = 1;
+		}
+
+		if(batch >= 0)
+		{
+			gathered[batch].push_back(bufs[i]);
+			gathered_sizes[batch].push_back(sizes[i]);
+			index[batch].push_back(i);
+		}
+		else
+		{
+			hash(bufs[i], sizes[i], &out[i], type);
+		}
+	}
+
+	BatchKernel* kernels[2] = {&s_cksum_func.fletcher4_batch, &s_cksum_func.sha256_batch};
+
+	for(int k = 0; k < 2; k++)
+	{
+		size_t n = index[k].size();
+
+		if(n == 0)
+		{
+			continue;
+		}
+
+		std::vector<cksum_t> sums(n);
+
+		kernels[k]->m_funcs[kernels[k]->Get()](gathered[k].data(), gathered_sizes[k].data(), sums.data(), n);
+
+		for(size_t i = 0; i < n; i++)
+		{
+			out[index[k][i]] = sums[i];
+		}
+	}
+}
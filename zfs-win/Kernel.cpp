@@ -0,0 +1,322 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "Kernel.h"
+
+static std::vector<ZFS::Kernel*>& registry()
+{
+	// kernels are static objects of other files, this is constructed by the first one
+
+	static std::vector<ZFS::Kernel*> s_kernels;
+
+	return s_kernels;
+}
+
+static void parse(const char* spec, std::vector<std::pair<std::string, std::string>>& items)
+{
+	std::string s = spec != NULL ? spec : "";
+
+	size_t i = 0;
+
+	while(i < s.size())
+	{
+		size_t j = s.find(',', i);
+
+		if(j == std::string::npos) j = s.size();
+
+		std::string item = s.substr(i, j - i);
+
+		size_t k = item.find('=');
+
+		items.push_back(std::make_pair(item.substr(0, k), k != std::string::npos ? item.substr(k + 1) : std::string()));
+
+		i = j + 1;
+	}
+}
+
+namespace ZFS
+{
+	Kernel::Kernel(const char* name)
+		: m_name(name)
+		, m_selected(0)
+		, m_ready(false)
+	{
+		registry().push_back(this);
+	}
+
+	Kernel::~Kernel()
+	{
+	}
+
+	void Kernel::Add(const char* name)
+	{
+		Impl impl;
+
+		impl.name = name;
+		impl.rate = 0;
+		impl.ok = true;
+
+		m_impls.push_back(impl);
+	}
+
+	size_t Kernel::Find(const std::string& name) const
+	{
+		for(size_t i = 0; i < m_impls.size(); i++)
+		{
+			if(m_impls[i].name == name)
+			{
+				return i;
+			}
+		}
+
+		return (size_t)-1;
+	}
+
+	size_t Kernel::Fastest() const
+	{
+		size_t best = 0;
+
+		for(size_t i = 1; i < m_impls.size(); i++)
+		{
+			if(m_impls[i].ok && m_impls[i].rate > m_impls[best].rate)
+			{
+				best = i;
+			}
+		}
+
+		return best;
+	}
+
+	void Kernel::Calibrate()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if(m_ready)
+		{
+			return;
+		}
+
+		Prepare();
+
+		std::vector<uint8_t> ref;
+		std::vector<uint8_t> out;
+
+		for(size_t i = 0; i < m_impls.size(); i++)
+		{
+			Impl& impl = m_impls[i];
+
+			size_t bytes = Run(i, out);
+
+			if(i == 0)
+			{
+				ref = out;
+			}
+			else if(out != ref)
+			{
+				impl.ok = false;
+
+				printf("%s implementation %s does not agree with %s, not used\n", m_name.c_str(), impl.name.c_str(), m_impls[0].name.c_str());
+			}
+
+			// the best of a few passes, the first one above warmed up the caches
+
+			std::chrono::duration<double> best(1e9);
+			std::chrono::duration<double> total(0);
+
+			for(int n = 0; n < 3 || total.count() < 0.002; n++)
+			{
+				auto start = std::chrono::steady_clock::now();
+
+				Run(i, out);
+
+				std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+				best = std::min(best, elapsed);
+				total += elapsed;
+			}
+
+			impl.rate = best.count() > 0 ? (double)bytes / best.count() / 1e9 : 0;
+		}
+
+		Release();
+
+		if(m_forced.empty())
+		{
+			std::vector<std::pair<std::string, std::string>> items;
+
+			parse(getenv("ZFS_KERNELS"), items);
+
+			for(auto i = items.begin(); i != items.end(); i++)
+			{
+				if(i->first == m_name && i->second != "fastest")
+				{
+					m_forced = i->second;
+				}
+			}
+		}
+
+		size_t index = Fastest();
+
+		if(!m_forced.empty())
+		{
+			size_t i = Find(m_forced);
+
+			if(i < m_impls.size() && m_impls[i].ok)
+			{
+				index = i;
+			}
+			else
+			{
+				printf("%s implementation %s is not usable here, %s is used\n", m_name.c_str(), m_forced.c_str(), m_impls[index].name.c_str());
+
+				m_forced.clear();
+			}
+		}
+
+		m_selected = index;
+		m_ready.store(true, std::memory_order_release);
+	}
+
+	void Kernel::Set(size_t index)
+	{
+		Get();
+
+		if(index < m_impls.size())
+		{
+			m_selected = index;
+		}
+	}
+
+	bool Kernel::Set(const char* name)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if(strcmp(name, "fastest") == 0)
+		{
+			m_forced.clear();
+
+			if(m_ready)
+			{
+				m_selected = Fastest();
+			}
+
+			return true;
+		}
+
+		size_t i = Find(name);
+
+		if(i >= m_impls.size() || (m_ready && !m_impls[i].ok))
+		{
+			return false;
+		}
+
+		m_forced = name;
+
+		if(m_ready)
+		{
+			m_selected = i;
+		}
+
+		return true;
+	}
+
+	const std::vector<Kernel*>& Kernel::GetAll()
+	{
+		return registry();
+	}
+
+	bool Kernel::Configure(const char* spec)
+	{
+		std::vector<std::pair<std::string, std::string>> items;
+
+		parse(spec, items);
+
+		bool ok = true;
+
+		for(auto i = items.begin(); i != items.end(); i++)
+		{
+			bool found = false;
+
+			for(auto j = registry().begin(); j != registry().end(); j++)
+			{
+				if(i->first == (*j)->GetName())
+				{
+					found = (*j)->Set(i->second.c_str());
+				}
+			}
+
+			if(!found)
+			{
+				printf("no %s implementation named %s\n", i->first.c_str(), i->second.c_str());
+
+				ok = false;
+			}
+		}
+
+		return ok;
+	}
+
+	const std::vector<uint8_t>& Kernel::GetTestData()
+	{
+		// 4 KB pieces of noise, zeros, text and small numbers, something for the compressors to work on
+
+		static std::vector<uint8_t> s_data = [] ()
+		{
+			static const char* words[] = {"the ", "pool ", "block ", "of ", "data ", "is ", "read ", "from ", "disk ", "and ", "checked ", "\n"};
+
+			std::vector<uint8_t> data(128 << 10);
+
+			uint32_t seed = 1;
+
+			size_t i = 0;
+
+			while(i < data.size())
+			{
+				size_t end = i + 4096;
+
+				switch((i >> 12) & 3)
+				{
+				case 0:
+					for(; i < end; i++) {seed = seed * 1103515245 + 12345; data[i] = (uint8_t)(seed >> 16);}
+					break;
+				case 1:
+					for(; i < end; i++) data[i] = 0;
+					break;
+				case 2:
+					for(const char* w = ""; i < end; i++)
+					{
+						if(*w == 0) {seed = seed * 1103515245 + 12345; w = words[(seed >> 16) % (sizeof(words) / sizeof(words[0]))];}
+						data[i] = (uint8_t)*w++;
+					}
+					break;
+				case 3:
+					for(; i < end; i++) {seed = seed * 1103515245 + 12345; data[i] = (seed >> 28) < 6 ? 0 : (uint8_t)(seed >> 24) & 15;}
+					break;
+				}
+			}
+
+			return data;
+		}();
+
+		return s_data;
+	}
+}
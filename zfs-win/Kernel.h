@@ -0,0 +1,86 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+namespace ZFS
+{
+	// a routine with several implementations, the ones the cpu can run are timed on the first use and the fastest
+	// that gives the same results as the first is selected, ZFS_KERNELS=fletcher4=avx2,raidz=scalar in the environment
+	// or Configure picks one by name instead
+
+	class Kernel
+	{
+	public:
+		struct Impl
+		{
+			std::string name;
+			double rate; // GB/s
+			bool ok; // same output as the first
+		};
+
+	protected:
+		std::string m_name;
+		std::vector<Impl> m_impls;
+		std::string m_forced;
+		std::atomic<size_t> m_selected;
+		std::atomic<bool> m_ready;
+		std::mutex m_lock;
+
+		void Calibrate();
+		size_t Find(const std::string& name) const;
+		size_t Fastest() const;
+
+		// Prepare builds the test input once, Run makes one pass over it with an implementation, 
+		// returns the bytes processed and leaves what it computed in out to be compared
+
+		virtual void Prepare() {}
+		virtual size_t Run(size_t index, std::vector<uint8_t>& out) = 0;
+		virtual void Release() {}
+
+	public:
+		Kernel(const char* name);
+		virtual ~Kernel();
+
+		void Add(const char* name); // in the order of the owner's table, the first is the reference
+
+		size_t Get() // index of the selected implementation
+		{
+			if(!m_ready.load(std::memory_order_acquire))
+			{
+				Calibrate();
+			}
+
+			return m_selected.load(std::memory_order_relaxed);
+		}
+
+		void Set(size_t index);
+		bool Set(const char* name); // "fastest" goes back to the measured choice
+
+		const char* GetName() const {return m_name.c_str();}
+		const std::vector<Impl>& GetImpls() {Get(); return m_impls;}
+		bool IsForced() const {return !m_forced.empty();}
+
+		static const std::vector<Kernel*>& GetAll();
+		static bool Configure(const char* spec); // name=impl[,name=impl...]
+		static const std::vector<uint8_t>& GetTestData(); // 128 KB of text, zero runs and noise
+	};
+}
@@ -0,0 +1,452 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "L2Cache.h"
+#include "Hash.h"
+#include "String.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define L2CACHE_MAGIC 0x3248434c4e49575aULL // "ZWINLCH2"
+
+namespace ZFS
+{
+	L2Cache::L2Cache()
+		: m_bytes(0)
+	{
+		#ifdef _WIN32
+		m_handle = NULL;
+		#else
+		m_fd = -1;
+		#endif
+
+		memset(&m_header, 0, sizeof(m_header));
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	L2Cache::~L2Cache()
+	{
+		Close();
+	}
+
+	bool L2Cache::IsOpen() const
+	{
+		#ifdef _WIN32
+		return m_handle != NULL;
+		#else
+		return m_fd >= 0;
+		#endif
+	}
+
+	bool L2Cache::Open(const wchar_t* path, uint64_t capacity, uint64_t guid, uint64_t txg)
+	{
+		Close();
+
+		capacity &= ~(uint64_t)(ALIGN - 1);
+
+		if(capacity == 0)
+		{
+			return false;
+		}
+
+		#ifdef _WIN32
+
+		m_handle = CreateFile(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+		if(m_handle == INVALID_HANDLE_VALUE)
+		{
+			m_handle = NULL;
+
+			return false;
+		}
+
+		#else
+
+		m_fd = open(Util::UTF16To8(path).c_str(), O_RDWR | O_CREAT, 0644);
+
+		if(m_fd < 0)
+		{
+			return false;
+		}
+
+		#endif
+
+		if(!Load(guid, txg, capacity))
+		{
+			Reset(guid, capacity);
+		}
+
+		// a crash leaves the index unsaved and the file untrusted
+
+		m_header.clean = 0;
+
+		if(!WriteFile(&m_header, sizeof(m_header), 0))
+		{
+			Close();
+
+			return false;
+		}
+
+		return true;
+	}
+
+	void L2Cache::Close()
+	{
+		if(!IsOpen())
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_write_lock);
+
+			Save();
+		}
+
+		#ifdef _WIN32
+		CloseHandle(m_handle);
+		m_handle = NULL;
+		#else
+		close(m_fd);
+		m_fd = -1;
+		#endif
+
+		Drop();
+
+		memset(&m_header, 0, sizeof(m_header));
+	}
+
+	bool L2Cache::ReadFile(void* buff, size_t size, uint64_t offset)
+	{
+		#ifdef _WIN32
+
+		OVERLAPPED o;
+
+		memset(&o, 0, sizeof(o));
+
+		o.Offset = (DWORD)offset;
+		o.OffsetHigh = (DWORD)(offset >> 32);
+
+		DWORD read = 0;
+
+		return ::ReadFile(m_handle, buff, (DWORD)size, &read, &o) && read == size;
+
+		#else
+
+		return pread(m_fd, buff, size, (off_t)offset) == (ssize_t)size;
+
+		#endif
+	}
+
+	bool L2Cache::WriteFile(const void* buff, size_t size, uint64_t offset)
+	{
+		#ifdef _WIN32
+
+		OVERLAPPED o;
+
+		memset(&o, 0, sizeof(o));
+
+		o.Offset = (DWORD)offset;
+		o.OffsetHigh = (DWORD)(offset >> 32);
+
+		DWORD written = 0;
+
+		return ::WriteFile(m_handle, buff, (DWORD)size, &written, &o) && written == size;
+
+		#else
+
+		return pwrite(m_fd, buff, size, (off_t)offset) == (ssize_t)size;
+
+		#endif
+	}
+
+	bool L2Cache::Load(uint64_t guid, uint64_t txg, uint64_t capacity)
+	{
+		Header h;
+
+		if(!ReadFile(&h, sizeof(h), 0))
+		{
+			return false;
+		}
+
+		// blocks never change once written, only a rollback to an earlier txg can reuse their addresses
+
+		if(h.magic != L2CACHE_MAGIC || h.version != VERSION || h.clean == 0
+		|| h.guid != guid || h.txg > txg || h.capacity != capacity || h.head > capacity)
+		{
+			return false;
+		}
+
+		// every entry takes at least ALIGN bytes of the capacity, a count beyond that is corrupt and not allocated for
+
+		if(h.count > capacity / ALIGN)
+		{
+			return false;
+		}
+
+		std::vector<Entry> index((size_t)h.count);
+
+		if(h.count > 0 && !ReadFile(index.data(), index.size() * sizeof(Entry), HEADER_SIZE + h.capacity))
+		{
+			return false;
+		}
+
+		cksum_t c;
+
+		ZFS::hash(index.data(), index.size() * sizeof(Entry), &c, ZIO_CHECKSUM_FLETCHER_4);
+
+		if(!(c == h.cksum))
+		{
+			return false;
+		}
+
+		m_header = h;
+
+		for(auto i = index.begin(); i != index.end(); i++)
+		{
+			if(i->pos + i->size > capacity)
+			{
+				continue;
+			}
+
+			m_map[i->key] = *i;
+			m_order.push_back(std::make_pair(i->key, i->pos));
+			m_bytes += i->size;
+		}
+
+		m_stats.loaded = m_map.size();
+
+		return true;
+	}
+
+	bool L2Cache::Save()
+	{
+		std::vector<Entry> index;
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+
+			index.reserve(m_order.size());
+
+			for(auto i = m_order.begin(); i != m_order.end(); i++)
+			{
+				auto j = m_map.find(i->first);
+
+				if(j != m_map.end() && j->second.pos == i->second)
+				{
+					index.push_back(j->second);
+				}
+			}
+		}
+
+		m_header.count = index.size();
+
+		ZFS::hash(index.data(), index.size() * sizeof(Entry), &m_header.cksum, ZIO_CHECKSUM_FLETCHER_4);
+
+		if(!index.empty() && !WriteFile(index.data(), index.size() * sizeof(Entry), HEADER_SIZE + m_header.capacity))
+		{
+			return false;
+		}
+
+		m_header.clean = 1;
+
+		return WriteFile(&m_header, sizeof(m_header), 0);
+	}
+
+	void L2Cache::Reset(uint64_t guid, uint64_t capacity)
+	{
+		Drop();
+
+		memset(&m_header, 0, sizeof(m_header));
+
+		m_header.magic = L2CACHE_MAGIC;
+		m_header.version = VERSION;
+		m_header.guid = guid;
+		m_header.capacity = capacity;
+	}
+
+	void L2Cache::Drop()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		m_map.clear();
+		m_order.clear();
+		m_bytes = 0;
+	}
+
+	void L2Cache::PopOldest()
+	{
+		auto i = m_map.find(m_order.front().first);
+
+		if(i != m_map.end() && i->second.pos == m_order.front().second)
+		{
+			m_bytes -= i->second.size;
+			m_map.erase(i);
+		}
+
+		m_order.pop_front();
+	}
+
+	bool L2Cache::Contains(const BlockKey& key)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		return m_map.find(key) != m_map.end();
+	}
+
+	bool L2Cache::Write(const BlockKey& key, const uint8_t* data, size_t size, size_t lsize, uint8_t comp)
+	{
+		if(!IsOpen() || size == 0 || size > m_header.capacity / 8)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> write_lock(m_write_lock); // one writer, the ring is filled in order
+
+		Entry e;
+
+		memset(&e, 0, sizeof(e)); // padding too, the index is checksummed as stored
+
+		e.key = key;
+		e.size = (uint32_t)size;
+		e.lsize = (uint32_t)lsize;
+		e.comp = comp;
+
+		ZFS::hash(data, size, &e.cksum, ZIO_CHECKSUM_FLETCHER_4);
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+
+			if(m_map.find(key) != m_map.end())
+			{
+				return true;
+			}
+
+			size_t padded = (size + ALIGN - 1) & ~(ALIGN - 1);
+
+			if(m_header.head + padded > m_header.capacity)
+			{
+				// whatever is left from the previous round past the head is the oldest, let it go with the wrap
+
+				while(!m_order.empty() && m_order.front().second >= m_header.head)
+				{
+					PopOldest();
+				}
+
+				m_header.head = 0;
+			}
+
+			// the oldest entries are right after the head, unless the ring has not been around yet
+
+			while(!m_order.empty() && m_order.front().second >= m_header.head && m_order.front().second < m_header.head + padded)
+			{
+				PopOldest();
+			}
+
+			e.pos = m_header.head;
+
+			m_header.head += padded;
+		}
+
+		// readers of the entries just dropped may still be at it, they will see the checksum fail
+
+		if(!WriteFile(data, size, HEADER_SIZE + e.pos))
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		m_map[key] = e;
+		m_order.push_back(std::make_pair(key, e.pos));
+		m_bytes += size;
+
+		m_stats.writes++;
+
+		return true;
+	}
+
+	bool L2Cache::Read(const BlockKey& key, std::vector<uint8_t>& data, size_t& lsize, uint8_t& comp)
+	{
+		if(!IsOpen())
+		{
+			return false;
+		}
+
+		Entry e;
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+
+			auto i = m_map.find(key);
+
+			if(i == m_map.end())
+			{
+				m_stats.misses++;
+
+				return false;
+			}
+
+			e = i->second;
+		}
+
+		data.resize(e.size);
+
+		bool valid = ReadFile(data.data(), e.size, HEADER_SIZE + e.pos);
+
+		if(valid)
+		{
+			cksum_t c;
+
+			ZFS::hash(data.data(), e.size, &c, ZIO_CHECKSUM_FLETCHER_4);
+
+			valid = c == e.cksum;
+		}
+
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if(!valid)
+		{
+			auto i = m_map.find(key);
+
+			if(i != m_map.end() && i->second.pos == e.pos)
+			{
+				m_bytes -= i->second.size;
+				m_map.erase(i); // its place in m_order is skipped when it comes up
+			}
+
+			m_stats.bad++;
+
+			return false;
+		}
+
+		lsize = e.lsize;
+		comp = e.comp;
+
+		m_stats.hits++;
+
+		return true;
+	}
+}
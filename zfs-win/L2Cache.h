@@ -0,0 +1,113 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "zfs.h"
+#include "BlockCache.h"
+
+namespace ZFS
+{
+	struct L2CacheStats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t writes;
+		uint64_t bad; // stored data did not match its checksum, overwritten while read or damaged
+		uint64_t loaded; // entries found valid at startup
+	};
+
+	// second level block cache in a local file, blocks evicted from memory are appended to a ring,
+	// the index is saved on close and only trusted again for the same pool not rolled back since
+	//
+	// file: header | data ring | index
+
+	class L2Cache
+	{
+		enum {HEADER_SIZE = 4096, ALIGN = 512, VERSION = 1};
+
+		struct Header
+		{
+			uint64_t magic;
+			uint64_t version;
+			uint64_t guid; // pool
+			uint64_t txg; // pool, when the index was saved
+			uint64_t capacity; // of the data ring
+			uint64_t head; // next write in the ring
+			uint64_t count; // index entries
+			uint64_t clean; // index was saved, zeroed while the file is in use
+			cksum_t cksum; // of the index
+		};
+
+		struct Entry
+		{
+			BlockKey key;
+			uint64_t pos; // in the ring
+			uint32_t size;
+			uint32_t lsize;
+			uint8_t comp;
+			cksum_t cksum; // of the stored data
+		};
+
+		std::unordered_map<BlockKey, Entry, BlockKeyHash> m_map;
+		std::deque<std::pair<BlockKey, uint64_t>> m_order; // key and position, oldest first, stale when the entry went away
+		Header m_header;
+		uint64_t m_bytes;
+		std::mutex m_lock;
+		std::mutex m_write_lock;
+
+		#ifdef _WIN32
+		HANDLE m_handle;
+		#else
+		int m_fd;
+		#endif
+
+		bool ReadFile(void* buff, size_t size, uint64_t offset);
+		bool WriteFile(const void* buff, size_t size, uint64_t offset);
+		bool Load(uint64_t guid, uint64_t txg, uint64_t capacity);
+		bool Save();
+		void Reset(uint64_t guid, uint64_t capacity);
+		void Drop();
+		void PopOldest();
+
+	public:
+		L2CacheStats m_stats;
+
+	public:
+		L2Cache();
+		virtual ~L2Cache();
+
+		bool Open(const wchar_t* path, uint64_t capacity, uint64_t guid, uint64_t txg);
+		void Close();
+
+		bool IsOpen() const;
+		uint64_t GetCapacity() const {return m_header.capacity;}
+		uint64_t GetSize() const {return m_bytes;}
+		size_t GetCount() const {return m_map.size();}
+
+		bool Contains(const BlockKey& key);
+
+		// data is the block as the memory cache held it, compressed with comp or not
+
+		bool Write(const BlockKey& key, const uint8_t* data, size_t size, size_t lsize, uint8_t comp);
+		bool Read(const BlockKey& key, std::vector<uint8_t>& data, size_t& lsize, uint8_t& comp);
+	};
+}
@@ -0,0 +1,204 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "MappedBackend.h"
+
+#ifndef _WIN32
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#endif
+
+namespace ZFS
+{
+	MappedBackend::MappedBackend(uint32_t flags)
+		: MappedBase(flags)
+		, m_base(NULL)
+		, m_length(0)
+		#ifdef _WIN32
+		, m_mapping(NULL)
+		, m_result(0)
+		#endif
+	{
+	}
+
+	MappedBackend::~MappedBackend()
+	{
+		Close();
+	}
+
+	#ifdef _WIN32
+
+	bool MappedBackend::Open(const wchar_t* path)
+	{
+		Close();
+
+		if(!MappedBase::Open(path))
+		{
+			return false;
+		}
+
+		// disks do not map, they and images too large for the address space are read normally
+
+		if(m_size > 0 && m_size <= SIZE_MAX)
+		{
+			m_mapping = CreateFileMapping(m_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+			if(m_mapping != NULL)
+			{
+				void* p = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, (SIZE_T)m_size);
+
+				if(p != NULL)
+				{
+					m_base = (uint8_t*)p;
+					m_length = (size_t)m_size;
+				}
+				else
+				{
+					CloseHandle(m_mapping);
+
+					m_mapping = NULL;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void MappedBackend::Close()
+	{
+		if(m_base != NULL)
+		{
+			UnmapViewOfFile(m_base);
+
+			m_base = NULL;
+			m_length = 0;
+		}
+
+		if(m_mapping != NULL)
+		{
+			CloseHandle(m_mapping);
+
+			m_mapping = NULL;
+		}
+
+		MappedBase::Close();
+	}
+
+	#else
+
+	bool MappedBackend::Open(const wchar_t* path)
+	{
+		Close();
+
+		if(!MappedBase::Open(path))
+		{
+			return false;
+		}
+
+		// only regular files, block devices and images too large for the address space are read normally
+
+		struct stat st;
+
+		if(fstat(m_fd, &st) == 0 && S_ISREG(st.st_mode) && m_size > 0 && m_size <= SIZE_MAX)
+		{
+			void* p = mmap(NULL, (size_t)m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+
+			if(p != MAP_FAILED)
+			{
+				m_base = (uint8_t*)p;
+				m_length = (size_t)m_size;
+
+				madvise(m_base, m_length, MADV_WILLNEED);
+			}
+		}
+
+		return true;
+	}
+
+	void MappedBackend::Close()
+	{
+		if(m_base != NULL)
+		{
+			munmap(m_base, m_length);
+
+			m_base = NULL;
+			m_length = 0;
+		}
+
+		MappedBase::Close();
+	}
+
+	#endif
+
+	bool MappedBackend::BeginRead(void* buff, size_t size, uint64_t offset)
+	{
+		if(m_base == NULL)
+		{
+			return MappedBase::BeginRead(buff, size, offset);
+		}
+
+		m_result = 0;
+
+		if(offset < m_length)
+		{
+			m_result = (size_t)std::min<uint64_t>(size, m_length - offset);
+
+			memcpy(buff, m_base + offset, m_result);
+		}
+
+		return m_result > 0 || size == 0;
+	}
+
+	size_t MappedBackend::EndRead()
+	{
+		return m_base != NULL ? m_result : MappedBase::EndRead();
+	}
+
+	bool MappedBackend::Submit(DeviceRequest* const* reqs, size_t count)
+	{
+		// copying out of the mapping does not wait for anything, the requests are done when this returns
+
+		return m_base != NULL ? DeviceBackend::Submit(reqs, count) : MappedBase::Submit(reqs, count);
+	}
+
+	bool MappedBackend::Wait(int64_t timeout)
+	{
+		return m_base != NULL || MappedBase::Wait(timeout);
+	}
+
+	bool MappedBackend::WaitAny(int64_t timeout)
+	{
+		return m_base != NULL || MappedBase::WaitAny(timeout);
+	}
+
+	uint8_t* MappedBackend::Map(uint64_t offset, size_t size)
+	{
+		if(m_base != NULL && offset <= m_length && size <= m_length - offset)
+		{
+			return m_base + offset;
+		}
+
+		return NULL;
+	}
+}
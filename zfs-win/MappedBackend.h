@@ -0,0 +1,77 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "Win32Backend.h"
+#include "PosixBackend.h"
+#include "UringBackend.h"
+
+namespace ZFS
+{
+	// the backend DeviceBackend::Create would pick otherwise
+
+	#if defined(_WIN32)
+
+	typedef Win32Backend MappedBase;
+
+	#elif defined(__linux__)
+
+	typedef UringBackend MappedBase;
+
+	#else
+
+	typedef PosixBackend MappedBase;
+
+	#endif
+
+	// the whole image is mapped read-only, reads are served from the page cache without a syscall,
+	// what cannot be mapped (disks, images larger than the address space) is read by the base class
+
+	class MappedBackend : public MappedBase
+	{
+		uint8_t* m_base;
+		size_t m_length;
+
+		#ifdef _WIN32
+
+		HANDLE m_mapping;
+		size_t m_result;
+
+		#endif
+
+	public:
+		MappedBackend(uint32_t flags = 0);
+		virtual ~MappedBackend();
+
+		bool Open(const wchar_t* path);
+		void Close();
+
+		bool BeginRead(void* buff, size_t size, uint64_t offset);
+		size_t EndRead();
+
+		bool Submit(DeviceRequest* const* reqs, size_t count);
+		bool Wait(int64_t timeout = -1);
+		bool WaitAny(int64_t timeout = -1);
+
+		uint8_t* Map(uint64_t offset, size_t size);
+	};
+}
@@ -1,220 +1,836 @@
-/* 
- *	Copyright (C) 2010 Gabest
- *	http://code.google.com/p/zfs-win/
- *
- *  This Program is free software; you can redistribute it and/or modify
- *  it under the terms of the GNU General Public License as published by
- *  the Free Software Foundation; either version 2, or (at your option)
- *  any later version.
- *   
- *  This Program is distributed in the hope that it will be useful,
- *  but WITHOUT ANY WARRANTY; without even the implied warranty of
- *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
- *  GNU General Public License for more details.
- *   
- *  You should have received a copy of the GNU General Public License
- *  along with GNU Make; see the file COPYING.  If not, write to
- *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
- *  http://www.gnu.org/copyleft/gpl.html
- *
- */
-
-#include "stdafx.h"
-#include "Pool.h"
-#include "Hash.h"
-#include "Compress.h"
-#include "String.h"
-
-namespace ZFS
-{
-	Pool::Pool()
-		: m_guid(0)
-	{
-	}
-
-	Pool::~Pool()
-	{
-		Close();
-	}
-
-	bool Pool::Open(const std::list<std::wstring>& paths, const wchar_t* name)
-	{
-		Close();
-
-		if(name != NULL)
-		{
-			m_name = Util::UTF16To8(name);
-		}
-
-		for(auto i = paths.begin(); i != paths.end(); i++)
-		{
-			Device* dev = new Device();
-
-			if(!dev->Open(i->c_str()))
-			{
-				return false;
-			}
-
-			if(m_name.empty())
-			{
-				m_name = dev->m_desc.pool.name;
-			}
-
-			if(m_name == dev->m_desc.pool.name && (m_guid == 0 || m_guid == dev->m_desc.pool.guid))
-			{
-				m_guid = dev->m_desc.pool.guid;
-
-				m_devs.push_back(dev);
-
-				auto cmp_tree = [&] (const VirtualDevice* vdev) -> bool {return vdev->guid == dev->m_desc.top.guid;};
-
-				if(std::find_if(m_vdevs.begin(), m_vdevs.end(), cmp_tree) == m_vdevs.end())
-				{
-					m_vdevs.push_back(&dev->m_desc.top);
-				}
-			}
-			else
-			{
-				delete dev;
-			}
-		}
-
-		if(m_devs.empty())
-		{
-			return false;
-		}
-
-		for(auto i = m_vdevs.begin(); i != m_vdevs.end(); i++)
-		{
-			std::list<VirtualDevice*> leaves;
-
-			VirtualDevice* vdev = *i;
-
-			vdev->GetLeaves(leaves);
-
-			uint32_t missing = 0;
-
-			for(auto j = leaves.begin(); j != leaves.end(); j++)
-			{
-				VirtualDevice* leaf = *j;
-
-				for(auto k = m_devs.begin(); k != m_devs.end(); k++)
-				{
-					Device* dev = *k;
-
-					if(leaf->guid == dev->m_desc.guid)
-					{
-						ASSERT(vdev->guid == dev->m_desc.top_guid);
-
-						leaf->dev = dev;
-
-						break;
-					}
-				}
-
-				if(leaf->dev == NULL)
-				{
-					missing++;
-				}
-			}
-
-			if(vdev->type == "raidz" && missing <= vdev->nparity
-			|| vdev->type == "mirror" && missing < vdev->children.size()
-			|| missing == 0)
-			{
-				if(missing > 0)
-				{
-					wprintf(L"WARNING: vdev %I64d has %d missing disk(s)\n", vdev->id, missing);
-				}
-			}
-			else
-			{
-				wprintf(L"ERROR: vdev %I64d has too many (%d) missing disk(s)\n", vdev->id, missing);
-
-				return false;
-			}
-		}
-
-		return true;
-	}
-
-	void Pool::Close()
-	{
-		for(auto i = m_devs.begin(); i != m_devs.end(); i++)
-		{
-			delete *i;
-		}
-
-		m_guid = 0;
-		m_name.clear();
-		m_devs.clear();
-		m_vdevs.clear();
-	}
-
-	bool Pool::Read(uint8_t* dst, size_t size, blkptr_t* bp)
-	{
-		ASSERT(((UINT_PTR)dst & 15) == 0);
-
-		bool succeeded = false;
-
-		size_t psize = ((size_t)bp->psize + 1) << 9;
-		size_t lsize = ((size_t)bp->lsize + 1) << 9;
-
-		if(size < lsize) return false;
-
-		uint8_t* src = bp->comp_type != ZIO_COMPRESS_OFF ? (uint8_t*)_aligned_malloc(psize, 16) : NULL;
-
-		for(int i = 0; i < 3 && !succeeded; i++)
-		{
-			dva_t* addr = &bp->blk_dva[i];
-
-			ASSERT(addr->gang == 0); // TODO: zio_gbh_phys_t (not used ??? never encountered one, yet)
-
-			for(auto i = m_vdevs.begin(); i != m_vdevs.end(); i++)
-			{
-				VirtualDevice* vdev = *i;
-
-				if(vdev->id == addr->vdev)
-				{
-					BYTE* ptr = src != NULL ? src : dst;
-
-					if(vdev->Read(ptr, psize, addr->offset << 9))
-					{
-						if(Verify(ptr, psize, bp->cksum_type, bp->cksum))
-						{
-							if(ptr != src || ZFS::decompress(ptr, dst, psize, lsize, bp->comp_type))
-							{
-								succeeded = true;
-							}
-						}
-						else
-						{
-							printf("cksum error (vdev=%I64d offset=%I64d)\n", vdev->id, addr->offset << 9);
-						}
-					}
-					else
-					{
-						printf("cannot read device (vdev=%I64d offset=%I64d)\n", vdev->id, addr->offset << 9);
-					}
-
-					break;
-				}
-			}
-		}
-
-		if(src != NULL) _aligned_free(src);
-
-		return succeeded;
-	}
-
-	bool Pool::Verify(uint8_t* buff, size_t size, uint8_t cksum_type, cksum_t& cksum)
-	{
-		cksum_t c;
-
-		ZFS::hash(buff, size, &c, cksum_type);
-
-		// ASSERT(cksum == c);
-
-		return cksum == c;
-	}
-}
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "Pool.h"
+#include "ReadPipeline.h"
+#include "Hash.h"
+#include "Compress.h"
+#include "String.h"
+
+namespace ZFS
+{
+	Pool::Pool()
+		: m_guid(0)
+		, m_hedge_percentile(0.95)
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	Pool::~Pool()
+	{
+		Close();
+	}
+
+	bool Pool::Open(const std::list<std::wstring>& paths, const wchar_t* name, uint32_t flags)
+	{
+		Close();
+
+		if(name != NULL)
+		{
+			m_name = Util::UTF16To8(name);
+		}
+
+		for(auto i = paths.begin(); i != paths.end(); i++)
+		{
+			Device* dev = new Device();
+
+			if(!dev->Open(i->c_str(), 0, flags))
+			{
+				return false;
+			}
+
+			if(m_name.empty())
+			{
+				m_name = dev->m_desc.pool.name;
+			}
+
+			if(m_name == dev->m_desc.pool.name && (m_guid == 0 || m_guid == dev->m_desc.pool.guid))
+			{
+				m_guid = dev->m_desc.pool.guid;
+
+				m_devs.push_back(dev);
+
+				auto cmp_tree = [&] (const VirtualDevice* vdev) -> bool {return vdev->guid == dev->m_desc.top.guid;};
+
+				if(std::find_if(m_vdevs.begin(), m_vdevs.end(), cmp_tree) == m_vdevs.end())
+				{
+					m_vdevs.push_back(&dev->m_desc.top);
+				}
+			}
+			else
+			{
+				delete dev;
+			}
+		}
+
+		if(m_devs.empty())
+		{
+			return false;
+		}
+
+		for(auto i = m_vdevs.begin(); i != m_vdevs.end(); i++)
+		{
+			std::list<VirtualDevice*> leaves;
+
+			VirtualDevice* vdev = *i;
+
+			vdev->GetLeaves(leaves);
+
+			uint32_t missing = 0;
+
+			for(auto j = leaves.begin(); j != leaves.end(); j++)
+			{
+				VirtualDevice* leaf = *j;
+
+				for(auto k = m_devs.begin(); k != m_devs.end(); k++)
+				{
+					Device* dev = *k;
+
+					if(leaf->guid == dev->m_desc.guid)
+					{
+						ASSERT(vdev->guid == dev->m_desc.top_guid);
+
+						leaf->dev = dev;
+
+						break;
+					}
+				}
+
+				if(leaf->dev == NULL)
+				{
+					missing++;
+				}
+			}
+
+			if(vdev->type == "raidz" && missing <= vdev->nparity
+			|| vdev->type == "mirror" && missing < vdev->children.size()
+			|| missing == 0)
+			{
+				if(missing > 0)
+				{
+					wprintf(L"WARNING: vdev %lld has %d missing disk(s)\n", (long long)vdev->id, missing);
+				}
+			}
+			else
+			{
+				wprintf(L"ERROR: vdev %lld has too many (%d) missing disk(s)\n", (long long)vdev->id, missing);
+
+				return false;
+			}
+		}
+
+		for(auto i = m_vdevs.begin(); i != m_vdevs.end(); i++)
+		{
+			size_t id = (size_t)(*i)->id;
+
+			if(id >= m_vdev_table.size())
+			{
+				m_vdev_table.resize(id + 1);
+			}
+
+			m_vdev_table[id] = *i;
+		}
+
+		return true;
+	}
+
+	bool Pool::OpenL2(const wchar_t* path, uint64_t capacity)
+	{
+		uint64_t txg = 0;
+
+		for(auto i = m_devs.begin(); i != m_devs.end(); i++)
+		{
+			if((*i)->m_active != NULL)
+			{
+				txg = std::max<uint64_t>(txg, (*i)->m_active->txg);
+			}
+		}
+
+		m_cache.SetL2(NULL);
+
+		if(!m_l2.Open(path, capacity, m_guid, txg))
+		{
+			return false;
+		}
+
+		m_cache.SetL2(&m_l2);
+
+		return true;
+	}
+
+	void Pool::Close()
+	{
+		if(m_l2.IsOpen())
+		{
+			m_cache.Persist();
+			m_cache.SetL2(NULL);
+
+			m_l2.Close();
+		}
+
+		for(auto i = m_devs.begin(); i != m_devs.end(); i++)
+		{
+			delete *i;
+		}
+
+		m_guid = 0;
+		m_name.clear();
+		m_devs.clear();
+		m_vdevs.clear();
+		m_vdev_table.clear();
+	}
+
+	VirtualDevice* Pool::GetVdev(uint64_t id) const
+	{
+		return id < m_vdev_table.size() ? m_vdev_table[(size_t)id] : NULL;
+	}
+
+	int64_t Pool::GetCost(const VirtualDevice* vdev, uint64_t offset, size_t size) const
+	{
+		// how long a read would take to come back: the device's recent latency, timed per request from submission
+		// to completion, once for each request queued before it, negative if it cannot be read at all or is known to be bad there
+
+		if(vdev->children.empty())
+		{
+			Device* dev = vdev->dev;
+
+			if(dev == NULL || vdev->IsBad(offset, size))
+			{
+				return -1;
+			}
+
+			int64_t latency = dev->m_latency.GetCount() >= COST_MIN_SAMPLES ? std::max<int64_t>((int64_t)dev->m_latency.GetRecent(), 1) : (int64_t)COST_DEFAULT_US;
+
+			return latency * (1 + (int64_t)dev->GetOutstanding());
+		}
+
+		int64_t cost = -1;
+		uint64_t missing = 0;
+
+		for(auto i = vdev->children.begin(); i != vdev->children.end(); i++)
+		{
+			int64_t c = GetCost(&*i, offset, vdev->type == "mirror" ? size : 0); // raidz columns are somewhere else
+
+			if(c < 0)
+			{
+				missing++;
+			}
+			else if(vdev->type == "mirror")
+			{
+				cost = cost < 0 ? c : std::min<int64_t>(cost, c); // the best child is read
+			}
+			else
+			{
+				cost = std::max<int64_t>(cost, c); // all of them are
+			}
+		}
+
+		if(vdev->type == "raidz" && missing > 0)
+		{
+			// every column and parity is needed to reconstruct, and the cpu has to do it
+
+			cost = missing <= vdev->nparity ? cost * 2 : -1;
+		}
+
+		return cost;
+	}
+
+	int Pool::OrderCopies(const blkptr_t* bp, int order[3]) const
+	{
+		int64_t cost[3];
+
+		int count = 0;
+
+		for(int i = 0; i < 3; i++)
+		{
+			const dva_t* addr = &bp->blk_dva[i];
+
+			if(addr->asize == 0 && i > 0)
+			{
+				continue;
+			}
+
+			VirtualDevice* vdev = GetVdev(addr->vdev);
+
+			int64_t c = vdev != NULL ? GetCost(vdev, addr->offset << 9, ((size_t)bp->psize + 1) << 9) : -1;
+
+			// unreadable last, ties keep the order of the block pointer
+
+			cost[count] = c >= 0 ? c : INT64_MAX;
+			order[count] = i;
+
+			for(int j = count; j > 0 && cost[j] < cost[j - 1]; j--)
+			{
+				std::swap(cost[j], cost[j - 1]);
+				std::swap(order[j], order[j - 1]);
+			}
+
+			count++;
+		}
+
+		return count;
+	}
+
+	void Pool::SetMirrorPolicy(uint32_t policy)
+	{
+		for(auto i = m_vdevs.begin(); i != m_vdevs.end(); i++)
+		{
+			(*i)->SetPolicy(policy);
+		}
+	}
+
+	bool Pool::Read(uint8_t* dst, size_t size, blkptr_t* bp, bool streaming)
+	{
+		ReadRequest req = {dst, size, bp, false, streaming};
+
+		ReadPipeline pipeline(this);
+
+		pipeline.Submit(&req);
+
+		return pipeline.Drain();
+	}
+
+	std::shared_ptr<Pool::Flight> Pool::Join(const BlockKey& key, bool& leader)
+	{
+		std::lock_guard<std::mutex> lock(m_flight_lock);
+
+		std::shared_ptr<Flight>& flight = m_flights[key];
+
+		leader = flight == NULL;
+
+		if(leader)
+		{
+			flight = std::make_shared<Flight>();
+
+			flight->done = false;
+			flight->succeeded = false;
+			flight->waiters = 0;
+		}
+		else
+		{
+			flight->waiters++;
+
+			m_stats.collapsed++;
+		}
+
+		return flight;
+	}
+
+	void Pool::Land(const BlockKey& key, const std::shared_ptr<Flight>& flight, const uint8_t* data, size_t size, bool succeeded)
+	{
+		size_t waiters;
+
+		{
+			std::lock_guard<std::mutex> lock(m_flight_lock);
+
+			m_flights.erase(key);
+
+			waiters = flight->waiters; // nobody can join any more
+		}
+
+		// only copied when someone is waiting for it
+
+		if(waiters > 0 && succeeded)
+		{
+			flight->data.assign(data, data + size);
+		}
+
+		std::lock_guard<std::mutex> lock(m_flight_lock);
+
+		flight->succeeded = succeeded;
+		flight->done = true;
+
+		m_flight_done.notify_all();
+	}
+
+	bool Pool::Wait(const std::shared_ptr<Flight>& flight, uint8_t* dst, size_t size)
+	{
+		std::unique_lock<std::mutex> lock(m_flight_lock);
+
+		m_flight_done.wait(lock, [&] () {return flight->done;});
+
+		lock.unlock();
+
+		if(!flight->succeeded || flight->data.size() > size)
+		{
+			return false; // the caller tries itself
+		}
+
+		memcpy(dst, flight->data.data(), flight->data.size());
+
+		return true;
+	}
+
+	bool Pool::Landed(const std::shared_ptr<Flight>& flight)
+	{
+		std::lock_guard<std::mutex> lock(m_flight_lock);
+
+		return flight->done;
+	}
+
+	void Pool::Cache(const BlockKey* key, const uint8_t* src, const uint8_t* dst, blkptr_t* bp, bool streaming)
+	{
+		// the verified block as read, the cache decides whether to keep it compressed
+
+		if(key != NULL)
+		{
+			m_cache.Insert(*key, src, ((size_t)bp->psize + 1) << 9, dst, ((size_t)bp->lsize + 1) << 9, bp->comp_type, streaming);
+		}
+	}
+
+	bool Pool::ReadBlock(uint8_t* dst, size_t size, blkptr_t* bp, const BlockKey* key, bool streaming)
+	{
+		ASSERT(((UINT_PTR)dst & 15) == 0);
+
+		bool succeeded = false;
+
+		size_t psize = ((size_t)bp->psize + 1) << 9;
+		size_t lsize = ((size_t)bp->lsize + 1) << 9;
+
+		if(size < lsize) return false;
+
+		bool tried[3] = {false, false, false};
+
+		if(m_hedge_percentile > 0 && ReadHedged(dst, psize, lsize, bp, key, streaming, tried))
+		{
+			return true;
+		}
+
+		uint8_t* src = NULL;
+
+		int order[3];
+
+		int copies = OrderCopies(bp, order);
+
+		if(order[0] != 0)
+		{
+			m_stats.reordered++;
+		}
+
+		for(int i = 0; i < copies && !succeeded; i++)
+		{
+			dva_t* addr = &bp->blk_dva[order[i]];
+
+			ASSERT(addr->gang == 0); // TODO: zio_gbh_phys_t (not used ??? never encountered one, yet)
+
+			VirtualDevice* vdev = GetVdev(addr->vdev);
+
+			if(vdev == NULL)
+			{
+				continue;
+			}
+
+			if(tried[order[i]])
+			{
+				printf("cannot read a valid copy (vdev=%lld offset=%lld)\n", (long long)vdev->id, (long long)addr->offset << 9);
+
+				continue; // the hedged read went through all of it already
+			}
+
+			// verified by the vdev, so that a mirror can go on to its other children
+
+			uint8_t* mapped = vdev->Map(addr->offset << 9, psize, GetVerifier(bp));
+
+			if(mapped != NULL)
+			{
+				if(bp->comp_type == ZIO_COMPRESS_OFF)
+				{
+					memcpy(dst, mapped, psize);
+				}
+				else if(!ZFS::decompress(mapped, dst, psize, lsize, bp->comp_type))
+				{
+					continue;
+				}
+
+				Cache(key, mapped, dst, bp, streaming);
+
+				succeeded = true;
+
+				continue;
+			}
+
+			if(src == NULL && bp->comp_type != ZIO_COMPRESS_OFF)
+			{
+				src = (uint8_t*)DeviceBackend::AllocBuffer(psize);
+			}
+
+			BYTE* ptr = src != NULL ? src : dst;
+
+			if(vdev->Read(ptr, psize, addr->offset << 9, GetVerifier(bp)))
+			{
+				if(ptr != src || ZFS::decompress(ptr, dst, psize, lsize, bp->comp_type))
+				{
+					Cache(key, ptr, dst, bp, streaming);
+
+					succeeded = true;
+				}
+			}
+			else
+			{
+				printf("cannot read a valid copy (vdev=%lld offset=%lld)\n", (long long)vdev->id, (long long)addr->offset << 9);
+			}
+		}
+
+		if(src != NULL) DeviceBackend::FreeBuffer(src);
+
+		return succeeded;
+	}
+
+	bool Pool::ReadHedged(uint8_t* dst, size_t psize, size_t lsize, blkptr_t* bp, const BlockKey* key, bool streaming, bool tried[3])
+	{
+		// every single device copy of the block (ditto copies on disks, mirror children) not known to be bad is a candidate,
+		// the next one is requested when the previous did not arrive within its device's usual latency
+
+		struct Copy {Device* dev; uint64_t offset;};
+
+		std::vector<Copy> copies;
+
+		bool complete[3] = {false, false, false}; // none of its device copies was left out for being bad
+
+		std::vector<Device*> passed; // left out for being bad, skipped if another copy makes it
+
+		int order[3];
+
+		int count = OrderCopies(bp, order);
+
+		for(int i = 0; i < count; i++)
+		{
+			dva_t* addr = &bp->blk_dva[order[i]];
+
+			VirtualDevice* vdev = GetVdev(addr->vdev);
+
+			if(addr->gang != 0 || vdev == NULL)
+			{
+				continue;
+			}
+
+			uint64_t offset = (addr->offset << 9) + 0x400000;
+
+			if(vdev->type == "disk" || vdev->type == "file")
+			{
+				if(vdev->dev != NULL && !vdev->IsBad(addr->offset << 9, psize))
+				{
+					Copy c = {vdev->dev, offset};
+
+					copies.push_back(c);
+
+					complete[order[i]] = true;
+				}
+				else if(vdev->dev != NULL)
+				{
+					passed.push_back(vdev->dev);
+				}
+			}
+			else if(vdev->type == "mirror")
+			{
+				VirtualDevice* first = vdev->Select(addr->offset << 9, psize);
+
+				complete[order[i]] = first != NULL;
+
+				for(size_t k = 0; first != NULL && k < vdev->children.size(); k++)
+				{
+					VirtualDevice& child = vdev->children[(first - vdev->children.data() + k) % vdev->children.size()];
+
+					if(child.dev == NULL)
+					{
+						continue;
+					}
+
+					if(!child.IsBad(addr->offset << 9, psize))
+					{
+						Copy c = {child.dev, offset};
+
+						copies.push_back(c);
+					}
+					else
+					{
+						passed.push_back(child.dev);
+
+						complete[order[i]] = false;
+					}
+				}
+			}
+			else if(copies.empty())
+			{
+				return false; // raidz first, its columns are read by the regular path
+			}
+		}
+
+		if(copies.size() < 2 || copies[0].dev->Map(copies[0].offset, psize) != NULL)
+		{
+			return false;
+		}
+
+		struct Hedge {Device* dev; DeviceRequest req; uint8_t* buff; bool pending;};
+
+		std::vector<Hedge> hedges;
+
+		hedges.reserve(copies.size());
+
+		auto launch = [&] ()
+		{
+			Copy& c = copies[hedges.size()];
+
+			Hedge h;
+
+			h.dev = c.dev;
+			h.buff = (uint8_t*)DeviceBackend::AllocBuffer(psize);
+			h.req.buff = h.buff;
+			h.req.size = psize;
+			h.req.offset = c.offset;
+			h.req.result = 0;
+			h.pending = true;
+
+			hedges.push_back(h);
+
+			DeviceRequest* req = &hedges.back().req;
+
+			hedges.back().dev->Submit(&req, 1);
+		};
+
+		launch();
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(GetHedgeThreshold(copies[0].dev));
+
+		int winner = -1;
+
+		for(;;)
+		{
+			size_t pending = 0;
+
+			for(size_t i = 0; i < hedges.size() && winner < 0; i++)
+			{
+				Hedge& h = hedges[i];
+
+				if(h.pending)
+				{
+					h.dev->Wait(0);
+				}
+
+				if(h.pending && h.req.done)
+				{
+					h.pending = false;
+
+					if(h.req.result == psize)
+					{
+						if(Decode(h.buff, dst, psize, lsize, bp))
+						{
+							h.dev->m_bad.Remove(h.req.offset, psize, true);
+
+							Cache(key, h.buff, dst, bp, streaming);
+
+							winner = (int)i;
+						}
+						else
+						{
+							h.dev->m_bad.Add(h.req.offset, psize, true);
+						}
+					}
+				}
+
+				if(h.pending) pending++;
+			}
+
+			if(winner >= 0)
+			{
+				break;
+			}
+
+			auto now = std::chrono::steady_clock::now();
+
+			if(hedges.size() < copies.size() && (pending == 0 || now >= deadline))
+			{
+				if(pending > 0)
+				{
+					m_stats.hedged++;
+				}
+
+				launch();
+
+				deadline = now + std::chrono::microseconds(GetHedgeThreshold(hedges.back().dev));
+
+				continue;
+			}
+
+			if(pending == 0)
+			{
+				break; // all copies failed
+			}
+
+			// sleep on the newest request, in slices when there are others to look after
+
+			Hedge* h = NULL;
+
+			for(auto i = hedges.rbegin(); i != hedges.rend() && h == NULL; i++)
+			{
+				if(i->pending) h = &*i;
+			}
+
+			int64_t timeout = -1;
+
+			if(hedges.size() < copies.size())
+			{
+				timeout = std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(deadline - now).count(), 0);
+			}
+
+			if(pending > 1 && (timeout < 0 || timeout > HEDGE_SLICE_US))
+			{
+				timeout = HEDGE_SLICE_US;
+			}
+
+			h->dev->Wait(timeout); // what completed is picked up by the next round
+		}
+
+		if(winner > 0 && hedges[0].pending)
+		{
+			m_stats.hedge_wins++;
+		}
+
+		if(winner >= 0)
+		{
+			for(auto i = passed.begin(); i != passed.end(); i++)
+			{
+				(*i)->m_bad.Skip();
+			}
+		}
+
+		if(winner < 0)
+		{
+			// all of them were requested and none came back right, the caller only tries the copies left out
+
+			for(int i = 0; i < 3; i++)
+			{
+				tried[i] = complete[i];
+			}
+		}
+
+		for(auto i = hedges.begin(); i != hedges.end(); i++)
+		{
+			if(i->pending)
+			{
+				i->dev->Abandon(&i->req, i->buff);
+			}
+			else
+			{
+				DeviceBackend::FreeBuffer(i->buff);
+			}
+		}
+
+		return winner >= 0;
+	}
+
+	int64_t Pool::GetHedgeThreshold(Device* dev) const
+	{
+		if(dev->m_latency.GetCount() < HEDGE_MIN_SAMPLES)
+		{
+			return HEDGE_DEFAULT_US;
+		}
+
+		return std::max<int64_t>((int64_t)dev->m_latency.GetPercentile(m_hedge_percentile), HEDGE_MIN_US);
+	}
+
+	bool Pool::Read(ReadRequest* reqs, size_t count)
+	{
+		ReadPipeline pipeline(this);
+
+		for(size_t i = 0; i < count; i++)
+		{
+			pipeline.Submit(&reqs[i]);
+		}
+
+		return pipeline.Drain();
+	}
+
+	uint8_t* Pool::Map(blkptr_t* bp, size_t size)
+	{
+		// only uncompressed blocks can be used in place
+
+		size_t psize = ((size_t)bp->psize + 1) << 9;
+
+		if(bp->comp_type != ZIO_COMPRESS_OFF || psize < size)
+		{
+			return NULL;
+		}
+
+		for(int i = 0; i < 3; i++)
+		{
+			dva_t* addr = &bp->blk_dva[i];
+
+			if(addr->asize == 0 && i > 0)
+			{
+				continue;
+			}
+
+			VirtualDevice* vdev = GetVdev(addr->vdev);
+
+			if(addr->gang != 0 || vdev == NULL)
+			{
+				continue;
+			}
+
+			uint8_t* mapped = vdev->Map(addr->offset << 9, psize, GetVerifier(bp));
+
+			if(mapped != NULL)
+			{
+				return mapped;
+			}
+		}
+
+		return NULL;
+	}
+
+	Verifier Pool::GetVerifier(blkptr_t* bp)
+	{
+		return [bp] (const uint8_t* buff, size_t size) -> bool
+		{
+			return Verify((uint8_t*)buff, size, bp->cksum_type, bp->cksum);
+		};
+	}
+
+	bool Pool::Decode(uint8_t* src, uint8_t* dst, size_t psize, size_t lsize, blkptr_t* bp)
+	{
+		if(!Verify(src, psize, bp->cksum_type, bp->cksum))
+		{
+			return false;
+		}
+
+		if(bp->comp_type == ZIO_COMPRESS_OFF)
+		{
+			memcpy(dst, src, psize);
+
+			return true;
+		}
+
+		return ZFS::decompress(src, dst, psize, lsize, bp->comp_type);
+	}
+
+	bool Pool::Verify(uint8_t* buff, size_t size, uint8_t cksum_type, cksum_t& cksum)
+	{
+		cksum_t c;
+
+		ZFS::hash(buff, size, &c, cksum_type);
+
+		// ASSERT(cksum == c);
+
+		return cksum == c;
+	}
+}
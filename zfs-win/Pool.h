@@ -1,48 +1,116 @@
-/* 
- *	Copyright (C) 2010 Gabest
- *	http://code.google.com/p/zfs-win/
- *
- *  This Program is free software; you can redistribute it and/or modify
- *  it under the terms of the GNU General Public License as published by
- *  the Free Software Foundation; either version 2, or (at your option)
- *  any later version.
- *   
- *  This Program is distributed in the hope that it will be useful,
- *  but WITHOUT ANY WARRANTY; without even the implied warranty of
- *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
- *  GNU General Public License for more details.
- *   
- *  You should have received a copy of the GNU General Public License
- *  along with GNU Make; see the file COPYING.  If not, write to
- *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
- *  http://www.gnu.org/copyleft/gpl.html
- *
- */
-
-#pragma once
-
-#include "zfs.h"
-#include "Device.h"
-
-namespace ZFS
-{
-	class Pool
-	{
-	public:
-		uint64_t m_guid; 
-		std::string m_name;
-		std::vector<Device*> m_devs;
-		std::vector<VirtualDevice*> m_vdevs;
-
-		static bool Verify(uint8_t* buff, size_t size, uint8_t cksum_type, cksum_t& cksum);
-
-	public:
-		Pool();
-		virtual ~Pool();
-
-		bool Open(const std::list<std::wstring>& paths, const wchar_t* name = NULL);
-		void Close();
-
-		bool Read(uint8_t* buff, size_t size, blkptr_t* bp);
-	};
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "zfs.h"
+#include "Device.h"
+#include "BlockCache.h"
+#include "L2Cache.h"
+
+namespace ZFS
+{
+	struct PoolStats
+	{
+		uint64_t hedged; // another copy was requested because the first one was late
+		uint64_t hedge_wins; // and the other copy arrived first
+		uint64_t collapsed; // waited for the same block being read by someone else
+		uint64_t reordered; // another copy than the first one looked faster
+	};
+
+	class Pool
+	{
+		enum {HEDGE_MIN_SAMPLES = 32, HEDGE_MIN_US = 200, HEDGE_DEFAULT_US = 20000, HEDGE_SLICE_US = 500};
+		enum {MAX_STRIPE = 16 << 20}; // raidz blocks read together, at most this much allocated size
+		enum {COST_DEFAULT_US = 1000, COST_MIN_SAMPLES = 8}; // a device not timed enough yet is assumed to take this long
+
+		std::vector<VirtualDevice*> m_vdev_table; // by id, NULL where missing
+
+		bool ReadBlock(uint8_t* dst, size_t size, blkptr_t* bp, const BlockKey* key = NULL, bool streaming = false);
+		bool ReadHedged(uint8_t* dst, size_t psize, size_t lsize, blkptr_t* bp, const BlockKey* key, bool streaming, bool tried[3]); // tried: every device copy of that dva was read and failed
+		void Cache(const BlockKey* key, const uint8_t* src, const uint8_t* dst, blkptr_t* bp, bool streaming);
+		int64_t GetHedgeThreshold(Device* dev) const;
+
+		// one read of a block at a time, who asks for it meanwhile waits for that and gets a copy
+
+		struct Flight
+		{
+			bool done;
+			bool succeeded;
+			size_t waiters;
+			std::vector<uint8_t> data;
+		};
+
+		std::unordered_map<BlockKey, std::shared_ptr<Flight>, BlockKeyHash> m_flights;
+		std::mutex m_flight_lock;
+		std::condition_variable m_flight_done;
+
+		std::mutex m_io_lock; // devices serve one reader at a time, waiting for a flight is done outside of it
+
+		std::shared_ptr<Flight> Join(const BlockKey& key, bool& leader);
+		void Land(const BlockKey& key, const std::shared_ptr<Flight>& flight, const uint8_t* data, size_t size, bool succeeded);
+		bool Wait(const std::shared_ptr<Flight>& flight, uint8_t* dst, size_t size);
+		bool Landed(const std::shared_ptr<Flight>& flight);
+
+		friend class ReadPipeline;
+
+	public:
+		struct ReadRequest
+		{
+			uint8_t* buff;
+			size_t size;
+			blkptr_t* bp;
+			bool done;
+			bool streaming; // part of a long sequential read, cached at low priority
+		};
+
+	public:
+		uint64_t m_guid; 
+		std::string m_name;
+		std::vector<Device*> m_devs;
+		std::vector<VirtualDevice*> m_vdevs;
+		PoolStats m_stats;
+		BlockCache m_cache;
+		L2Cache m_l2;
+		double m_hedge_percentile; // latency percentile of a device after which another copy is tried, 0 turns hedging off
+
+		static bool Verify(uint8_t* buff, size_t size, uint8_t cksum_type, cksum_t& cksum);
+		static Verifier GetVerifier(blkptr_t* bp);
+		static bool Decode(uint8_t* src, uint8_t* dst, size_t psize, size_t lsize, blkptr_t* bp);
+
+	public:
+		Pool();
+		virtual ~Pool();
+
+		bool Open(const std::list<std::wstring>& paths, const wchar_t* name = NULL, uint32_t flags = 0);
+		void Close();
+
+		bool OpenL2(const wchar_t* path, uint64_t capacity); // after Open, the pool guid and txg validate what the file holds
+
+		bool Read(uint8_t* buff, size_t size, blkptr_t* bp, bool streaming = false);
+		bool Read(ReadRequest* reqs, size_t count);
+		void SetMirrorPolicy(uint32_t policy);
+		uint8_t* Map(blkptr_t* bp, size_t size);
+		VirtualDevice* GetVdev(uint64_t id) const;
+		int64_t GetCost(const VirtualDevice* vdev, uint64_t offset, size_t size) const; // expected microseconds to read, negative if it cannot be
+		int OrderCopies(const blkptr_t* bp, int order[3]) const; // dva indices, the one expected to be read fastest first
+	};
 }
\ No newline at end of file
@@ -0,0 +1,167 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+// Win32 types and CRT functions used by the core library, mapped onto POSIX
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <limits.h>
+#include <ctype.h>
+#include <wchar.h>
+#include <wctype.h>
+
+typedef uint8_t BYTE;
+typedef uint32_t DWORD;
+typedef uintptr_t UINT_PTR;
+typedef wchar_t WCHAR;
+typedef const char* LPCSTR;
+typedef const wchar_t* LPCWSTR;
+typedef wchar_t _TCHAR;
+
+#define _tmain wmain
+
+#define wcsicmp wcscasecmp
+#define stricmp strcasecmp
+
+inline void* _aligned_malloc(size_t size, size_t alignment)
+{
+	void* p = NULL;
+
+	return posix_memalign(&p, std::max<size_t>(alignment, sizeof(void*)), size) == 0 ? p : NULL;
+}
+
+inline void _aligned_free(void* p)
+{
+	free(p);
+}
+
+inline void __cpuid(int info[4], int level)
+{
+	__asm__ __volatile__("cpuid" : "=a"(info[0]), "=b"(info[1]), "=c"(info[2]), "=d"(info[3]) : "a"(level), "c"(0));
+}
+
+inline void __cpuidex(int info[4], int level, int sublevel)
+{
+	__asm__ __volatile__("cpuid" : "=a"(info[0]), "=b"(info[1]), "=c"(info[2]), "=d"(info[3]) : "a"(level), "c"(sublevel));
+}
+
+inline int _vscprintf(const char* fmt, va_list args)
+{
+	return vsnprintf(NULL, 0, fmt, args);
+}
+
+inline int _vscwprintf(const wchar_t* fmt, va_list args)
+{
+	// vswprintf cannot measure, grow the buffer until it fits
+
+	for(size_t size = 256; size <= 0x100000; size <<= 1)
+	{
+		wchar_t* buff = new wchar_t[size];
+
+		va_list tmp;
+		va_copy(tmp, args);
+
+		int len = vswprintf(buff, size, fmt, tmp);
+
+		va_end(tmp);
+
+		delete [] buff;
+
+		if(len >= 0)
+		{
+			return len;
+		}
+	}
+
+	return -1;
+}
+
+#define vsprintf_s vsnprintf
+#define vswprintf_s vswprintf
+
+inline int _wprintf_utf8(const wchar_t* fmt, ...)
+{
+	// stdout cannot be both byte and wide oriented, convert and print it as utf-8 like printf does
+
+	va_list args;
+	va_start(args, fmt);
+
+	int len = _vscwprintf(fmt, args);
+
+	if(len >= 0)
+	{
+		wchar_t* buff = new wchar_t[len + 1];
+
+		vswprintf(buff, len + 1, fmt, args);
+
+		for(int i = 0; i < len; i++)
+		{
+			uint32_t c = (uint32_t)buff[i];
+
+			if(c < 0x80) {putchar(c);}
+			else if(c < 0x800) {putchar(0xc0 | (c >> 6)); putchar(0x80 | (c & 0x3f));}
+			else if(c < 0x10000) {putchar(0xe0 | (c >> 12)); putchar(0x80 | ((c >> 6) & 0x3f)); putchar(0x80 | (c & 0x3f));}
+			else {putchar(0xf0 | (c >> 18)); putchar(0x80 | ((c >> 12) & 0x3f)); putchar(0x80 | ((c >> 6) & 0x3f)); putchar(0x80 | (c & 0x3f));}
+		}
+
+		delete [] buff;
+	}
+
+	va_end(args);
+
+	return len;
+}
+
+#define wprintf _wprintf_utf8
+
+inline char* strupr(char* s)
+{
+	for(char* p = s; *p; p++) *p = (char)toupper((unsigned char)*p);
+
+	return s;
+}
+
+inline char* strlwr(char* s)
+{
+	for(char* p = s; *p; p++) *p = (char)tolower((unsigned char)*p);
+
+	return s;
+}
+
+inline wchar_t* _wcsupr(wchar_t* s)
+{
+	for(wchar_t* p = s; *p; p++) *p = (wchar_t)towupper(*p);
+
+	return s;
+}
+
+inline wchar_t* _wcslwr(wchar_t* s)
+{
+	for(wchar_t* p = s; *p; p++) *p = (wchar_t)towlower(*p);
+
+	return s;
+}
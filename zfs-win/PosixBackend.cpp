@@ -0,0 +1,207 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "PosixBackend.h"
+#include "String.h"
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+namespace ZFS
+{
+	PosixBackend::PosixBackend(uint32_t flags)
+		: m_flags(flags)
+		, m_fd(-1)
+		, m_size(0)
+		, m_align(1)
+		, m_result(0)
+	{
+	}
+
+	PosixBackend::~PosixBackend()
+	{
+		Close();
+	}
+
+	bool PosixBackend::Open(const wchar_t* path)
+	{
+		Close();
+
+		std::string s = Util::UTF16To8(path);
+
+		m_fd = open(s.c_str(), O_RDONLY);
+
+		if(m_fd < 0)
+		{
+			return false;
+		}
+
+		// works for block devices too, st_size is zero for those
+
+		off_t size = lseek(m_fd, 0, SEEK_END);
+
+		m_size = size > 0 ? (uint64_t)size : 0;
+
+		if(m_flags & DEVICE_DIRECT)
+		{
+			// the logical sector size for disks, files are assumed to sit on 4k sectors
+
+			m_align = 4096;
+
+			#ifdef BLKSSZGET
+
+			struct stat st;
+			int sector = 0;
+
+			if(fstat(m_fd, &st) == 0 && S_ISBLK(st.st_mode) && ioctl(m_fd, BLKSSZGET, &sector) == 0 && sector > 0)
+			{
+				m_align = (size_t)sector;
+			}
+
+			#endif
+
+			#ifdef O_DIRECT
+
+			if(fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_DIRECT) == 0)
+			{
+				return true;
+			}
+
+			#elif defined(F_NOCACHE)
+
+			if(fcntl(m_fd, F_NOCACHE, 1) == 0)
+			{
+				return true;
+			}
+
+			#endif
+
+			m_align = 1;
+		}
+
+		#ifdef POSIX_FADV_SEQUENTIAL
+
+		posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+		#endif
+
+		return true;
+	}
+
+	void PosixBackend::SetAlignment(size_t align)
+	{
+		if(m_align > 1 && align > m_align)
+		{
+			m_align = align;
+		}
+	}
+
+	bool PosixBackend::DisableDirect()
+	{
+		// the filesystem does not like our alignment after all, go through the cache from now on
+
+		if(m_align <= 1)
+		{
+			return false;
+		}
+
+		#ifdef O_DIRECT
+
+		fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) & ~O_DIRECT);
+
+		#elif defined(F_NOCACHE)
+
+		fcntl(m_fd, F_NOCACHE, 0);
+
+		#endif
+
+		m_align = 1;
+
+		return true;
+	}
+
+	void PosixBackend::Close()
+	{
+		if(m_fd >= 0)
+		{
+			close(m_fd);
+
+			m_fd = -1;
+		}
+
+		m_size = 0;
+		m_align = 1;
+		m_result = 0;
+	}
+
+	bool PosixBackend::BeginRead(void* buff, size_t size, uint64_t offset)
+	{
+		// pread is synchronous, the result is kept until EndRead
+
+		uint8_t* ptr = (uint8_t*)buff;
+
+		m_result = 0;
+
+		while(m_result < size)
+		{
+			ssize_t n = pread(m_fd, ptr + m_result, size - m_result, (off_t)(offset + m_result));
+
+			if(n < 0)
+			{
+				if(errno == EINTR) continue;
+
+				if(errno == EINVAL && DisableDirect()) continue;
+
+				return false;
+			}
+
+			if(n == 0)
+			{
+				break;
+			}
+
+			m_result += (size_t)n;
+		}
+
+		return m_result > 0 || size == 0;
+	}
+
+	size_t PosixBackend::EndRead()
+	{
+		size_t size = m_result;
+
+		m_result = 0;
+
+		return size;
+	}
+}
+
+#endif
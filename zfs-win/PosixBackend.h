@@ -0,0 +1,58 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "DeviceBackend.h"
+
+#ifndef _WIN32
+
+namespace ZFS
+{
+	class PosixBackend : public DeviceBackend
+	{
+	protected:
+		uint32_t m_flags;
+		int m_fd;
+		uint64_t m_size;
+		size_t m_align;
+		size_t m_result;
+
+		bool DisableDirect();
+
+	public:
+		PosixBackend(uint32_t flags = 0);
+		virtual ~PosixBackend();
+
+		bool Open(const wchar_t* path);
+		void Close();
+
+		uint64_t GetSize() {return m_size;}
+
+		size_t GetAlignment() {return m_align;}
+		void SetAlignment(size_t align);
+
+		bool BeginRead(void* buff, size_t size, uint64_t offset);
+		size_t EndRead();
+	};
+}
+
+#endif
@@ -0,0 +1,578 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "Raidz.h"
+#include "Cpu.h"
+#include "Kernel.h"
+
+// GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1 and generator 2, as the parity columns are generated
+
+static struct gf_tables
+{
+	uint8_t exp[512];
+	uint8_t log[256];
+	uint8_t nibble[256][32]; // c * low nibble, c * high nibble, for table lookup multiplication
+
+	gf_tables()
+	{
+		uint32_t x = 1;
+
+		for(int i = 0; i < 255; i++)
+		{
+			exp[i] = exp[i + 255] = (uint8_t)x;
+			log[x] = (uint8_t)i;
+
+			x <<= 1;
+
+			if(x & 0x100)
+			{
+				x ^= 0x11d;
+			}
+		}
+
+		exp[510] = exp[511] = exp[0];
+		log[0] = 0;
+
+		for(int c = 0; c < 256; c++)
+		{
+			for(int i = 0; i < 16; i++)
+			{
+				nibble[c][i] = mul((uint8_t)c, (uint8_t)i);
+				nibble[c][i + 16] = mul((uint8_t)c, (uint8_t)(i << 4));
+			}
+		}
+	}
+
+	uint8_t mul(uint8_t a, uint8_t b) const
+	{
+		return a != 0 && b != 0 ? exp[log[a] + log[b]] : 0;
+	}
+
+	uint8_t pow(uint8_t a, uint32_t e) const
+	{
+		return e == 0 ? 1 : a != 0 ? exp[(log[a] * e) % 255] : 0;
+	}
+
+	uint8_t inv(uint8_t a) const
+	{
+		return exp[255 - log[a]];
+	}
+
+} s_gf;
+
+static void raidz_xor_c(uint8_t* dst, const uint8_t* src, size_t size)
+{
+	size_t i = 0;
+
+	for(; i + 8 <= size; i += 8)
+	{
+		*(uint64_t*)&dst[i] ^= *(const uint64_t*)&src[i];
+	}
+
+	for(; i < size; i++)
+	{
+		dst[i] ^= src[i];
+	}
+}
+
+static void raidz_xor_sse2(uint8_t* dst, const uint8_t* src, size_t size)
+{
+	size_t i = 0;
+
+	for(; i + 64 <= size; i += 64)
+	{
+		__m128i d0 = _mm_loadu_si128((__m128i*)&dst[i + 0]);
+		__m128i d1 = _mm_loadu_si128((__m128i*)&dst[i + 16]);
+		__m128i d2 = _mm_loadu_si128((__m128i*)&dst[i + 32]);
+		__m128i d3 = _mm_loadu_si128((__m128i*)&dst[i + 48]);
+
+		d0 = _mm_xor_si128(d0, _mm_loadu_si128((const __m128i*)&src[i + 0]));
+		d1 = _mm_xor_si128(d1, _mm_loadu_si128((const __m128i*)&src[i + 16]));
+		d2 = _mm_xor_si128(d2, _mm_loadu_si128((const __m128i*)&src[i + 32]));
+		d3 = _mm_xor_si128(d3, _mm_loadu_si128((const __m128i*)&src[i + 48]));
+
+		_mm_storeu_si128((__m128i*)&dst[i + 0], d0);
+		_mm_storeu_si128((__m128i*)&dst[i + 16], d1);
+		_mm_storeu_si128((__m128i*)&dst[i + 32], d2);
+		_mm_storeu_si128((__m128i*)&dst[i + 48], d3);
+	}
+
+	raidz_xor_c(&dst[i], &src[i], size - i);
+}
+
+#ifdef HAVE_AVX2
+
+TARGET("avx2") static void raidz_xor_avx2(uint8_t* dst, const uint8_t* src, size_t size)
+{
+	size_t i = 0;
+
+	for(; i + 128 <= size; i += 128)
+	{
+		__m256i d0 = _mm256_loadu_si256((__m256i*)&dst[i + 0]);
+		__m256i d1 = _mm256_loadu_si256((__m256i*)&dst[i + 32]);
+		__m256i d2 = _mm256_loadu_si256((__m256i*)&dst[i + 64]);
+		__m256i d3 = _mm256_loadu_si256((__m256i*)&dst[i + 96]);
+
+		d0 = _mm256_xor_si256(d0, _mm256_loadu_si256((const __m256i*)&src[i + 0]));
+		d1 = _mm256_xor_si256(d1, _mm256_loadu_si256((const __m256i*)&src[i + 32]));
+		d2 = _mm256_xor_si256(d2, _mm256_loadu_si256((const __m256i*)&src[i + 64]));
+		d3 = _mm256_xor_si256(d3, _mm256_loadu_si256((const __m256i*)&src[i + 96]));
+
+		_mm256_storeu_si256((__m256i*)&dst[i + 0], d0);
+		_mm256_storeu_si256((__m256i*)&dst[i + 32], d1);
+		_mm256_storeu_si256((__m256i*)&dst[i + 64], d2);
+		_mm256_storeu_si256((__m256i*)&dst[i + 96], d3);
+	}
+
+	_mm256_zeroupper();
+
+	raidz_xor_sse2(&dst[i], &src[i], size - i);
+}
+
+#endif
+
+static void raidz_mul_c(uint8_t* dst, const uint8_t* src, size_t size, uint8_t c)
+{
+	const uint8_t* t = s_gf.nibble[c];
+
+	for(size_t i = 0; i < size; i++)
+	{
+		dst[i] ^= t[src[i] & 15] ^ t[16 + (src[i] >> 4)];
+	}
+}
+
+TARGET("ssse3") static void raidz_mul_ssse3(uint8_t* dst, const uint8_t* src, size_t size, uint8_t c)
+{
+	const uint8_t* t = s_gf.nibble[c];
+
+	__m128i lo = _mm_loadu_si128((const __m128i*)&t[0]);
+	__m128i hi = _mm_loadu_si128((const __m128i*)&t[16]);
+	__m128i mask = _mm_set1_epi8(0x0f);
+
+	size_t i = 0;
+
+	for(; i + 32 <= size; i += 32)
+	{
+		__m128i s0 = _mm_loadu_si128((const __m128i*)&src[i + 0]);
+		__m128i s1 = _mm_loadu_si128((const __m128i*)&src[i + 16]);
+
+		__m128i p0 = _mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(s0, mask)), _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(s0, 4), mask)));
+		__m128i p1 = _mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(s1, mask)), _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(s1, 4), mask)));
+
+		_mm_storeu_si128((__m128i*)&dst[i + 0], _mm_xor_si128(_mm_loadu_si128((__m128i*)&dst[i + 0]), p0));
+		_mm_storeu_si128((__m128i*)&dst[i + 16], _mm_xor_si128(_mm_loadu_si128((__m128i*)&dst[i + 16]), p1));
+	}
+
+	raidz_mul_c(&dst[i], &src[i], size - i, c);
+}
+
+#ifdef HAVE_AVX2
+
+TARGET("avx2") static void raidz_mul_avx2(uint8_t* dst, const uint8_t* src, size_t size, uint8_t c)
+{
+	const uint8_t* t = s_gf.nibble[c];
+
+	__m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)&t[0]));
+	__m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)&t[16]));
+	__m256i mask = _mm256_set1_epi8(0x0f);
+
+	size_t i = 0;
+
+	for(; i + 64 <= size; i += 64)
+	{
+		__m256i s0 = _mm256_loadu_si256((const __m256i*)&src[i + 0]);
+		__m256i s1 = _mm256_loadu_si256((const __m256i*)&src[i + 32]);
+
+		__m256i p0 = _mm256_xor_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(s0, mask)), _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(s0, 4), mask)));
+		__m256i p1 = _mm256_xor_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(s1, mask)), _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(s1, 4), mask)));
+
+		_mm256_storeu_si256((__m256i*)&dst[i + 0], _mm256_xor_si256(_mm256_loadu_si256((__m256i*)&dst[i + 0]), p0));
+		_mm256_storeu_si256((__m256i*)&dst[i + 32], _mm256_xor_si256(_mm256_loadu_si256((__m256i*)&dst[i + 32]), p1));
+	}
+
+	_mm256_zeroupper();
+
+	raidz_mul_ssse3(&dst[i], &src[i], size - i, c);
+}
+
+#endif
+
+class RaidzKernel : public ZFS::Kernel
+{
+	size_t Run(size_t index, std::vector<uint8_t>& out)
+	{
+		// a parity column of p and q over two halves of the test data
+
+		const std::vector<uint8_t>& data = GetTestData();
+
+		size_t half = data.size() / 2;
+
+		out.assign(data.begin(), data.begin() + half);
+
+		m_impls[index]->xor_func(out.data(), &data[half], half);
+		m_impls[index]->mul_func(out.data(), &data[half], half, 0x8e);
+
+		return half * 2;
+	}
+
+public:
+	std::vector<const ZFS::raidz_impl_t*> m_impls;
+
+	RaidzKernel()
+		: ZFS::Kernel("raidz")
+	{
+	}
+
+	void Add(const ZFS::raidz_impl_t* impl)
+	{
+		Kernel::Add(impl->name);
+
+		m_impls.push_back(impl);
+	}
+};
+
+static struct raidz_impl_struct
+{
+	ZFS::raidz_impl_t impl[4];
+	size_t count;
+	RaidzKernel kernel;
+
+	raidz_impl_struct()
+	{
+		const ZFS::Cpu& cpu = ZFS::Cpu::Get();
+
+		count = 0;
+
+		add("scalar", raidz_xor_c, raidz_mul_c);
+
+		if(cpu.sse2)
+		{
+			add("sse2", raidz_xor_sse2, raidz_mul_c);
+		}
+
+		if(cpu.sse2 && cpu.ssse3)
+		{
+			add("ssse3", raidz_xor_sse2, raidz_mul_ssse3);
+		}
+
+		#ifdef HAVE_AVX2
+
+		if(cpu.avx2)
+		{
+			add("avx2", raidz_xor_avx2, raidz_mul_avx2);
+		}
+
+		#endif
+	}
+
+	void add(const char* name, ZFS::raidz_xor_func_t xor_func, ZFS::raidz_mul_func_t mul_func)
+	{
+		impl[count].name = name;
+		impl[count].xor_func = xor_func;
+		impl[count].mul_func = mul_func;
+
+		kernel.Add(&impl[count]);
+
+		count++;
+	}
+
+	const ZFS::raidz_impl_t* get()
+	{
+		return &impl[kernel.Get()];
+	}
+
+} s_raidz_impl;
+
+size_t ZFS::raidz_get_impls(const raidz_impl_t** impls)
+{
+	*impls = s_raidz_impl.impl;
+
+	return s_raidz_impl.count;
+}
+
+const ZFS::raidz_impl_t* ZFS::raidz_get_impl()
+{
+	return s_raidz_impl.get();
+}
+
+void ZFS::raidz_set_impl(const raidz_impl_t* impl)
+{
+	s_raidz_impl.kernel.Set(impl - s_raidz_impl.impl);
+}
+
+uint8_t ZFS::gf_mul(uint8_t a, uint8_t b)
+{
+	return s_gf.mul(a, b);
+}
+
+void ZFS::raidz_xor(uint8_t* dst, const uint8_t* src, size_t size)
+{
+	s_raidz_impl.get()->xor_func(dst, src, size);
+}
+
+void ZFS::raidz_mul(uint8_t* dst, const uint8_t* src, size_t size, uint8_t c)
+{
+	if(c == 1)
+	{
+		s_raidz_impl.get()->xor_func(dst, src, size);
+	}
+	else if(c != 0)
+	{
+		s_raidz_impl.get()->mul_func(dst, src, size, c);
+	}
+}
+
+// P, Q and R are the sums of the data columns weighted by powers of 1, 2 and 4,
+// the first data column by the highest power, short columns padded with zeros
+
+static uint8_t raidz_coef(const raidz_map_t& rm, uint32_t p, uint32_t c)
+{
+	static const uint8_t g[] = {1, 2, 4};
+
+	return s_gf.pow(g[p], rm.m_cols - 1 - c);
+}
+
+void ZFS::raidz_generate(const raidz_map_t& rm, uint8_t* const* cols)
+{
+	uint32_t psize = rm.m_col[0].size;
+
+	for(uint32_t p = 0; p < rm.m_firstdatacol; p++)
+	{
+		memset(cols[p], 0, psize);
+
+		for(uint32_t c = rm.m_firstdatacol; c < rm.m_cols; c++)
+		{
+			raidz_mul(cols[p], cols[c], rm.m_col[c].size, raidz_coef(rm, p, c));
+		}
+	}
+}
+
+bool ZFS::raidz_reconstruct(const raidz_map_t& rm, uint8_t* const* cols, const uint32_t* bad, uint32_t nbad)
+{
+	if(nbad == 0)
+	{
+		return true;
+	}
+
+	uint32_t par[3];
+	uint32_t npar = 0;
+
+	for(uint32_t p = 0; p < rm.m_firstdatacol && p < 3 && npar < nbad; p++)
+	{
+		if(cols[p] != NULL)
+		{
+			par[npar++] = p;
+		}
+	}
+
+	if(npar < nbad)
+	{
+		return false;
+	}
+
+	uint32_t psize = rm.m_col[0].size;
+
+	if(nbad == 1 && par[0] == 0)
+	{
+		// P alone, plain xor
+
+		uint32_t x = bad[0];
+		uint32_t size = rm.m_col[x].size;
+
+		memcpy(cols[x], cols[0], size);
+
+		for(uint32_t c = rm.m_firstdatacol; c < rm.m_cols; c++)
+		{
+			if(c != x)
+			{
+				raidz_xor(cols[x], cols[c], std::min<uint32_t>(rm.m_col[c].size, size));
+			}
+		}
+
+		return true;
+	}
+
+	// the syndromes are what is left of the parity after removing the good columns from it
+
+	std::vector<uint8_t> syn(nbad * psize);
+
+	for(uint32_t i = 0; i < nbad; i++)
+	{
+		uint8_t* s = &syn[i * psize];
+
+		memcpy(s, cols[par[i]], psize);
+
+		for(uint32_t c = rm.m_firstdatacol; c < rm.m_cols; c++)
+		{
+			if(std::find(bad, bad + nbad, c) == bad + nbad)
+			{
+				raidz_mul(s, cols[c], rm.m_col[c].size, raidz_coef(rm, par[i], c));
+			}
+		}
+	}
+
+	// which equal the bad columns multiplied by their coefficients, inverting that matrix gives them back
+
+	uint8_t a[3][3];
+	uint8_t inv[3][3];
+
+	for(uint32_t i = 0; i < nbad; i++)
+	{
+		for(uint32_t k = 0; k < nbad; k++)
+		{
+			a[i][k] = raidz_coef(rm, par[i], bad[k]);
+			inv[i][k] = i == k ? 1 : 0;
+		}
+	}
+
+	for(uint32_t k = 0; k < nbad; k++)
+	{
+		uint32_t r = k;
+
+		while(r < nbad && a[r][k] == 0)
+		{
+			r++;
+		}
+
+		if(r == nbad)
+		{
+			return false;
+		}
+
+		if(r != k)
+		{
+			for(uint32_t j = 0; j < nbad; j++)
+			{
+				std::swap(a[r][j], a[k][j]);
+				std::swap(inv[r][j], inv[k][j]);
+			}
+		}
+
+		uint8_t f = s_gf.inv(a[k][k]);
+
+		for(uint32_t j = 0; j < nbad; j++)
+		{
+			a[k][j] = s_gf.mul(a[k][j], f);
+			inv[k][j] = s_gf.mul(inv[k][j], f);
+		}
+
+		for(uint32_t i = 0; i < nbad; i++)
+		{
+			if(i != k && a[i][k] != 0)
+			{
+				f = a[i][k];
+
+				for(uint32_t j = 0; j < nbad; j++)
+				{
+					a[i][j] ^= s_gf.mul(a[k][j], f);
+					inv[i][j] ^= s_gf.mul(inv[k][j], f);
+				}
+			}
+		}
+	}
+
+	for(uint32_t k = 0; k < nbad; k++)
+	{
+		uint32_t x = bad[k];
+		uint32_t size = rm.m_col[x].size;
+
+		memset(cols[x], 0, size);
+
+		for(uint32_t i = 0; i < nbad; i++)
+		{
+			raidz_mul(cols[x], &syn[i * psize], size, inv[k][i]);
+		}
+	}
+
+	return true;
+}
+
+// RaidzGeometry
+
+ZFS::RaidzGeometry::RaidzGeometry(uint32_t ashift, uint32_t dcols, uint32_t nparity)
+	: m_maps(MAX_SECTORS * dcols * 2)
+	, m_ashift(ashift)
+	, m_dcols(dcols)
+	, m_nparity(nparity)
+{
+	for(auto i = m_maps.begin(); i != m_maps.end(); i++)
+	{
+		i->store(NULL);
+	}
+}
+
+ZFS::RaidzGeometry::~RaidzGeometry()
+{
+	for(auto i = m_maps.begin(); i != m_maps.end(); i++)
+	{
+		delete i->load();
+	}
+}
+
+const raidz_map_t* ZFS::RaidzGeometry::Get(uint64_t offset, uint32_t psize, uint64_t& row, raidz_map_t& tmp)
+{
+	uint32_t sectors = psize >> 9;
+
+	if((psize & 511) != 0 || sectors == 0 || sectors > MAX_SECTORS)
+	{
+		tmp.Init(offset, psize, m_ashift, m_dcols, m_nparity);
+
+		row = 0;
+
+		return &tmp;
+	}
+
+	uint64_t b = offset >> m_ashift;
+	uint64_t r = b / m_dcols;
+
+	uint32_t phase = (uint32_t)(b - r * m_dcols);
+	uint32_t swap = m_nparity == 1 && (offset & (1ULL << 20)) ? 1 : 0; // single parity swaps the first two columns every 1MB
+
+	row = r << m_ashift;
+
+	std::atomic<raidz_map_t*>& slot = m_maps[((sectors - 1) * m_dcols + phase) * 2 + swap];
+
+	raidz_map_t* map = slot.load(std::memory_order_acquire);
+
+	if(map == NULL)
+	{
+		// built once, whoever publishes first wins
+
+		map = new raidz_map_t(offset, psize, m_ashift, m_dcols, m_nparity);
+
+		for(uint32_t c = 0; c < map->m_scols; c++)
+		{
+			map->m_col[c].offset -= row;
+		}
+
+		raidz_map_t* prev = NULL;
+
+		if(!slot.compare_exchange_strong(prev, map, std::memory_order_acq_rel))
+		{
+			delete map;
+
+			map = prev;
+		}
+	}
+
+	return map;
+}
@@ -0,0 +1,76 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "zfs.h"
+
+namespace ZFS
+{
+	typedef void (*raidz_xor_func_t)(uint8_t* dst, const uint8_t* src, size_t size); // dst ^= src
+	typedef void (*raidz_mul_func_t)(uint8_t* dst, const uint8_t* src, size_t size, uint8_t c); // dst ^= c * src in GF(2^8)
+
+	struct raidz_impl_t
+	{
+		const char* name;
+		raidz_xor_func_t xor_func;
+		raidz_mul_func_t mul_func;
+	};
+
+	extern size_t raidz_get_impls(const raidz_impl_t** impls); // the ones this cpu can run, the fastest is timed on first use
+	extern const raidz_impl_t* raidz_get_impl();
+	extern void raidz_set_impl(const raidz_impl_t* impl);
+
+	extern uint8_t gf_mul(uint8_t a, uint8_t b);
+
+	extern void raidz_xor(uint8_t* dst, const uint8_t* src, size_t size);
+	extern void raidz_mul(uint8_t* dst, const uint8_t* src, size_t size, uint8_t c);
+
+	// cols[c] is the buffer of rm.m_col[c], the parity columns are as large as m_col[0]
+
+	extern void raidz_generate(const raidz_map_t& rm, uint8_t* const* cols);
+
+	// rebuilds the listed data columns from the others and the parity columns that are not NULL,
+	// fails when there are fewer parity columns than bad ones
+
+	extern bool raidz_reconstruct(const raidz_map_t& rm, uint8_t* const* cols, const uint32_t* bad, uint32_t nbad);
+
+	// the column layout only depends on the size and where the offset falls within a row,
+	// it is built once per combination, column offsets are relative to the row
+
+	class RaidzGeometry
+	{
+		enum {MAX_SECTORS = 256}; // 128k in 512 byte units, larger blocks are not cached
+
+		std::vector<std::atomic<raidz_map_t*>> m_maps; // [sectors - 1][phase][1MB swap], offsets relative to the row
+		uint32_t m_ashift;
+		uint32_t m_dcols;
+		uint32_t m_nparity;
+
+	public:
+		RaidzGeometry(uint32_t ashift, uint32_t dcols, uint32_t nparity);
+		virtual ~RaidzGeometry();
+
+		// returns the shared map and the row to add to its offsets, or builds one into tmp if the size is not cached
+
+		const raidz_map_t* Get(uint64_t offset, uint32_t psize, uint64_t& row, raidz_map_t& tmp);
+	};
+}
@@ -0,0 +1,471 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "ReadPipeline.h"
+#include "Compress.h"
+#include "Hash.h"
+
+namespace ZFS
+{
+	ReadPipeline::ReadPipeline(Pool* pool)
+		: m_pool(pool)
+		, m_leaders(0)
+		, m_succeeded(true)
+	{
+	}
+
+	ReadPipeline::~ReadPipeline()
+	{
+		Drain();
+	}
+
+	void ReadPipeline::Submit(Pool::ReadRequest* req, const Callback& callback)
+	{
+		Block b;
+
+		b.req = req;
+		b.callback = callback;
+
+		if(!Prepare(b))
+		{
+			Finish(b); // from the cache
+
+			return;
+		}
+
+		if(m_waves.empty() || m_waves.back()->launched)
+		{
+			Wave* w = new Wave();
+
+			w->bytes = 0;
+			w->launched = false;
+
+			m_waves.push_back(w);
+		}
+
+		Wave* w = m_waves.back();
+
+		w->blocks.push_back(b);
+		w->bytes += b.psize;
+
+		if(w->bytes >= WAVE_BYTES || w->blocks.size() >= WAVE_BLOCKS)
+		{
+			Step();
+		}
+	}
+
+	bool ReadPipeline::Drain()
+	{
+		while(!m_waves.empty())
+		{
+			Step();
+		}
+
+		Settle(true);
+
+		bool succeeded = m_succeeded;
+
+		m_succeeded = true;
+
+		return succeeded;
+	}
+
+	void ReadPipeline::Step()
+	{
+		Wave* w = m_waves.front();
+
+		if(!w->launched)
+		{
+			std::lock_guard<std::mutex> lock(m_pool->m_io_lock);
+
+			Launch(w);
+
+			return;
+		}
+
+		// the next wave goes to the devices as soon as they are done with this one
+
+		{
+			std::lock_guard<std::mutex> lock(m_pool->m_io_lock);
+
+			w->batch.Wait();
+
+			if(m_waves.size() > 1)
+			{
+				Launch(m_waves[1]);
+			}
+		}
+
+		Complete(w);
+
+		m_waves.pop_front();
+
+		delete w;
+	}
+
+	void ReadPipeline::Poll()
+	{
+		// the requests of the next wave are timed when they are seen to complete, not when that wave is waited on
+
+		if(m_waves.size() > 1 && m_waves[1]->launched)
+		{
+			std::lock_guard<std::mutex> lock(m_pool->m_io_lock);
+
+			m_waves[1]->batch.Poll();
+		}
+	}
+
+	bool ReadPipeline::Prepare(Block& b)
+	{
+		Pool::ReadRequest& req = *b.req;
+
+		blkptr_t* bp = req.bp;
+
+		// the copy on the least busy vdev, the others are only tried by the single block path if it fails
+
+		int order[3];
+
+		{
+			// the costs come from device state the readers change under the same lock
+
+			std::lock_guard<std::mutex> lock(m_pool->m_io_lock);
+
+			m_pool->OrderCopies(bp, order);
+
+			if(order[0] != 0)
+			{
+				m_pool->m_stats.reordered++;
+			}
+		}
+
+		dva_t* addr = &bp->blk_dva[order[0]];
+
+		req.done = false;
+
+		b.vdev = NULL;
+		b.mapped = NULL;
+		b.src = NULL;
+		b.dst = NULL;
+		b.psize = ((size_t)bp->psize + 1) << 9;
+		b.lsize = ((size_t)bp->lsize + 1) << 9;
+		b.offset = addr->offset << 9;
+		b.asize = (uint64_t)addr->asize << 9;
+		b.first = b.last = 0;
+		b.cacheable = BlockCache::GetKey(bp, b.key);
+		b.leader = false;
+
+		if(req.size < b.lsize || addr->gang != 0)
+		{
+			return true; // the single block path will fail it
+		}
+
+		if(b.cacheable && m_pool->m_cache.Lookup(b.key, req.buff, req.size))
+		{
+			req.done = true;
+
+			return false;
+		}
+
+		if(b.cacheable)
+		{
+			b.flight = m_pool->Join(b.key, b.leader);
+
+			if(!b.leader)
+			{
+				return true; // picked up after ours have landed
+			}
+
+			m_leaders++;
+		}
+
+		b.vdev = m_pool->GetVdev(addr->vdev);
+
+		if(b.vdev == NULL)
+		{
+			return true;
+		}
+
+		b.mapped = b.vdev->Map(b.offset, b.psize);
+
+		if(b.mapped != NULL)
+		{
+			b.vdev = NULL;
+
+			return true;
+		}
+
+		b.src = bp->comp_type != ZIO_COMPRESS_OFF ? (uint8_t*)DeviceBackend::AllocBuffer(b.psize) : NULL;
+		b.dst = b.src != NULL ? b.src : req.buff;
+
+		return true;
+	}
+
+	void ReadPipeline::Launch(Wave* w)
+	{
+		std::vector<Block>& blocks = w->blocks;
+
+		size_t count = blocks.size();
+
+		w->launched = true;
+
+		if(count == 1 && m_waves.size() == 1 && blocks[0].vdev != NULL)
+		{
+			// nothing to overlap with, the single block path can hedge
+
+			blocks[0].vdev = NULL;
+
+			return;
+		}
+
+		// blocks allocated back to back on a raidz vdev are read as whole stripes, one request per child
+
+		for(size_t i = 0; i < count; )
+		{
+			Block& b = blocks[i];
+
+			size_t j = i + 1;
+
+			if(b.vdev != NULL && b.vdev->type == "raidz")
+			{
+				uint64_t bytes = b.asize;
+
+				for(; j < count; j++)
+				{
+					const Block& prev = blocks[j - 1];
+					const Block& next = blocks[j];
+
+					if(next.vdev != b.vdev || next.offset != prev.offset + prev.asize || bytes + next.asize > Pool::MAX_STRIPE)
+					{
+						break;
+					}
+
+					bytes += next.asize;
+				}
+			}
+
+			size_t first = w->batch.GetCount();
+
+			bool queued = false;
+
+			if(j - i > 1)
+			{
+				std::vector<uint8_t*> buffs;
+				std::vector<size_t> sizes;
+				std::vector<uint64_t> offsets;
+
+				for(size_t k = i; k < j; k++)
+				{
+					buffs.push_back(blocks[k].dst);
+					sizes.push_back(blocks[k].psize);
+					offsets.push_back(blocks[k].offset);
+				}
+
+				queued = b.vdev->QueueStripes(w->batch, buffs.data(), sizes.data(), offsets.data(), j - i);
+			}
+
+			if(!queued)
+			{
+				j = i + 1;
+
+				// raidz blocks not ending on a sector can only be read staged
+
+				if(b.vdev != NULL && !b.vdev->Queue(w->batch, b.dst, b.psize, b.offset) && !b.vdev->QueueStripes(w->batch, &b.dst, &b.psize, &b.offset, 1))
+				{
+					b.vdev = NULL;
+				}
+			}
+
+			for(size_t k = i; k < j; k++)
+			{
+				blocks[k].first = first;
+				blocks[k].last = w->batch.GetCount();
+			}
+
+			i = j;
+		}
+
+		w->batch.Submit();
+	}
+
+	void ReadPipeline::Complete(Wave* w)
+	{
+		// the checksums of everything the wave read, in one call so that they can share the vector units
+
+		std::vector<const void*> bufs;
+		std::vector<uint64_t> sizes;
+		std::vector<uint8_t> types;
+		std::vector<Block*> blocks;
+
+		for(auto i = w->blocks.begin(); i != w->blocks.end(); i++)
+		{
+			Block& b = *i;
+
+			b.verified = false;
+
+			if((b.flight == NULL || b.leader) && b.mapped == NULL && b.vdev != NULL && w->batch.Succeeded(b.first, b.last))
+			{
+				bufs.push_back(b.dst);
+				sizes.push_back(b.psize);
+				types.push_back(b.req->bp->cksum_type);
+				blocks.push_back(&b);
+			}
+		}
+
+		Poll();
+
+		if(!blocks.empty())
+		{
+			std::vector<cksum_t> sums(blocks.size());
+
+			ZFS::hash_many(bufs.data(), sizes.data(), types.data(), sums.data(), blocks.size());
+
+			for(size_t i = 0; i < blocks.size(); i++)
+			{
+				blocks[i]->verified = sums[i] == blocks[i]->req->bp->cksum;
+			}
+		}
+
+		for(auto i = w->blocks.begin(); i != w->blocks.end(); i++)
+		{
+			Block& b = *i;
+
+			Pool::ReadRequest& req = *b.req;
+
+			blkptr_t* bp = req.bp;
+
+			Poll();
+
+			if(b.flight != NULL && !b.leader)
+			{
+				continue;
+			}
+
+			const BlockKey* key = b.cacheable ? &b.key : NULL;
+
+			if(b.mapped != NULL)
+			{
+				req.done = Pool::Decode(b.mapped, req.buff, b.psize, b.lsize, bp);
+
+				if(req.done)
+				{
+					m_pool->Cache(key, b.mapped, req.buff, bp, req.streaming);
+				}
+			}
+			else if(b.vdev != NULL && w->batch.Succeeded(b.first, b.last))
+			{
+				if(b.verified)
+				{
+					b.vdev->MarkGood(b.offset, b.psize);
+
+					req.done = b.dst != b.src || ZFS::decompress(b.dst, req.buff, b.psize, b.lsize, bp->comp_type);
+
+					if(req.done)
+					{
+						m_pool->Cache(key, b.dst, req.buff, bp, req.streaming);
+					}
+				}
+				else
+				{
+					b.vdev->MarkBad(b.offset, b.psize);
+				}
+			}
+
+			if(b.src != NULL)
+			{
+				DeviceBackend::FreeBuffer(b.src);
+
+				b.src = NULL;
+			}
+
+			if(!req.done)
+			{
+				// the other copies, retries, reconstruction
+
+				std::lock_guard<std::mutex> lock(m_pool->m_io_lock);
+
+				req.done = m_pool->ReadBlock(req.buff, req.size, bp, key, req.streaming);
+			}
+
+			if(b.leader)
+			{
+				m_pool->Land(b.key, b.flight, req.buff, b.lsize, req.done);
+
+				m_leaders--;
+			}
+		}
+
+		for(auto i = w->blocks.begin(); i != w->blocks.end(); i++)
+		{
+			m_settling.push_back(*i);
+		}
+
+		Settle(m_leaders == 0);
+	}
+
+	void ReadPipeline::Settle(bool block)
+	{
+		// others' blocks are only waited for when none of ours can be holding them up, until they have landed
+		// they and everything submitted after them wait here, reading them meanwhile would read them twice
+
+		while(!m_settling.empty())
+		{
+			Block& b = m_settling.front();
+
+			Pool::ReadRequest& req = *b.req;
+
+			if(b.flight != NULL && !b.leader)
+			{
+				if(!block && !m_pool->Landed(b.flight))
+				{
+					break;
+				}
+
+				req.done = m_pool->Wait(b.flight, req.buff, req.size);
+
+				if(!req.done)
+				{
+					// whoever read it failed, the other copies are tried here
+
+					std::lock_guard<std::mutex> lock(m_pool->m_io_lock);
+
+					req.done = m_pool->ReadBlock(req.buff, req.size, req.bp, &b.key, req.streaming);
+				}
+			}
+
+			Block done = b;
+
+			m_settling.pop_front();
+
+			Finish(done);
+		}
+	}
+
+	void ReadPipeline::Finish(Block& b)
+	{
+		m_succeeded = m_succeeded && b.req->done;
+
+		if(b.callback)
+		{
+			b.callback(b.req);
+		}
+	}
+}
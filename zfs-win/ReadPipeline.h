@@ -0,0 +1,92 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "Pool.h"
+
+namespace ZFS
+{
+	// reads blocks in waves, the devices work on the next wave while the blocks of the previous one
+	// are verified and decompressed, at most one wave is in flight and one is being filled
+	//
+	// the callback of a request is called when it is done, right away for cached blocks, the rest in the order submitted,
+	// Drain waits for all of them
+
+	class ReadPipeline
+	{
+	public:
+		typedef std::function<void (Pool::ReadRequest* req)> Callback;
+
+	private:
+		enum {WAVE_BYTES = 4 << 20, WAVE_BLOCKS = 64};
+
+		struct Block
+		{
+			Pool::ReadRequest* req;
+			Callback callback;
+			VirtualDevice* vdev; // read by the wave, NULL if not (or not any more)
+			uint8_t* mapped;
+			uint8_t* src; // compressed blocks are read here
+			uint8_t* dst;
+			size_t psize;
+			size_t lsize;
+			uint64_t offset;
+			uint64_t asize;
+			size_t first; // of the wave's requests
+			size_t last;
+			BlockKey key;
+			bool cacheable;
+			std::shared_ptr<Pool::Flight> flight;
+			bool leader;
+			bool verified; // set by Complete for blocks read by the wave
+		};
+
+		struct Wave
+		{
+			std::vector<Block> blocks;
+			IoBatch batch;
+			size_t bytes;
+			bool launched;
+		};
+
+		Pool* m_pool;
+		std::deque<Wave*> m_waves; // oldest first, only the first one can be launched
+		std::deque<Block> m_settling; // completed, in the order submitted, others' blocks among them may still be in flight
+		size_t m_leaders; // flights of blocks not landed yet
+		bool m_succeeded;
+
+		bool Prepare(Block& b);
+		void Launch(Wave* w);
+		void Complete(Wave* w);
+		void Poll(); // keeps up with the wave in flight while the previous one is checked
+		void Finish(Block& b);
+		void Settle(bool block);
+		void Step();
+
+	public:
+		ReadPipeline(Pool* pool);
+		virtual ~ReadPipeline();
+
+		void Submit(Pool::ReadRequest* req, const Callback& callback = Callback());
+		bool Drain(); // true if every request since the last Drain succeeded
+	};
+}
@@ -0,0 +1,597 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "UringBackend.h"
+#include "BufferPool.h"
+
+#ifdef __linux__
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+
+namespace ZFS
+{
+	// registered buffer arena, shared by all rings, anything larger than a slot is allocated normally
+
+	static struct UringArena
+	{
+		enum {SLOT_SIZE = 128 << 10, SLOT_COUNT = 16};
+
+		uint8_t* base;
+		uint32_t used;
+		std::mutex lock;
+
+		UringArena() : used(0)
+		{
+			void* p = mmap(NULL, SLOT_SIZE * SLOT_COUNT, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+			base = p != MAP_FAILED ? (uint8_t*)p : NULL;
+		}
+
+		bool Contains(const void* p, size_t size) const
+		{
+			return base != NULL && (const uint8_t*)p >= base && (const uint8_t*)p + size <= base + SLOT_SIZE * SLOT_COUNT;
+		}
+
+	} s_arena;
+
+	void* UringBackend::AllocBuffer(size_t size)
+	{
+		if(size <= UringArena::SLOT_SIZE && s_arena.base != NULL)
+		{
+			std::lock_guard<std::mutex> lock(s_arena.lock);
+
+			for(uint32_t i = 0; i < UringArena::SLOT_COUNT; i++)
+			{
+				if((s_arena.used & (1 << i)) == 0)
+				{
+					s_arena.used |= 1 << i;
+
+					return s_arena.base + i * UringArena::SLOT_SIZE;
+				}
+			}
+		}
+
+		return BufferPool::Get().Alloc(size);
+	}
+
+	void UringBackend::FreeBuffer(void* buff)
+	{
+		if(buff != NULL && s_arena.Contains(buff, 1))
+		{
+			std::lock_guard<std::mutex> lock(s_arena.lock);
+
+			s_arena.used &= ~(1 << (((uint8_t*)buff - s_arena.base) / UringArena::SLOT_SIZE));
+		}
+		else
+		{
+			BufferPool::Get().Free(buff);
+		}
+	}
+
+	// UringBackend
+
+	UringBackend::UringBackend(uint32_t flags)
+		: PosixBackend(flags)
+		, m_ring(-1)
+		, m_depth(0)
+		, m_fixed(false)
+		, m_files(false)
+		, m_queued(0)
+		, m_inflight(0)
+	{
+		memset(&m_sq, 0, sizeof(m_sq));
+		memset(&m_cq, 0, sizeof(m_cq));
+		m_single = DeviceRequest();
+	}
+
+	UringBackend::~UringBackend()
+	{
+		Close();
+	}
+
+	bool UringBackend::Open(const wchar_t* path)
+	{
+		Close();
+
+		if(!PosixBackend::Open(path))
+		{
+			return false;
+		}
+
+		if(!Setup())
+		{
+			Teardown();
+		}
+
+		return true;
+	}
+
+	void UringBackend::Close()
+	{
+		Teardown();
+
+		PosixBackend::Close();
+	}
+
+	bool UringBackend::Setup()
+	{
+		io_uring_params p;
+
+		memset(&p, 0, sizeof(p));
+
+		m_ring = (int)syscall(__NR_io_uring_setup, QUEUE_DEPTH, &p);
+
+		if(m_ring < 0)
+		{
+			return false;
+		}
+
+		m_depth = std::min<unsigned>(p.sq_entries, p.cq_entries);
+
+		m_sq.map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		m_cq.map_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+
+		if(p.features & IORING_FEAT_SINGLE_MMAP)
+		{
+			m_sq.map_size = m_cq.map_size = std::max<size_t>(m_sq.map_size, m_cq.map_size);
+		}
+
+		m_sq.map = mmap(NULL, m_sq.map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQ_RING);
+
+		if(m_sq.map == MAP_FAILED)
+		{
+			m_sq.map = NULL;
+
+			return false;
+		}
+
+		if(p.features & IORING_FEAT_SINGLE_MMAP)
+		{
+			m_cq.map = m_sq.map;
+		}
+		else
+		{
+			m_cq.map = mmap(NULL, m_cq.map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_CQ_RING);
+
+			if(m_cq.map == MAP_FAILED)
+			{
+				m_cq.map = NULL;
+
+				return false;
+			}
+		}
+
+		m_sq.sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+
+		void* sqes = mmap(NULL, m_sq.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQES);
+
+		if(sqes == MAP_FAILED)
+		{
+			return false;
+		}
+
+		uint8_t* sq = (uint8_t*)m_sq.map;
+		uint8_t* cq = (uint8_t*)m_cq.map;
+
+		m_sq.head = (unsigned*)(sq + p.sq_off.head);
+		m_sq.tail = (unsigned*)(sq + p.sq_off.tail);
+		m_sq.mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+		m_sq.array = (unsigned*)(sq + p.sq_off.array);
+		m_sq.sqes = (io_uring_sqe*)sqes;
+
+		m_cq.head = (unsigned*)(cq + p.cq_off.head);
+		m_cq.tail = (unsigned*)(cq + p.cq_off.tail);
+		m_cq.mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+		m_cq.cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+
+		// IORING_OP_READ came with 5.6, so did the probe, older kernels set up a ring that cannot read into plain buffers
+
+		std::vector<uint8_t> buff(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+
+		io_uring_probe* probe = (io_uring_probe*)buff.data();
+
+		if(syscall(__NR_io_uring_register, m_ring, IORING_REGISTER_PROBE, probe, 256) != 0
+		|| probe->last_op < IORING_OP_READ || (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) == 0)
+		{
+			return false;
+		}
+
+		// registering the file and the arena saves a lookup and a page pinning per read, both are optional
+
+		m_files = syscall(__NR_io_uring_register, m_ring, IORING_REGISTER_FILES, &m_fd, 1) == 0;
+
+		if(s_arena.base != NULL)
+		{
+			iovec iov;
+
+			iov.iov_base = s_arena.base;
+			iov.iov_len = UringArena::SLOT_SIZE * UringArena::SLOT_COUNT;
+
+			m_fixed = syscall(__NR_io_uring_register, m_ring, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+		}
+
+		return true;
+	}
+
+	void UringBackend::Teardown()
+	{
+		if(m_ring >= 0)
+		{
+			Wait();
+		}
+
+		if(m_sq.sqes != NULL) munmap(m_sq.sqes, m_sq.sqes_size);
+		if(m_cq.map != NULL && m_cq.map != m_sq.map) munmap(m_cq.map, m_cq.map_size);
+		if(m_sq.map != NULL) munmap(m_sq.map, m_sq.map_size);
+
+		if(m_ring >= 0)
+		{
+			close(m_ring);
+
+			m_ring = -1;
+		}
+
+		memset(&m_sq, 0, sizeof(m_sq));
+		memset(&m_cq, 0, sizeof(m_cq));
+
+		m_depth = 0;
+		m_fixed = false;
+		m_files = false;
+		m_queued = 0;
+		m_inflight = 0;
+	}
+
+	bool UringBackend::Enter(unsigned submit, unsigned wait)
+	{
+		while(submit > 0 || wait > 0)
+		{
+			int n = (int)syscall(__NR_io_uring_enter, m_ring, submit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+
+			if(n < 0)
+			{
+				if(errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+
+				// nothing queued may be left waiting for a submission that is not going to happen,
+				// what the kernel already has still completes, the ring polls readable for it
+
+				Unqueue();
+
+				if(wait > 0 && m_inflight > 0)
+				{
+					Poll(-1);
+				}
+
+				return false;
+			}
+
+			submit -= std::min<unsigned>(submit, (unsigned)n);
+
+			m_queued -= std::min<size_t>(m_queued, (size_t)n);
+			m_inflight += (size_t)n;
+
+			if(submit == 0) break;
+		}
+
+		return true;
+	}
+
+	void UringBackend::Queue(DeviceRequest* req)
+	{
+		// the completion queue must never overflow, make room by waiting for the oldest ones
+
+		while(m_queued + m_inflight >= m_depth)
+		{
+			if(m_inflight == 0)
+			{
+				Enter((unsigned)m_queued, 0);
+			}
+			else
+			{
+				Enter((unsigned)m_queued, 1);
+
+				Reap();
+			}
+		}
+
+		unsigned tail = *m_sq.tail;
+		unsigned index = tail & m_sq.mask;
+
+		io_uring_sqe* sqe = &m_sq.sqes[index];
+
+		uint8_t* buff = (uint8_t*)req->buff + req->result;
+		size_t size = req->size - req->result;
+
+		memset(sqe, 0, sizeof(*sqe));
+
+		sqe->opcode = IORING_OP_READ;
+		sqe->flags = m_files ? IOSQE_FIXED_FILE : 0;
+		sqe->fd = m_files ? 0 : m_fd;
+		sqe->addr = (uint64_t)(uintptr_t)buff;
+		sqe->len = (uint32_t)size;
+		sqe->off = req->offset + req->result;
+		sqe->user_data = (uint64_t)(uintptr_t)req;
+
+		if(m_fixed && s_arena.Contains(buff, size))
+		{
+			sqe->opcode = IORING_OP_READ_FIXED;
+			sqe->buf_index = 0;
+		}
+
+		m_sq.array[index] = index;
+
+		__atomic_store_n(m_sq.tail, tail + 1, __ATOMIC_RELEASE);
+
+		m_queued++;
+	}
+
+	void UringBackend::Unqueue()
+	{
+		unsigned head = __atomic_load_n(m_sq.head, __ATOMIC_ACQUIRE);
+		unsigned tail = *m_sq.tail;
+
+		for(unsigned i = head; i != tail; i++)
+		{
+			Finish((DeviceRequest*)(uintptr_t)m_sq.sqes[m_sq.array[i & m_sq.mask]].user_data);
+		}
+
+		__atomic_store_n(m_sq.tail, head, __ATOMIC_RELEASE);
+
+		m_inflight += m_queued - std::min<size_t>(m_queued, tail - head); // picked up after all
+		m_queued = 0;
+	}
+
+	void UringBackend::Finish(DeviceRequest* req)
+	{
+		if(req->result < req->size && PosixBackend::BeginRead((uint8_t*)req->buff + req->result, req->size - req->result, req->offset + req->result))
+		{
+			req->result += PosixBackend::EndRead();
+		}
+
+		req->completed = std::chrono::steady_clock::now();
+		req->done = true;
+	}
+
+	void UringBackend::Poll(int64_t timeout)
+	{
+		// the ring fd polls readable when there are completions to reap
+
+		pollfd pfd;
+
+		pfd.fd = m_ring;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		timespec ts;
+
+		ts.tv_sec = (time_t)(timeout / 1000000);
+		ts.tv_nsec = (long)(timeout % 1000000) * 1000;
+
+		ppoll(&pfd, 1, timeout >= 0 ? &ts : NULL, NULL);
+	}
+
+	size_t UringBackend::Reap()
+	{
+		// completion is stamped here, the kernel does not say when it happened
+
+		auto now = std::chrono::steady_clock::now();
+
+		size_t count = 0;
+
+		unsigned head = *m_cq.head;
+
+		while(head != __atomic_load_n(m_cq.tail, __ATOMIC_ACQUIRE))
+		{
+			count++;
+
+			io_uring_cqe* cqe = &m_cq.cqes[head & m_cq.mask];
+
+			DeviceRequest* req = (DeviceRequest*)(uintptr_t)cqe->user_data;
+
+			int res = cqe->res;
+
+			head++;
+
+			__atomic_store_n(m_cq.head, head, __ATOMIC_RELEASE);
+
+			m_inflight--;
+
+			if(res > 0)
+			{
+				req->result += (size_t)res;
+
+				if(req->result < req->size)
+				{
+					Queue(req); // short read, ask for the rest
+
+					continue;
+				}
+			}
+			else if(res == -EINTR || res == -EAGAIN)
+			{
+				Queue(req);
+
+				continue;
+			}
+			else if(res == -EINVAL || res == -EOPNOTSUPP)
+			{
+				// misaligned for this filesystem or an operation the kernel does not have, finish it with pread
+
+				if(m_flags & DEVICE_DIRECT)
+				{
+					DisableDirect();
+				}
+
+				Finish(req);
+
+				continue;
+			}
+
+			req->completed = now;
+			req->done = true;
+		}
+
+		return count;
+	}
+
+	bool UringBackend::Submit(DeviceRequest* const* reqs, size_t count)
+	{
+		if(m_ring < 0)
+		{
+			return PosixBackend::Submit(reqs, count);
+		}
+
+		for(size_t i = 0; i < count; i++)
+		{
+			reqs[i]->result = 0;
+			reqs[i]->done = false;
+
+			if(reqs[i]->size > 0)
+			{
+				Queue(reqs[i]);
+			}
+			else
+			{
+				reqs[i]->completed = std::chrono::steady_clock::now();
+				reqs[i]->done = true;
+			}
+		}
+
+		Enter((unsigned)m_queued, 0); // if refused, the requests were read right away
+
+		return true;
+	}
+
+	bool UringBackend::Wait(int64_t timeout)
+	{
+		if(m_ring < 0)
+		{
+			return true;
+		}
+
+		if(timeout < 0)
+		{
+			while(m_queued + m_inflight > 0)
+			{
+				Enter((unsigned)m_queued, m_inflight > 0 ? 1 : 0);
+
+				Reap();
+			}
+
+			return true;
+		}
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout);
+
+		for(;;)
+		{
+			Enter((unsigned)m_queued, 0);
+
+			Reap();
+
+			if(m_queued + m_inflight == 0)
+			{
+				return true;
+			}
+
+			int64_t left = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+
+			if(left <= 0)
+			{
+				return false;
+			}
+
+			Poll(left);
+		}
+	}
+
+	bool UringBackend::WaitAny(int64_t timeout)
+	{
+		if(m_ring < 0)
+		{
+			return true;
+		}
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(std::max<int64_t>(timeout, 0));
+
+		for(;;)
+		{
+			Enter((unsigned)m_queued, 0);
+
+			if(Reap() > 0 || m_queued + m_inflight == 0)
+			{
+				return true;
+			}
+
+			if(timeout < 0)
+			{
+				Enter(0, 1);
+
+				continue;
+			}
+
+			int64_t left = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+
+			if(left <= 0)
+			{
+				return false;
+			}
+
+			Poll(left);
+		}
+	}
+
+	bool UringBackend::BeginRead(void* buff, size_t size, uint64_t offset)
+	{
+		if(m_ring < 0)
+		{
+			return PosixBackend::BeginRead(buff, size, offset);
+		}
+
+		DeviceRequest* req = &m_single;
+
+		req->buff = buff;
+		req->size = size;
+		req->offset = offset;
+
+		return Submit(&req, 1);
+	}
+
+	size_t UringBackend::EndRead()
+	{
+		if(m_ring < 0)
+		{
+			return PosixBackend::EndRead();
+		}
+
+		Wait();
+
+		return m_single.result;
+	}
+}
+
+#endif
@@ -0,0 +1,99 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "PosixBackend.h"
+
+#ifdef __linux__
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace ZFS
+{
+	// io_uring engine, keeps up to QUEUE_DEPTH reads in flight and falls back to pread when the kernel says no
+
+	class UringBackend : public PosixBackend
+	{
+		enum {QUEUE_DEPTH = 64};
+
+		int m_ring;
+		unsigned m_depth;
+		bool m_fixed;
+		bool m_files;
+
+		struct
+		{
+			unsigned* head;
+			unsigned* tail;
+			unsigned mask;
+			unsigned* array;
+			io_uring_sqe* sqes;
+			void* map;
+			size_t map_size;
+			size_t sqes_size;
+		} m_sq;
+
+		struct
+		{
+			unsigned* head;
+			unsigned* tail;
+			unsigned mask;
+			io_uring_cqe* cqes;
+			void* map;
+			size_t map_size;
+		} m_cq;
+
+		size_t m_queued; // in the submission queue, not yet seen by the kernel
+		size_t m_inflight;
+
+		DeviceRequest m_single;
+
+		bool Setup();
+		void Teardown();
+		bool Enter(unsigned submit, unsigned wait); // false if the kernel refused, what was queued is read by Unqueue then
+		void Queue(DeviceRequest* req);
+		void Unqueue(); // takes back what the kernel has not picked up yet and reads it with pread
+		void Finish(DeviceRequest* req); // the rest of it with pread
+		void Poll(int64_t timeout); // until there may be completions to reap
+		size_t Reap(); // the number of completions seen
+
+	public:
+		UringBackend(uint32_t flags = 0);
+		virtual ~UringBackend();
+
+		bool Open(const wchar_t* path);
+		void Close();
+
+		bool BeginRead(void* buff, size_t size, uint64_t offset);
+		size_t EndRead();
+
+		bool Submit(DeviceRequest* const* reqs, size_t count);
+		bool Wait(int64_t timeout = -1);
+		bool WaitAny(int64_t timeout = -1);
+
+		static void* AllocBuffer(size_t size);
+		static void FreeBuffer(void* buff);
+	};
+}
+
+#endif
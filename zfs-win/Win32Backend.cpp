@@ -0,0 +1,401 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "Win32Backend.h"
+
+#ifdef _WIN32
+
+namespace ZFS
+{
+	Win32Backend::Win32Backend(uint32_t flags)
+		: m_retired(NULL)
+		, m_flags(flags)
+		, m_handle(NULL)
+		, m_size(0)
+		, m_align(1)
+	{
+		memset(&m_overlapped, 0, sizeof(m_overlapped));
+
+		m_overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);  
+	}
+
+	Win32Backend::~Win32Backend()
+	{
+		Close();
+
+		CloseHandle(m_overlapped.hEvent); 
+
+		for(auto i = m_free.begin(); i != m_free.end(); i++)
+		{
+			CloseHandle((*i)->overlapped.hEvent);
+
+			delete *i;
+		}
+	}
+
+	bool Win32Backend::Open(const wchar_t* path)
+	{
+		Close();
+
+		m_path = path;
+
+		DWORD flags = (m_flags & DEVICE_DIRECT) ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN;
+
+		m_handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags | FILE_FLAG_OVERLAPPED, (HANDLE)NULL);
+
+		if(m_handle == INVALID_HANDLE_VALUE && (m_flags & DEVICE_DIRECT))
+		{
+			flags = FILE_FLAG_SEQUENTIAL_SCAN;
+
+			m_handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags | FILE_FLAG_OVERLAPPED, (HANDLE)NULL);
+		}
+
+		if(m_handle == INVALID_HANDLE_VALUE)
+		{
+			m_handle = NULL;
+
+			return false;
+		}
+
+		DISK_GEOMETRY_EX dg;
+		DWORD sz;
+
+		bool disk = !!DeviceIoControl(m_handle, IOCTL_DISK_GET_DRIVE_GEOMETRY_EX, NULL, 0, &dg, sizeof(dg), &sz, NULL);
+
+		if(!GetFileSizeEx(m_handle, (LARGE_INTEGER*)&m_size))
+		{
+			if(disk)
+			{
+				m_size = dg.DiskSize.QuadPart;
+			}
+		}
+
+		if(flags & FILE_FLAG_NO_BUFFERING)
+		{
+			// the sector size for disks, files are assumed to sit on 4k sectors
+
+			m_align = disk && dg.Geometry.BytesPerSector > 0 ? dg.Geometry.BytesPerSector : 4096;
+		}
+
+		return true;
+	}
+
+	void Win32Backend::SetAlignment(size_t align)
+	{
+		if(m_align > 1 && align > m_align)
+		{
+			m_align = align;
+		}
+	}
+
+	bool Win32Backend::DisableDirect()
+	{
+		// unbuffered reads were rejected, a second handle with caching takes over, 
+		// what is in flight on the first one completes there without being waited for
+
+		if(m_align <= 1 || m_retired != NULL)
+		{
+			return false;
+		}
+
+		HANDLE handle = CreateFile(m_path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED, (HANDLE)NULL);
+
+		if(handle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		m_retired = m_handle;
+		m_handle = handle;
+		m_flags &= ~DEVICE_DIRECT;
+		m_align = 1;
+
+		Retire();
+
+		return true;
+	}
+
+	void Win32Backend::Retire()
+	{
+		if(m_retired == NULL)
+		{
+			return;
+		}
+
+		for(auto i = m_inflight.begin(); i != m_inflight.end(); i++)
+		{
+			if((*i)->handle == m_retired)
+			{
+				return;
+			}
+		}
+
+		CloseHandle(m_retired);
+
+		m_retired = NULL;
+	}
+
+	void Win32Backend::Close()
+	{
+		if(m_handle != NULL)
+		{
+			CancelIo(m_handle);
+
+			if(m_retired != NULL)
+			{
+				CancelIo(m_retired);
+			}
+
+			// the buffers and OVERLAPPEDs must outlive the requests, cancelled or not
+
+			auto now = std::chrono::steady_clock::now();
+
+			for(auto i = m_inflight.begin(); i != m_inflight.end(); i++)
+			{
+				Io* io = *i;
+
+				DWORD size = 0;
+
+				io->req->result = GetOverlappedResult(io->handle, &io->overlapped, &size, TRUE) ? (size_t)size : 0;
+				io->req->completed = now;
+				io->req->done = true;
+
+				m_free.push_back(io);
+			}
+
+			m_inflight.clear();
+
+			Retire();
+
+			CloseHandle(m_handle);
+
+			m_handle = NULL;
+		}
+
+		m_size = 0;
+		m_align = 1;
+	}
+
+	bool Win32Backend::BeginRead(void* buff, size_t size, uint64_t offset)
+	{
+		m_overlapped.Offset = (DWORD)offset;
+		m_overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+		if(!ReadFile(m_handle, buff, (DWORD)size, NULL, &m_overlapped))
+		{
+			switch(GetLastError())
+			{
+			case ERROR_IO_PENDING:
+				break;
+			case ERROR_HANDLE_EOF:
+				return false;
+			case ERROR_INVALID_PARAMETER:
+				return DisableDirect() && BeginRead(buff, size, offset);
+			}
+		}
+
+		return true;
+	}
+
+	size_t Win32Backend::EndRead()
+	{
+		DWORD size;
+
+		if(GetOverlappedResult(m_handle, &m_overlapped, &size, TRUE))
+		{
+			return (size_t)size;
+		}
+
+		return 0;
+ 	}
+
+	DWORD Win32Backend::Start(DeviceRequest* req)
+	{
+		Io* io = NULL;
+
+		if(!m_free.empty())
+		{
+			io = m_free.back();
+
+			m_free.pop_back();
+		}
+		else
+		{
+			io = new Io();
+
+			io->overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+		}
+
+		HANDLE event = io->overlapped.hEvent;
+
+		memset(&io->overlapped, 0, sizeof(io->overlapped));
+
+		io->overlapped.hEvent = event;
+		io->overlapped.Offset = (DWORD)req->offset;
+		io->overlapped.OffsetHigh = (DWORD)(req->offset >> 32);
+		io->handle = m_handle;
+		io->req = req;
+
+		if(ReadFile(m_handle, req->buff, (DWORD)req->size, NULL, &io->overlapped) || GetLastError() == ERROR_IO_PENDING)
+		{
+			m_inflight.push_back(io);
+
+			return ERROR_SUCCESS;
+		}
+
+		DWORD error = GetLastError();
+
+		m_free.push_back(io);
+
+		return error;
+	}
+
+	size_t Win32Backend::Reap()
+	{
+		auto now = std::chrono::steady_clock::now();
+
+		size_t count = 0;
+
+		for(auto i = m_inflight.begin(); i != m_inflight.end(); )
+		{
+			Io* io = *i;
+
+			if(!HasOverlappedIoCompleted(&io->overlapped))
+			{
+				i++;
+
+				continue;
+			}
+
+			DWORD size = 0;
+
+			io->req->result = GetOverlappedResult(io->handle, &io->overlapped, &size, FALSE) ? (size_t)size : 0;
+			io->req->completed = now;
+			io->req->done = true;
+
+			m_free.push_back(io);
+
+			i = m_inflight.erase(i);
+
+			count++;
+		}
+
+		if(count > 0)
+		{
+			Retire();
+		}
+
+		return count;
+	}
+
+	bool Win32Backend::Submit(DeviceRequest* const* reqs, size_t count)
+	{
+		// every request has its own OVERLAPPED and event, they are all with the device at the same time
+
+		for(size_t i = 0; i < count; i++)
+		{
+			DeviceRequest* req = reqs[i];
+
+			req->result = 0;
+			req->done = false;
+
+			if(req->size == 0)
+			{
+				req->completed = std::chrono::steady_clock::now();
+				req->done = true;
+
+				continue;
+			}
+
+			DWORD error = Start(req);
+
+			if(error == ERROR_INVALID_PARAMETER && DisableDirect())
+			{
+				error = Start(req);
+			}
+
+			if(error != ERROR_SUCCESS)
+			{
+				req->completed = std::chrono::steady_clock::now(); // end of file or a failure, nothing read
+				req->done = true;
+			}
+		}
+
+		return true;
+	}
+
+	bool Win32Backend::Wait(int64_t timeout)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(std::max<int64_t>(timeout, 0));
+
+		while(!m_inflight.empty())
+		{
+			int64_t left = -1;
+
+			if(timeout >= 0)
+			{
+				left = std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count(), 0);
+			}
+
+			if(!WaitAny(left))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool Win32Backend::WaitAny(int64_t timeout)
+	{
+		if(Reap() > 0 || m_inflight.empty())
+		{
+			return true;
+		}
+
+		// the oldest ones, WaitForMultipleObjects takes a limited number of handles
+
+		HANDLE events[MAXIMUM_WAIT_OBJECTS];
+
+		DWORD count = (DWORD)std::min<size_t>(m_inflight.size(), MAXIMUM_WAIT_OBJECTS);
+
+		for(DWORD i = 0; i < count; i++)
+		{
+			events[i] = m_inflight[i]->overlapped.hEvent;
+		}
+
+		DWORD ms = timeout < 0 ? INFINITE : (DWORD)((timeout + 999) / 1000);
+
+		DWORD res = WaitForMultipleObjects(count, events, FALSE, ms);
+
+		if(res == WAIT_TIMEOUT || res == WAIT_FAILED)
+		{
+			return false;
+		}
+
+		Reap();
+
+		return true;
+	}
+}
+
+#endif
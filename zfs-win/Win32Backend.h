@@ -0,0 +1,78 @@
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "DeviceBackend.h"
+
+#ifdef _WIN32
+
+namespace ZFS
+{
+	class Win32Backend : public DeviceBackend
+	{
+		struct Io
+		{
+			OVERLAPPED overlapped;
+			HANDLE handle; // the one it was started on
+			DeviceRequest* req;
+		};
+
+		std::wstring m_path;
+		HANDLE m_retired; // the unbuffered handle after DisableDirect, closed when its reads are all back
+		OVERLAPPED m_overlapped;
+		std::vector<Io*> m_inflight; // oldest first
+		std::vector<Io*> m_free; // with their events, reused
+
+		DWORD Start(DeviceRequest* req); // ERROR_SUCCESS if it is on its way
+		size_t Reap(); // the number of requests completed
+		void Retire(); // closes m_retired once nothing is in flight on it
+
+	protected:
+		uint32_t m_flags;
+		HANDLE m_handle;
+		uint64_t m_size;
+		size_t m_align;
+
+		bool DisableDirect();
+
+	public:
+		Win32Backend(uint32_t flags = 0);
+		virtual ~Win32Backend();
+
+		bool Open(const wchar_t* path);
+		void Close();
+
+		uint64_t GetSize() {return m_size;}
+
+		size_t GetAlignment() {return m_align;}
+		void SetAlignment(size_t align);
+
+		bool BeginRead(void* buff, size_t size, uint64_t offset);
+		size_t EndRead();
+
+		bool Submit(DeviceRequest* const* reqs, size_t count);
+		bool Wait(int64_t timeout = -1);
+		bool WaitAny(int64_t timeout = -1);
+	};
+}
+
+#endif
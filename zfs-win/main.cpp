@@ -1,971 +1,1780 @@
-/* 
- *	Copyright (C) 2010 Gabest
- *	http://code.google.com/p/zfs-win/
- *
- *  This Program is free software; you can redistribute it and/or modify
- *  it under the terms of the GNU General Public License as published by
- *  the Free Software Foundation; either version 2, or (at your option)
- *  any later version.
- *   
- *  This Program is distributed in the hope that it will be useful,
- *  but WITHOUT ANY WARRANTY; without even the implied warranty of
- *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
- *  GNU General Public License for more details.
- *   
- *  You should have received a copy of the GNU General Public License
- *  along with GNU Make; see the file COPYING.  If not, write to
- *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
- *  http://www.gnu.org/copyleft/gpl.html
- *
- */
-
-#include "stdafx.h"
-#include "Pool.h"
-#include "DataSet.h"
-#include "String.h"
-#include "../dokan/dokan.h"
-
-using namespace Util;
-
-namespace ZFS
-{
-	class Context
-	{
-	public:
-		Pool m_pool;
-		DataSet* m_root;
-		DataSet* m_mounted;
-		std::wstring m_name;
-
-		Context() {m_root = NULL; m_mounted = NULL;}
-		~Context() {delete m_root;}
-
-		bool Init(std::list<std::wstring>& paths, const std::wstring& name)
-		{
-			m_name = name;
-
-			if(!m_pool.Open(paths, name.c_str()))
-			{
-				wprintf(L"Failed to open pool\n");
-
-				return false;
-			}
-
-			m_root = new ZFS::DataSet(&m_pool);
-		
-			if(!m_root->Init(&m_pool.m_devs.front()->m_active->rootbp))
-			{
-				wprintf(L"Failed to read root dataset\n");
-
-				return false;
-			}
-
-			m_mounted = m_root;
-
-			return true;
-		}
-
-		bool SetDataSet(std::wstring& dataset)
-		{
-			if(!m_root->Find(dataset.c_str(), &m_mounted))
-			{
-				std::list<std::wstring> sl;
-
-				sl.push_back(UTF8To16(m_pool.m_name.c_str()));
-				
-				if(!dataset.empty()) 
-				{
-					sl.push_back(dataset);
-				}
-
-				wprintf(L"Cannot find dataset '%s'\n", Implode(sl, L"/").c_str());
-
-				return false;
-			}
-
-			return true;
-		}
-
-		void List(const DataSet* ds, std::wstring parent = L"")
-		{
-			std::wstring s;
-			
-			if(!parent.empty())
-			{
-				s = parent + L"/";
-			}
-			
-			s += Util::UTF8To16(ds->m_name.c_str());
-
-			wprintf(L"%s\n", s.c_str());
-
-			for(auto i = ds->m_children.begin(); i != ds->m_children.end(); i++)
-			{
-				List(*i, s);
-			}
-		}
-	};
-
-	class FileContext
-	{
-	public:
-		dnode_phys_t node;
-		BlockReader reader;
-		std::wstring name;
-	
-		FileContext(Pool* pool, dnode_phys_t* dn, const wchar_t* n)
-			: node(*dn)
-			, reader(pool, dn)
-			, name(n)
-		{
-		}
-	};
-
-	void UnixTimeToFileTime(uint64_t t, FILETIME* pft)
-	{
-		// http://support.microsoft.com/kb/167296
-     
-		*(uint64_t*)pft = (t * 10000000) + 116444736000000000ull;
-	}
-
-	void UnixTimeToSystemTime(uint64_t t, SYSTEMTIME* st)
-	{
-		FILETIME ft;
-		UnixTimeToFileTime(t, &ft);
-		FileTimeToSystemTime(&ft, st);
-	}
-
-	static int WINAPI CreateFile(
-		LPCWSTR FileName, 
-		DWORD AccessMode, 
-		DWORD ShareMode, 
-		DWORD CreationDisposition, 
-		DWORD FlagsAndAttributes, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s %d\n", clock(), __FUNCTIONW__, FileName, CreationDisposition);
-
-		std::wstring fn = FileName;
-
-		fn = TrimRight(fn, L"\\");
-
-		dnode_phys_t dn;
-
-		memset(&dn, 0, sizeof(dn));
-
-		if(!ctx->m_mounted->Find(fn.c_str(), dn))
-		{
-			dn.type = 0;
-		}
-
-		switch(CreationDisposition)
-		{
-		case CREATE_NEW:
-			return dn.type != 0 ? -ERROR_FILE_EXISTS : -ERROR_ACCESS_DENIED;
-		case CREATE_ALWAYS:
-			return -ERROR_ACCESS_DENIED;
-		case TRUNCATE_EXISTING:
-			return dn.type == 0 ? -ERROR_FILE_NOT_FOUND : -ERROR_ACCESS_DENIED;
-		case OPEN_EXISTING:
-			if(dn.type == 0) return -ERROR_FILE_NOT_FOUND;
-			break;
-		case OPEN_ALWAYS:
-			if(dn.type == 0) return -ERROR_ACCESS_DENIED;
-			break;
-		default:
-			return -1;
-		}
-
-		if(dn.type == DMU_OT_DIRECTORY_CONTENTS)
-		{
-			DokanFileInfo->IsDirectory = 1;
-		}
-
-		DokanFileInfo->Context = (ULONG64)new FileContext(&ctx->m_pool, &dn, fn.c_str());
-
-		return CreationDisposition == OPEN_ALWAYS ? ERROR_ALREADY_EXISTS : 0;
-	}
-
-	static int WINAPI OpenDirectory(
-		LPCWSTR FileName, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		std::wstring fn = FileName;
-
-		fn = TrimRight(fn, L"\\");
-
-		dnode_phys_t dn;
-
-		if(!ctx->m_mounted->Find(fn.c_str(), dn) || dn.type != DMU_OT_DIRECTORY_CONTENTS)
-		{
-			return -ERROR_PATH_NOT_FOUND;
-		}
-
-		DokanFileInfo->Context = (ULONG64)new FileContext(&ctx->m_pool, &dn, fn.c_str());
-
-		return 0;
-	}
-
-	static int WINAPI CreateDirectory(
-		LPCWSTR FileName, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI Cleanup(
-		LPCWSTR FileName, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s %s\n", clock(), __FUNCTIONW__, FileName, DokanFileInfo->Context != 0 ? ((FileContext*)DokanFileInfo->Context)->name.c_str() : L"NULL");
-		
-		if(DokanFileInfo->Context != 0)
-		{
-			delete (FileContext*)DokanFileInfo->Context;
-
-			DokanFileInfo->Context = 0;
-		}
-		
-		return 0;
-	}
-
-	static int WINAPI CloseFile(
-		LPCWSTR FileName, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s %s\n", clock(), __FUNCTIONW__, FileName, DokanFileInfo->Context != 0 ? ((FileContext*)DokanFileInfo->Context)->name.c_str() : L"NULL");
-
-		if(DokanFileInfo->Context != 0)
-		{
-			delete (FileContext*)DokanFileInfo->Context;
-
-			DokanFileInfo->Context = 0;
-		}
-
-		return 0;
-	}
-
-	static int WINAPI ReadFile(
-		LPCWSTR FileName, 
-		LPVOID Buffer, 
-		DWORD BufferLength, 
-		LPDWORD ReadLength, 
-		LONGLONG Offset, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s %d %I64d\n", clock(), __FUNCTIONW__, FileName, BufferLength, Offset);
-
-		FileContext* fctx = (FileContext*)DokanFileInfo->Context;
-
-		if(fctx == NULL) return -ERROR_INVALID_HANDLE;
-
-		znode_phys_t* znode = (znode_phys_t*)fctx->node.bonus();
-
-		BufferLength = (DWORD)std::min<uint64_t>(znode->size - Offset, BufferLength);
-
-		*ReadLength = fctx->reader.Read(Buffer, BufferLength, Offset);
-
-		if(*ReadLength != BufferLength)
-		{
-			return -ERROR_READ_FAULT;
-		}
-
-		return 0;
-	}
-
-	static int WINAPI WriteFile(
-		LPCWSTR FileName, 
-		LPCVOID Buffer, 
-		DWORD NumberOfBytesToWrite, 
-		LPDWORD NumberOfBytesWritten, 
-		LONGLONG Offset, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI FlushFileBuffers(
-		LPCWSTR FileName, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI GetFileInformation(
-		LPCWSTR FileName, 
-		LPBY_HANDLE_FILE_INFORMATION HandleFileInformation, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		FileContext* fctx = (FileContext*)DokanFileInfo->Context;
-
-		if(fctx == NULL) return -ERROR_INVALID_HANDLE;
-
-		znode_phys_t* node = (znode_phys_t*)fctx->node.bonus();
-
-		UnixTimeToFileTime(node->crtime[0], &HandleFileInformation->ftCreationTime);
-		UnixTimeToFileTime(node->atime[0], &HandleFileInformation->ftLastAccessTime);
-		UnixTimeToFileTime(node->mtime[0], &HandleFileInformation->ftLastWriteTime);
-
-		HandleFileInformation->dwFileAttributes = 0;
-
-		if(1)
-		{
-			HandleFileInformation->dwFileAttributes |= FILE_ATTRIBUTE_READONLY; // TODO
-		}
-
-		if(fctx->node.type == DMU_OT_DIRECTORY_CONTENTS)
-		{
-			HandleFileInformation->dwFileAttributes |= FILE_ATTRIBUTE_DIRECTORY; // TODO: symlinks pointing to directories
-		}
-
-		HandleFileInformation->dwVolumeSerialNumber = 0;
-		HandleFileInformation->nFileSizeLow = (DWORD)(node->size);
-		HandleFileInformation->nFileSizeHigh = (DWORD)(node->size >> 32);
-		HandleFileInformation->nNumberOfLinks = 1;
-		HandleFileInformation->nFileIndexLow = 0;
-		HandleFileInformation->nFileIndexHigh = 0;
-
-		return 0;
-	}
-
-	static int WINAPI FindFiles(
-		LPCWSTR FileName,
-		PFillFindData FillFindData, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI FindFilesWithPattern(
-		LPCWSTR PathName,
-		LPCWSTR SearchPattern,
-		PFillFindData Callback, // call this function with PWIN32_FIND_DATAW
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s %s\n", clock(), __FUNCTIONW__, PathName, SearchPattern);
-
-		if(DokanFileInfo->Context != 0)
-		{
-			FileContext* fctx = (FileContext*)DokanFileInfo->Context;
-
-			if(fctx->node.type != DMU_OT_DIRECTORY_CONTENTS)
-			{
-				return -1;
-			}
-
-			ZFS::ZapObject* zap = NULL;
-
-			if(!ctx->m_mounted->m_head->Read(fctx->node.pad3[0], &zap))
-			{
-				return -1;
-			}
-
-			bool everything = wcscmp(SearchPattern, L"*") == 0;
-			bool wildcards = wcschr(SearchPattern, '*') != NULL || wcschr(SearchPattern, '?') != NULL;
-
-			for(auto i = zap->begin(); i != zap->end(); i++)
-			{
-				std::string fn = i->first;
-
-				uint64_t index = 0;
-				
-				if(!zap->Lookup(fn.c_str(), index))
-				{
-					return false;
-				}
-
-				index = ZFS_DIRENT_OBJ(index);
-
-				std::wstring wfn = Util::UTF8To16(fn.c_str());
-
-				if(!everything && !(wildcards ? PathMatchSpec(wfn.c_str(), SearchPattern) : wfn == SearchPattern))
-				{
-					continue;
-				}
-
-				dnode_phys_t subdn;
-
-				if(!ctx->m_mounted->m_head->Read(index, &subdn))
-				{
-					return false;
-				}
-
-				znode_phys_t* node = (znode_phys_t*)subdn.bonus();
-
-				WIN32_FIND_DATAW fd;
-
-				fd.dwFileAttributes = 0;
-
-				if(1)
-				{
-					fd.dwFileAttributes |= FILE_ATTRIBUTE_READONLY; // TODO
-				}
-
-				if(subdn.type == DMU_OT_DIRECTORY_CONTENTS)
-				{
-					fd.dwFileAttributes |= FILE_ATTRIBUTE_DIRECTORY; // TODO: symlinks pointing to directories
-				}
-
-				UnixTimeToFileTime(node->crtime[0], &fd.ftCreationTime);
-				UnixTimeToFileTime(node->atime[0], &fd.ftLastAccessTime);
-				UnixTimeToFileTime(node->mtime[0], &fd.ftLastWriteTime);
-
-				fd.nFileSizeLow = (DWORD)(node->size);
-				fd.nFileSizeHigh = (DWORD)(node->size >> 32);
-
-				wcscpy(fd.cFileName, wfn.c_str());
-
-				fd.cAlternateFileName[0] = 0; // ???
-
-				if(Callback(&fd, DokanFileInfo) != 0)
-				{
-					break;
-				}
-			}
-		}
-
-		return 0;
-	}
-
-	static int WINAPI SetFileAttributes(
-		LPCWSTR FileName,
-		DWORD FileAttributes, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI SetFileTime(
-		LPCWSTR FileName,
-		CONST FILETIME* CreationTime,
-		CONST FILETIME* LastAccessTime,
-		CONST FILETIME* LastWriteTime, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI DeleteFile(
-		LPCWSTR FileName, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI DeleteDirectory(
-		LPCWSTR FileName, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI MoveFile(
-		LPCWSTR FileName, // existing file name
-		LPCWSTR NewFileName,
-		BOOL ReplaceIfExisting, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI SetEndOfFile(
-		LPCWSTR FileName,
-		LONGLONG ByteOffset, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI SetAllocationSize(
-		LPCWSTR FileName,
-		LONGLONG AllocSize, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI LockFile(
-		LPCWSTR FileName,
-		LONGLONG ByteOffset,
-		LONGLONG Length, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI UnlockFile(
-		LPCWSTR FileName,
-		LONGLONG ByteOffset,
-		LONGLONG Length, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
-
-		return -ERROR_ACCESS_DENIED;
-	}
-
-	static int WINAPI GetDiskFreeSpace(
-		PULONGLONG FreeBytesAvailable,
-		PULONGLONG TotalNumberOfBytes,
-		PULONGLONG TotalNumberOfFreeBytes, 
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s\n", clock(), __FUNCTIONW__);
-
-		uint64_t total = 0;
-
-		for(auto i = ctx->m_pool.m_vdevs.begin(); i != ctx->m_pool.m_vdevs.end(); i++)
-		{
-			VirtualDevice* vdev = *i;
-
-			if(vdev->type == "raidz")
-			{
-				size_t count = vdev->children.size();
-
-				if(count > 1)
-				{
-					total += vdev->asize * (count - vdev->nparity) / count;
-				}
-			}
-			else if(vdev->type == "mirror")
-			{
-				size_t count = vdev->children.size();
-
-				if(count > 0)
-				{
-					total += vdev->asize / count;
-				}
-			}
-			else
-			{
-				total += vdev->asize;
-			}
-		}
-
-		if(TotalNumberOfBytes != NULL)
-		{
-			*TotalNumberOfBytes = total;
-		}
-
-		if(TotalNumberOfFreeBytes != NULL)
-		{
-			*TotalNumberOfFreeBytes = total - ctx->m_root->m_dir.used_bytes;
-		}
-
-		if(FreeBytesAvailable != NULL)
-		{
-			*FreeBytesAvailable = total - ctx->m_root->m_dir.used_bytes;
-		}
-
-		return 0;
-	}
-
-	static int WINAPI GetVolumeInformation(
-		LPWSTR VolumeNameBuffer,
-		DWORD VolumeNameSize,
-		LPDWORD VolumeSerialNumber,
-		LPDWORD MaximumComponentLength,
-		LPDWORD FileSystemFlags,
-		LPWSTR  FileSystemNameBuffer,
-		DWORD FileSystemNameSize,
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s\n", clock(), __FUNCTIONW__);
-
-		if(VolumeNameBuffer != NULL)
-		{
-			wcscpy(VolumeNameBuffer, ctx->m_name.c_str());
-		}
-
-		if(VolumeSerialNumber != NULL)
-		{
-			*VolumeSerialNumber = 0;
-		}
-
-		if(MaximumComponentLength != NULL)
-		{
-			*MaximumComponentLength = 256;
-		}
-
-		if(FileSystemFlags != NULL)
-		{
-			*FileSystemFlags = 
-				FILE_CASE_SENSITIVE_SEARCH | 
-				FILE_CASE_PRESERVED_NAMES | 
-				FILE_UNICODE_ON_DISK |
-				FILE_READ_ONLY_VOLUME;
-		}
-
-		if(FileSystemNameBuffer != NULL)
-		{
-			wcscpy(FileSystemNameBuffer, L"ZFS");
-		}
-
-		return 0;
-	}
-
-	static int WINAPI Unmount(
-		DOKAN_FILE_INFO* DokanFileInfo)
-	{
-		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
-
-		// wprintf(L"[%d] %s\n", clock(), __FUNCTIONW__);
-
-		return 0;
-	}
-}
-
-static void usage()
-{
-	printf(
-		"ZFS for Windows\n"
-		"\n"
-		"usage:\n"
-		"  mount <mountpoint> <dataset> <pool ..>\n"
-		"  list <pool ..>\n"
-		"\n"
-		"examples:\n"
-		"  zfs-win.exe mount \"m:\\\" \"rpool/ROOT/opensolaris\" \"\\\\.\\PhysicalDrive1\" \"\\\\.\\PhysicalDrive2\"\n"
-		"  zfs-win.exe list \"Virtual Machine-flat.vmdk\"\n"
-		);
-
-	// TODO: 
-	// list uberblocks
-	// mount specific uberblock
-	// read test
-	// overwrite uberblock magic number to rollback to earlier state
-}
-
-static void repair()
-{
-	HANDLE handle[4];
-	uint64_t size[4];
-	LARGE_INTEGER li, li2;
-	DWORD n;
-	static vdev_label_t label[4][4];
-
-	memset(label, 0, sizeof(label));
-
-	for(int i = 0; i < 4; i++)
-	{
-		std::wstring s = Util::Format(L"\\\\.\\PhysicalDrive%d", i + 1);
-
-		handle[i] = CreateFile(s.c_str(), GENERIC_WRITE | GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, (HANDLE)NULL);
-
-		if(handle[i] == INVALID_HANDLE_VALUE)
-		{
-			return;
-		}
-
-		if(!GetFileSizeEx(handle[i], (LARGE_INTEGER*)&size[i]))
-		{
-			DISK_GEOMETRY_EX dg;
-			DWORD sz;
-		
-			if(DeviceIoControl(handle[i], IOCTL_DISK_GET_DRIVE_GEOMETRY_EX, NULL, 0, &dg, sizeof(dg), &sz, NULL))
-			{
-				size[i] = dg.DiskSize.QuadPart;
-			}
-		}
-
-		li.QuadPart = 0;
-		SetFilePointerEx(handle[i], li, &li2, FILE_BEGIN);
-		ReadFile(handle[i], &label[i][0], sizeof(vdev_label_t), &n, NULL);
-		ReadFile(handle[i], &label[i][1], sizeof(vdev_label_t), &n, NULL);
-
-		li.QuadPart = size[i] - sizeof(vdev_label_t) * 2 - 0x26000;
-		SetFilePointerEx(handle[i], li, &li2, FILE_BEGIN);
-		ReadFile(handle[i], &label[i][2], sizeof(vdev_label_t), &n, NULL);
-		ReadFile(handle[i], &label[i][3], sizeof(vdev_label_t), &n, NULL);
-	}
-
-	for(int i = 0; i < 4; i++)
-	{
-		for(int j = 0; j < 4; j++)
-		{
-			uberblock_t* ub = (uberblock_t*)&label[j][i].uberblock[8 << 10];
-
-			ub->magic = 0;
-
-			printf("%d\n", ub->txg);
-		}
-	}
-
-	for(int i = 0; i < 4; i++)
-	{
-		li.QuadPart = 0;
-		SetFilePointerEx(handle[i], li, &li2, FILE_BEGIN);
-		WriteFile(handle[i], &label[i][0], sizeof(vdev_label_t), &n, NULL);
-		WriteFile(handle[i], &label[i][1], sizeof(vdev_label_t), &n, NULL);
-
-		li.QuadPart = size[i] - sizeof(vdev_label_t) * 2 - 0x26000;
-		SetFilePointerEx(handle[i], li, &li2, FILE_BEGIN);
-		WriteFile(handle[i], &label[i][2], sizeof(vdev_label_t), &n, NULL);
-		WriteFile(handle[i], &label[i][3], sizeof(vdev_label_t), &n, NULL);
-
-		CloseHandle(handle[i]);
-	}
-}
-
-int _tmain(int argc, _TCHAR* argv[])
-{
-	// repair(); return -1;
-
-	if(argc < 2) {usage(); return -1;}
-
-	std::wstring mp;
-	std::list<std::wstring> paths;
-	std::wstring pool;
-	std::wstring  dataset;
-	bool list_only = false;
-
-	if(wcsicmp(argv[1], L"mount") == 0)
-	{
-		if(argc < 5) {usage(); return -1;}
-
-		mp = argv[2];
-
-		std::list<std::wstring> sl;
-
-		Util::Explode(std::wstring(argv[3]), sl, L"/");
-
-		pool = sl.front();
-
-		sl.pop_front();
-
-		dataset = Implode(sl, '/');
-
-		for(int i = 4; i < argc; i++)
-		{
-			paths.push_back(argv[i]);
-		}
-	}
-	else if(wcsicmp(argv[1], L"list") == 0)
-	{
-		if(argc < 3) {usage(); return -1;}
-
-		for(int i = 2; i < argc; i++)
-		{
-			paths.push_back(argv[i]);
-		}
-
-		list_only = true;
-	}
-	
-	if(paths.empty()) {usage(); return -1;}
-
-	/*
-
-	paths.clear();
-	paths.push_back(L"\\\\.\\PhysicalDrive1");
-	paths.push_back(L"\\\\.\\PhysicalDrive2");
-	paths.push_back(L"\\\\.\\PhysicalDrive3");
-	paths.push_back(L"\\\\.\\PhysicalDrive4");
-
-	pool = L"share";
-	dataset = L"backup";
-
-	*/
-
-	ZFS::Context ctx;
-
-	if(!ctx.Init(paths, pool))
-	{
-		return -1;
-	}
-
-	if(list_only)
-	{
-		ctx.List(ctx.m_root);
-
-		return 0;
-	}
-
-	if(!ctx.SetDataSet(dataset))
-	{
-		return -1;
-	}
-
-	//
-
-	DOKAN_OPTIONS options;
-
-	memset(&options, 0, sizeof(DOKAN_OPTIONS));
-
-	options.Version = DOKAN_VERSION;
-	options.GlobalContext = (ULONG64)&ctx;
-	options.ThreadCount = 1; // TODO
-	options.Options = DOKAN_OPTION_KEEP_ALIVE;
-	options.MountPoint = mp.c_str();
-
-	#ifdef _DEBUG
-
-	options.Options |= DOKAN_OPTION_DEBUG;
-
-	#endif
-
-	DOKAN_OPERATIONS ops;
-
-	memset(&ops, 0, sizeof(DOKAN_OPERATIONS));
-
-	ops.CreateFile = ZFS::CreateFile;
-	ops.OpenDirectory = ZFS::OpenDirectory;
-	ops.CreateDirectory = ZFS::CreateDirectory;
-	ops.Cleanup = ZFS::Cleanup;
-	ops.CloseFile = ZFS::CloseFile;
-	ops.ReadFile = ZFS::ReadFile;
-	ops.WriteFile = ZFS::WriteFile;
-	ops.FlushFileBuffers = ZFS::FlushFileBuffers;
-	ops.GetFileInformation = ZFS::GetFileInformation;
-	ops.FindFiles = ZFS::FindFiles;
-	ops.FindFilesWithPattern = ZFS::FindFilesWithPattern;
-	ops.SetFileAttributes = ZFS::SetFileAttributes;
-	ops.SetFileTime = ZFS::SetFileTime;
-	ops.DeleteFile = ZFS::DeleteFile;
-	ops.DeleteDirectory = ZFS::DeleteDirectory;
-	ops.MoveFile = ZFS::MoveFile;
-	ops.SetEndOfFile = ZFS::SetEndOfFile;
-	ops.SetAllocationSize = ZFS::SetAllocationSize;
-	ops.LockFile = ZFS::LockFile;
-	ops.UnlockFile = ZFS::UnlockFile;
-	ops.GetDiskFreeSpace = ZFS::GetDiskFreeSpace;
-	ops.GetVolumeInformation = ZFS::GetVolumeInformation;
-	ops.Unmount = ZFS::Unmount;
-
-	switch(int status = DokanMain(&options, &ops))
-	{
-	case DOKAN_SUCCESS:
-		printf("Success\n");
-		break;
-	case DOKAN_ERROR:
-		printf("Error\n");
-		break;
-	case DOKAN_DRIVE_LETTER_ERROR:
-		printf("Bad Drive letter\n");
-		break;
-	case DOKAN_DRIVER_INSTALL_ERROR:
-		printf("Can't install driver\n");
-		break;
-	case DOKAN_START_ERROR:
-		printf("Driver something wrong\n");
-		break;
-	case DOKAN_MOUNT_ERROR:
-		printf("Can't assign a drive letter\n");
-		break;
-	default:
-		printf("Unknown error: %d\n", status);
-		break;
-	}
-
-	// std::list<std::wstring> paths;
-
-	/*
-	const char* name = "mpool";
-
-	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM1-flat.vmdk");
-	
-	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM2-flat.vmdk");
-	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM3-flat.vmdk");
-	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM4-flat.vmdk");
-	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM5-flat.vmdk");
-	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM6-flat.vmdk");
-	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM7-flat.vmdk");
-	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM8-flat.vmdk");
-	*/
-
-	/*
-	const char* name = "share";
-
-	paths.push_back(L"\\\\.\\PhysicalDrive1");
-	paths.push_back(L"\\\\.\\PhysicalDrive2");
-	paths.push_back(L"\\\\.\\PhysicalDrive3");
-	paths.push_back(L"\\\\.\\PhysicalDrive4");
-	*/
-
-	/*
-	const char* name = "rpool";
-
-	paths.push_back(L"D:\\Virtual Machines\\OpenSolaris\\OpenSolaris-flat.vmdk");	
-	*/
-
-	/*
-	const char* name = "rpool";
-
-	paths.push_back(L"D:\\Virtual Machines\\ZFS1VM\\ZFS1VM-flat.vmdk");
-	*/
-
-	return 0;
-}
-
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "stdafx.h"
+#include "Pool.h"
+#include "DataSet.h"
+#include "String.h"
+#include "Raidz.h"
+#include "Hash.h"
+#include "Kernel.h"
+#include "BufferPool.h"
+
+#ifdef _WIN32
+#include "../dokan/dokan.h"
+#endif
+
+using namespace Util;
+
+namespace ZFS
+{
+	class Context
+	{
+	public:
+		Pool m_pool;
+		DataSet* m_root;
+		DataSet* m_mounted;
+		std::wstring m_name;
+
+		Context() {m_root = NULL; m_mounted = NULL;}
+		~Context() {delete m_root;}
+
+		bool Init(std::list<std::wstring>& paths, const std::wstring& name, uint32_t flags)
+		{
+			m_name = name;
+
+			if(!m_pool.Open(paths, name.c_str(), flags))
+			{
+				wprintf(L"Failed to open pool\n");
+
+				return false;
+			}
+
+			m_root = new ZFS::DataSet(&m_pool);
+		
+			if(!m_root->Init(&m_pool.m_devs.front()->m_active->rootbp))
+			{
+				wprintf(L"Failed to read root dataset\n");
+
+				return false;
+			}
+
+			m_mounted = m_root;
+
+			return true;
+		}
+
+		bool SetDataSet(std::wstring& dataset)
+		{
+			if(!m_root->Find(dataset.c_str(), &m_mounted))
+			{
+				std::list<std::wstring> sl;
+
+				sl.push_back(UTF8To16(m_pool.m_name.c_str()));
+				
+				if(!dataset.empty()) 
+				{
+					sl.push_back(dataset);
+				}
+
+				wprintf(L"Cannot find dataset '%ls'\n", Implode(sl, L"/").c_str());
+
+				return false;
+			}
+
+			return true;
+		}
+
+		void List(const DataSet* ds, std::wstring parent = L"")
+		{
+			std::wstring s;
+			
+			if(!parent.empty())
+			{
+				s = parent + L"/";
+			}
+			
+			s += Util::UTF8To16(ds->m_name.c_str());
+
+			wprintf(L"%ls\n", s.c_str());
+
+			for(auto i = ds->m_children.begin(); i != ds->m_children.end(); i++)
+			{
+				List(*i, s);
+			}
+		}
+	};
+
+#ifdef _WIN32
+
+	class FileContext
+	{
+	public:
+		dnode_phys_t node;
+		BlockReader reader;
+		std::wstring name;
+	
+		FileContext(Pool* pool, dnode_phys_t* dn, const wchar_t* n)
+			: node(*dn)
+			, reader(pool, dn)
+			, name(n)
+		{
+		}
+	};
+
+	void UnixTimeToFileTime(uint64_t t, FILETIME* pft)
+	{
+		// http://support.microsoft.com/kb/167296
+     
+		*(uint64_t*)pft = (t * 10000000) + 116444736000000000ull;
+	}
+
+	void UnixTimeToSystemTime(uint64_t t, SYSTEMTIME* st)
+	{
+		FILETIME ft;
+		UnixTimeToFileTime(t, &ft);
+		FileTimeToSystemTime(&ft, st);
+	}
+
+	static int WINAPI CreateFile(
+		LPCWSTR FileName, 
+		DWORD AccessMode, 
+		DWORD ShareMode, 
+		DWORD CreationDisposition, 
+		DWORD FlagsAndAttributes, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s %d\n", clock(), __FUNCTIONW__, FileName, CreationDisposition);
+
+		std::wstring fn = FileName;
+
+		fn = TrimRight(fn, L"\\");
+
+		dnode_phys_t dn;
+
+		memset(&dn, 0, sizeof(dn));
+
+		if(!ctx->m_mounted->Find(fn.c_str(), dn))
+		{
+			dn.type = 0;
+		}
+
+		switch(CreationDisposition)
+		{
+		case CREATE_NEW:
+			return dn.type != 0 ? -ERROR_FILE_EXISTS : -ERROR_ACCESS_DENIED;
+		case CREATE_ALWAYS:
+			return -ERROR_ACCESS_DENIED;
+		case TRUNCATE_EXISTING:
+			return dn.type == 0 ? -ERROR_FILE_NOT_FOUND : -ERROR_ACCESS_DENIED;
+		case OPEN_EXISTING:
+			if(dn.type == 0) return -ERROR_FILE_NOT_FOUND;
+			break;
+		case OPEN_ALWAYS:
+			if(dn.type == 0) return -ERROR_ACCESS_DENIED;
+			break;
+		default:
+			return -1;
+		}
+
+		if(dn.type == DMU_OT_DIRECTORY_CONTENTS)
+		{
+			DokanFileInfo->IsDirectory = 1;
+		}
+
+		DokanFileInfo->Context = (ULONG64)new FileContext(&ctx->m_pool, &dn, fn.c_str());
+
+		return CreationDisposition == OPEN_ALWAYS ? ERROR_ALREADY_EXISTS : 0;
+	}
+
+	static int WINAPI OpenDirectory(
+		LPCWSTR FileName, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		std::wstring fn = FileName;
+
+		fn = TrimRight(fn, L"\\");
+
+		dnode_phys_t dn;
+
+		if(!ctx->m_mounted->Find(fn.c_str(), dn) || dn.type != DMU_OT_DIRECTORY_CONTENTS)
+		{
+			return -ERROR_PATH_NOT_FOUND;
+		}
+
+		DokanFileInfo->Context = (ULONG64)new FileContext(&ctx->m_pool, &dn, fn.c_str());
+
+		return 0;
+	}
+
+	static int WINAPI CreateDirectory(
+		LPCWSTR FileName, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI Cleanup(
+		LPCWSTR FileName, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s %s\n", clock(), __FUNCTIONW__, FileName, DokanFileInfo->Context != 0 ? ((FileContext*)DokanFileInfo->Context)->name.c_str() : L"NULL");
+		
+		if(DokanFileInfo->Context != 0)
+		{
+			delete (FileContext*)DokanFileInfo->Context;
+
+			DokanFileInfo->Context = 0;
+		}
+		
+		return 0;
+	}
+
+	static int WINAPI CloseFile(
+		LPCWSTR FileName, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s %s\n", clock(), __FUNCTIONW__, FileName, DokanFileInfo->Context != 0 ? ((FileContext*)DokanFileInfo->Context)->name.c_str() : L"NULL");
+
+		if(DokanFileInfo->Context != 0)
+		{
+			delete (FileContext*)DokanFileInfo->Context;
+
+			DokanFileInfo->Context = 0;
+		}
+
+		return 0;
+	}
+
+	static int WINAPI ReadFile(
+		LPCWSTR FileName, 
+		LPVOID Buffer, 
+		DWORD BufferLength, 
+		LPDWORD ReadLength, 
+		LONGLONG Offset, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s %d %I64d\n", clock(), __FUNCTIONW__, FileName, BufferLength, Offset);
+
+		FileContext* fctx = (FileContext*)DokanFileInfo->Context;
+
+		if(fctx == NULL) return -ERROR_INVALID_HANDLE;
+
+		znode_phys_t* znode = (znode_phys_t*)fctx->node.bonus();
+
+		BufferLength = (DWORD)std::min<uint64_t>(znode->size - Offset, BufferLength);
+
+		*ReadLength = fctx->reader.Read(Buffer, BufferLength, Offset);
+
+		if(*ReadLength != BufferLength)
+		{
+			return -ERROR_READ_FAULT;
+		}
+
+		return 0;
+	}
+
+	static int WINAPI WriteFile(
+		LPCWSTR FileName, 
+		LPCVOID Buffer, 
+		DWORD NumberOfBytesToWrite, 
+		LPDWORD NumberOfBytesWritten, 
+		LONGLONG Offset, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI FlushFileBuffers(
+		LPCWSTR FileName, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI GetFileInformation(
+		LPCWSTR FileName, 
+		LPBY_HANDLE_FILE_INFORMATION HandleFileInformation, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		FileContext* fctx = (FileContext*)DokanFileInfo->Context;
+
+		if(fctx == NULL) return -ERROR_INVALID_HANDLE;
+
+		znode_phys_t* node = (znode_phys_t*)fctx->node.bonus();
+
+		UnixTimeToFileTime(node->crtime[0], &HandleFileInformation->ftCreationTime);
+		UnixTimeToFileTime(node->atime[0], &HandleFileInformation->ftLastAccessTime);
+		UnixTimeToFileTime(node->mtime[0], &HandleFileInformation->ftLastWriteTime);
+
+		HandleFileInformation->dwFileAttributes = 0;
+
+		if(1)
+		{
+			HandleFileInformation->dwFileAttributes |= FILE_ATTRIBUTE_READONLY; // TODO
+		}
+
+		if(fctx->node.type == DMU_OT_DIRECTORY_CONTENTS)
+		{
+			HandleFileInformation->dwFileAttributes |= FILE_ATTRIBUTE_DIRECTORY; // TODO: symlinks pointing to directories
+		}
+
+		HandleFileInformation->dwVolumeSerialNumber = 0;
+		HandleFileInformation->nFileSizeLow = (DWORD)(node->size);
+		HandleFileInformation->nFileSizeHigh = (DWORD)(node->size >> 32);
+		HandleFileInformation->nNumberOfLinks = 1;
+		HandleFileInformation->nFileIndexLow = 0;
+		HandleFileInformation->nFileIndexHigh = 0;
+
+		return 0;
+	}
+
+	static int WINAPI FindFiles(
+		LPCWSTR FileName,
+		PFillFindData FillFindData, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI FindFilesWithPattern(
+		LPCWSTR PathName,
+		LPCWSTR SearchPattern,
+		PFillFindData Callback, // call this function with PWIN32_FIND_DATAW
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s %s\n", clock(), __FUNCTIONW__, PathName, SearchPattern);
+
+		if(DokanFileInfo->Context != 0)
+		{
+			FileContext* fctx = (FileContext*)DokanFileInfo->Context;
+
+			if(fctx->node.type != DMU_OT_DIRECTORY_CONTENTS)
+			{
+				return -1;
+			}
+
+			ZFS::ZapObject* zap = NULL;
+
+			if(!ctx->m_mounted->m_head->Read(fctx->node.pad3[0], &zap))
+			{
+				return -1;
+			}
+
+			bool everything = wcscmp(SearchPattern, L"*") == 0;
+			bool wildcards = wcschr(SearchPattern, '*') != NULL || wcschr(SearchPattern, '?') != NULL;
+
+			for(auto i = zap->begin(); i != zap->end(); i++)
+			{
+				std::string fn = i->first;
+
+				uint64_t index = 0;
+				
+				if(!zap->Lookup(fn.c_str(), index))
+				{
+					return false;
+				}
+
+				index = ZFS_DIRENT_OBJ(index);
+
+				std::wstring wfn = Util::UTF8To16(fn.c_str());
+
+				if(!everything && !(wildcards ? PathMatchSpec(wfn.c_str(), SearchPattern) : wfn == SearchPattern))
+				{
+					continue;
+				}
+
+				dnode_phys_t subdn;
+
+				if(!ctx->m_mounted->m_head->Read(index, &subdn))
+				{
+					return false;
+				}
+
+				znode_phys_t* node = (znode_phys_t*)subdn.bonus();
+
+				WIN32_FIND_DATAW fd;
+
+				fd.dwFileAttributes = 0;
+
+				if(1)
+				{
+					fd.dwFileAttributes |= FILE_ATTRIBUTE_READONLY; // TODO
+				}
+
+				if(subdn.type == DMU_OT_DIRECTORY_CONTENTS)
+				{
+					fd.dwFileAttributes |= FILE_ATTRIBUTE_DIRECTORY; // TODO: symlinks pointing to directories
+				}
+
+				UnixTimeToFileTime(node->crtime[0], &fd.ftCreationTime);
+				UnixTimeToFileTime(node->atime[0], &fd.ftLastAccessTime);
+				UnixTimeToFileTime(node->mtime[0], &fd.ftLastWriteTime);
+
+				fd.nFileSizeLow = (DWORD)(node->size);
+				fd.nFileSizeHigh = (DWORD)(node->size >> 32);
+
+				wcscpy(fd.cFileName, wfn.c_str());
+
+				fd.cAlternateFileName[0] = 0; // ???
+
+				if(Callback(&fd, DokanFileInfo) != 0)
+				{
+					break;
+				}
+			}
+		}
+
+		return 0;
+	}
+
+	static int WINAPI SetFileAttributes(
+		LPCWSTR FileName,
+		DWORD FileAttributes, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI SetFileTime(
+		LPCWSTR FileName,
+		CONST FILETIME* CreationTime,
+		CONST FILETIME* LastAccessTime,
+		CONST FILETIME* LastWriteTime, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI DeleteFile(
+		LPCWSTR FileName, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI DeleteDirectory(
+		LPCWSTR FileName, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI MoveFile(
+		LPCWSTR FileName, // existing file name
+		LPCWSTR NewFileName,
+		BOOL ReplaceIfExisting, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI SetEndOfFile(
+		LPCWSTR FileName,
+		LONGLONG ByteOffset, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI SetAllocationSize(
+		LPCWSTR FileName,
+		LONGLONG AllocSize, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI LockFile(
+		LPCWSTR FileName,
+		LONGLONG ByteOffset,
+		LONGLONG Length, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI UnlockFile(
+		LPCWSTR FileName,
+		LONGLONG ByteOffset,
+		LONGLONG Length, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s: %s\n", clock(), __FUNCTIONW__, FileName);
+
+		return -ERROR_ACCESS_DENIED;
+	}
+
+	static int WINAPI GetDiskFreeSpace(
+		PULONGLONG FreeBytesAvailable,
+		PULONGLONG TotalNumberOfBytes,
+		PULONGLONG TotalNumberOfFreeBytes, 
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s\n", clock(), __FUNCTIONW__);
+
+		uint64_t total = 0;
+
+		for(auto i = ctx->m_pool.m_vdevs.begin(); i != ctx->m_pool.m_vdevs.end(); i++)
+		{
+			VirtualDevice* vdev = *i;
+
+			if(vdev->type == "raidz")
+			{
+				size_t count = vdev->children.size();
+
+				if(count > 1)
+				{
+					total += vdev->asize * (count - vdev->nparity) / count;
+				}
+			}
+			else if(vdev->type == "mirror")
+			{
+				size_t count = vdev->children.size();
+
+				if(count > 0)
+				{
+					total += vdev->asize / count;
+				}
+			}
+			else
+			{
+				total += vdev->asize;
+			}
+		}
+
+		if(TotalNumberOfBytes != NULL)
+		{
+			*TotalNumberOfBytes = total;
+		}
+
+		if(TotalNumberOfFreeBytes != NULL)
+		{
+			*TotalNumberOfFreeBytes = total - ctx->m_root->m_dir.used_bytes;
+		}
+
+		if(FreeBytesAvailable != NULL)
+		{
+			*FreeBytesAvailable = total - ctx->m_root->m_dir.used_bytes;
+		}
+
+		return 0;
+	}
+
+	static int WINAPI GetVolumeInformation(
+		LPWSTR VolumeNameBuffer,
+		DWORD VolumeNameSize,
+		LPDWORD VolumeSerialNumber,
+		LPDWORD MaximumComponentLength,
+		LPDWORD FileSystemFlags,
+		LPWSTR  FileSystemNameBuffer,
+		DWORD FileSystemNameSize,
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s\n", clock(), __FUNCTIONW__);
+
+		if(VolumeNameBuffer != NULL)
+		{
+			wcscpy(VolumeNameBuffer, ctx->m_name.c_str());
+		}
+
+		if(VolumeSerialNumber != NULL)
+		{
+			*VolumeSerialNumber = 0;
+		}
+
+		if(MaximumComponentLength != NULL)
+		{
+			*MaximumComponentLength = 256;
+		}
+
+		if(FileSystemFlags != NULL)
+		{
+			*FileSystemFlags = 
+				FILE_CASE_SENSITIVE_SEARCH | 
+				FILE_CASE_PRESERVED_NAMES | 
+				FILE_UNICODE_ON_DISK |
+				FILE_READ_ONLY_VOLUME;
+		}
+
+		if(FileSystemNameBuffer != NULL)
+		{
+			wcscpy(FileSystemNameBuffer, L"ZFS");
+		}
+
+		return 0;
+	}
+
+	static int WINAPI Unmount(
+		DOKAN_FILE_INFO* DokanFileInfo)
+	{
+		Context* ctx = (Context*)DokanFileInfo->DokanOptions->GlobalContext;
+
+		// wprintf(L"[%d] %s\n", clock(), __FUNCTIONW__);
+
+		return 0;
+	}
+
+#endif
+}
+
+static void usage()
+{
+	printf(
+		"ZFS for Windows\n"
+		"\n"
+		"usage:\n"
+		"  [options] mount <mountpoint> <dataset> <pool ..> (windows only)\n"
+		"  [options] list <pool ..>\n"
+		"  [options] test <dataset> <pool ..>\n"
+		"  bench  measure the speed of the raidz parity kernels, checksums, map setup and buffer allocation, check copy selection\n"
+		"  [options] kernels  time the implementations of checksums, decompression and raidz parity, show the ones used\n"
+		"\n"
+		"options:\n"
+		"  --mmap    map image files into memory instead of reading them\n"
+		"  --direct  bypass the host cache (O_DIRECT, FILE_FLAG_NO_BUFFERING)\n"
+		"  --merge-gap <bytes>  reads closer than this are merged (default 8192)\n"
+		"  --mirror <rr|lo|locality>  mirror read policy: round robin, least outstanding (default), closest offset\n"
+		"  --hedge <percentile>  read another copy when a device is slower than this (default 0.95, 0 is off)\n"
+		"  --cache <MB>  memory for the block cache (default 128, 0 is off)\n"
+		"  --cache-mode <compressed|logical>  keep cached blocks as on disk (default) or decompressed\n"
+		"  --l2 <file>  second level cache file on a fast local disk, kept across runs\n"
+		"  --l2-size <MB>  size of its data (default 1024)\n"
+		"  --huge-pages  back the read buffers with huge pages where the os allows\n"
+		"  --kernel <name=impl,..>  use these instead of the fastest (fletcher4=avx2,sha256=scalar), also ZFS_KERNELS\n"
+		"\n"
+		"examples:\n"
+		"  zfs-win.exe mount \"m:\\\" \"rpool/ROOT/opensolaris\" \"\\\\.\\PhysicalDrive1\" \"\\\\.\\PhysicalDrive2\"\n"
+		"  zfs-win.exe list \"Virtual Machine-flat.vmdk\"\n"
+		"  zfs-win test rpool/export/home /dev/sdb /dev/sdc\n"
+		);
+
+	// TODO: 
+	// list uberblocks
+	// mount specific uberblock
+	// overwrite uberblock magic number to rollback to earlier state
+}
+
+static void stats(ZFS::Pool& pool)
+{
+	for(size_t i = 0; i < pool.m_devs.size(); i++)
+	{
+		ZFS::Device* dev = pool.m_devs[i];
+
+		const ZFS::DeviceStats& s = dev->m_stats;
+
+		printf("device %d: %lld bytes, %lld reads, %lld ios, %lld merged, %lld gap bytes, max depth %lld\n", 
+			(int)i, (long long)dev->m_bytes, (long long)s.reads, (long long)s.ios, (long long)s.merged, (long long)s.gap_bytes, (long long)s.max_depth);
+
+		const ZFS::LatencyHistogram& h = dev->m_latency;
+
+		printf("  latency: p50 <%lld us, p95 <%lld us, p99 <%lld us, recent %lld us\n", 
+			(long long)h.GetPercentile(0.5), (long long)h.GetPercentile(0.95), (long long)h.GetPercentile(0.99), (long long)h.GetRecent());
+
+		std::vector<ZFS::BadExtent> bad;
+
+		dev->m_bad.GetExtents(bad);
+
+		if(!bad.empty() || dev->m_bad.GetSkipped() > 0)
+		{
+			printf("  bad extents: %d, reads skipped %lld\n", (int)bad.size(), (long long)dev->m_bad.GetSkipped());
+
+			for(size_t j = 0; j < bad.size() && j < 16; j++)
+			{
+				const ZFS::BadExtent& e = bad[j];
+
+				printf("    %016llx-%016llx %s, %d failures, retry in %lld ms\n", 
+					(unsigned long long)e.start, (unsigned long long)e.end, e.cksum ? "cksum" : "read", (int)e.failures, (long long)e.retry_ms);
+			}
+		}
+	}
+
+	printf("hedged reads: %lld, won by the hedge: %lld\n", (long long)pool.m_stats.hedged, (long long)pool.m_stats.hedge_wins);
+
+	printf("collapsed reads: %lld, read from another copy first: %lld\n", (long long)pool.m_stats.collapsed, (long long)pool.m_stats.reordered);
+
+	const ZFS::BlockCacheStats& cs = pool.m_cache.m_stats;
+
+	printf("cache: %lld hits, %lld misses, %lld inserts, %lld evictions, ghost hits %lld recent / %lld frequent\n", 
+		(long long)cs.hits, (long long)cs.misses, (long long)cs.inserts, (long long)cs.evictions, (long long)cs.mru_ghost_hits, (long long)cs.mfu_ghost_hits);
+
+	printf("  %lld KB recent, %lld KB frequent, recent target %lld KB of %lld KB\n", 
+		(long long)pool.m_cache.GetSize(false) >> 10, (long long)pool.m_cache.GetSize(true) >> 10, (long long)pool.m_cache.GetTarget() >> 10, (long long)pool.m_cache.GetBudget() >> 10);
+
+	uint64_t stored = pool.m_cache.GetSize(false) + pool.m_cache.GetSize(true);
+
+	printf("  %s: %lld KB stored for %lld KB of data, %lld KB decompressed tier, %lld decompressed hits, %lld tier hits\n", 
+		pool.m_cache.IsCompressed() ? "compressed" : "logical", (long long)stored >> 10, (long long)pool.m_cache.GetLogicalSize() >> 10, 
+		(long long)pool.m_cache.GetHotSize() >> 10, (long long)cs.decompressed, (long long)cs.hot_hits);
+
+	if(pool.m_l2.IsOpen())
+	{
+		const ZFS::L2CacheStats& ls = pool.m_l2.m_stats;
+
+		printf("l2: %lld hits, %lld misses, %lld writes, %lld bad, %lld loaded, %lld blocks, %lld KB of %lld KB\n", 
+			(long long)ls.hits, (long long)ls.misses, (long long)ls.writes, (long long)ls.bad, (long long)ls.loaded, 
+			(long long)pool.m_l2.GetCount(), (long long)pool.m_l2.GetSize() >> 10, (long long)pool.m_l2.GetCapacity() >> 10);
+	}
+
+	ZFS::BufferPoolStats bs[ZFS::BufferPool::CLASSES];
+
+	ZFS::BufferPool::Get().GetStats(bs);
+
+	printf("buffers:%s\n", ZFS::BufferPool::Get().GetHugePages() ? " (huge pages)" : "");
+
+	for(int i = 0; i < ZFS::BufferPool::CLASSES; i++)
+	{
+		if(bs[i].slabs > 0)
+		{
+			uint64_t total = bs[i].slabs * ZFS::BufferPool::SLAB_SIZE / bs[i].size;
+
+			printf("  %7d bytes: %lld slabs, %lld used, %lld free, %lld in thread caches\n", 
+				(int)bs[i].size, (long long)bs[i].slabs, (long long)bs[i].used, (long long)bs[i].free, (long long)(total - bs[i].used - bs[i].free));
+		}
+	}
+}
+
+template<class T> static double throughput(size_t bytes, T f)
+{
+	// runs f for a while, returns GB/s
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::chrono::duration<double> elapsed;
+
+	uint64_t n = 0;
+
+	do
+	{
+		for(int i = 0; i < 16; i++)
+		{
+			f();
+		}
+
+		n += 16;
+
+		elapsed = std::chrono::steady_clock::now() - start;
+	}
+	while(elapsed.count() < 0.2);
+
+	return (double)bytes * n / elapsed.count() / 1e9;
+}
+
+static void bench_raidz()
+{
+	const ZFS::raidz_impl_t* impls;
+
+	size_t count = ZFS::raidz_get_impls(&impls);
+
+	const ZFS::raidz_impl_t* selected = ZFS::raidz_get_impl();
+
+	// 128k blocks, the raidz2 and raidz3 maps have 8 data columns, the ones following parity are rebuilt
+
+	const size_t size = 128 << 10;
+
+	std::vector<uint8_t> src(size);
+	std::vector<uint8_t> dst(size);
+	std::vector<uint8_t> ref(size);
+
+	for(size_t i = 0; i < size; i++)
+	{
+		src[i] = (uint8_t)rand();
+	}
+
+	raidz_map_t rm2(0, size, 9, 10, 2);
+	raidz_map_t rm3(0, size, 9, 11, 3);
+
+	std::vector<uint8_t> buff2(rm2.m_col[0].size * rm2.m_cols);
+	std::vector<uint8_t> buff3(rm3.m_col[0].size * rm3.m_cols);
+
+	uint8_t* cols2[16];
+	uint8_t* cols3[16];
+
+	for(uint32_t c = 0; c < rm2.m_cols; c++) cols2[c] = &buff2[c * rm2.m_col[0].size];
+	for(uint32_t c = 0; c < rm3.m_cols; c++) cols3[c] = &buff3[c * rm3.m_col[0].size];
+
+	for(size_t i = 0; i < buff2.size(); i++) buff2[i] = (uint8_t)rand();
+	for(size_t i = 0; i < buff3.size(); i++) buff3[i] = (uint8_t)rand();
+
+	ZFS::raidz_generate(rm2, cols2);
+	ZFS::raidz_generate(rm3, cols3);
+
+	uint32_t bad2[] = {2, 3};
+	uint32_t bad3[] = {3, 4, 5};
+
+	printf("raidz kernels, GB/s of data (%d KB blocks)\n", (int)(size >> 10));
+	printf("%-8s %8s %8s %8s %8s\n", "", "xor", "gf mul", "raidz2", "raidz3");
+
+	for(size_t i = 0; i < count; i++)
+	{
+		const ZFS::raidz_impl_t* impl = &impls[i];
+
+		ZFS::raidz_set_impl(impl);
+
+		// same results as the scalar code
+
+		memset(dst.data(), 0, size);
+
+		impl->mul_func(dst.data(), src.data(), size, 0x8e);
+
+		if(i == 0)
+		{
+			ref = dst;
+		}
+
+		std::vector<uint8_t> data2(buff2);
+		std::vector<uint8_t> data3(buff3);
+
+		ZFS::raidz_reconstruct(rm2, cols2, bad2, 2);
+		ZFS::raidz_reconstruct(rm3, cols3, bad3, 3);
+
+		bool ok = dst == ref && data2 == buff2 && data3 == buff3;
+
+		double x = throughput(size, [&] () {impl->xor_func(dst.data(), src.data(), size);});
+		double m = throughput(size, [&] () {impl->mul_func(dst.data(), src.data(), size, 0x8e);});
+		double r2 = throughput(size, [&] () {ZFS::raidz_reconstruct(rm2, cols2, bad2, 2);});
+		double r3 = throughput(size, [&] () {ZFS::raidz_reconstruct(rm3, cols3, bad3, 3);});
+
+		printf("%-8s %8.2f %8.2f %8.2f %8.2f%s%s\n", impl->name, x, m, r2, r3, impl == selected ? " (selected)" : "", ok ? "" : " MISMATCH");
+	}
+
+	ZFS::raidz_set_impl(selected);
+}
+
+static void bench_cksum()
+{
+	const ZFS::cksum_impl_t* impls;
+
+	size_t count = ZFS::cksum_get_impls(&impls);
+
+	const size_t size = 128 << 10;
+
+	uint8_t* buff = (uint8_t*)_aligned_malloc(size, 16); // blocks are read into aligned buffers
+
+	for(size_t i = 0; i < size; i++)
+	{
+		buff[i] = (uint8_t)rand();
+	}
+
+	printf("checksums, GB/s (%d KB blocks)\n", (int)(size >> 10));
+
+	static const struct {uint8_t type; const char* name;} types[] = 
+	{
+		{ZIO_CHECKSUM_FLETCHER_2, "fletcher2"},
+		{ZIO_CHECKSUM_FLETCHER_4, "fletcher4"},
+		{ZIO_CHECKSUM_SHA256, "sha256"},
+	};
+
+	for(size_t j = 0; j < sizeof(types) / sizeof(types[0]); j++)
+	{
+		const ZFS::cksum_impl_t* ref = NULL;
+		const ZFS::cksum_impl_t* selected = ZFS::cksum_get_impl(types[j].type);
+
+		for(size_t i = 0; i < count && ref == NULL; i++)
+		{
+			if(impls[i].cksum_type == types[j].type)
+			{
+				ref = &impls[i];
+			}
+		}
+
+		for(size_t i = 0; i < count; i++)
+		{
+			const ZFS::cksum_impl_t* impl = &impls[i];
+
+			if(impl->cksum_type != types[j].type)
+			{
+				continue;
+			}
+
+			// same results as the first one, including sizes not a multiple of the vector width
+
+			bool ok = true;
+
+			for(size_t n = 0; n <= 1024 && ok; n += types[j].type == ZIO_CHECKSUM_FLETCHER_2 ? 16 : 4)
+			{
+				cksum_t a, b;
+
+				ref->func(buff, n, &a);
+				impl->func(buff, n, &b);
+
+				ok = a == b;
+			}
+
+			cksum_t tmp;
+
+			double r = throughput(size, [&] () {impl->func(buff, size, &tmp);});
+
+			printf("%-10s %-10s %8.2f%s%s\n", types[j].name, impl->name, r, impl == selected ? " (selected)" : "", ok ? "" : " MISMATCH");
+		}
+	}
+
+	_aligned_free(buff);
+
+	// a wave of blocks checked in one call against one by one
+
+	const size_t n = 8;
+
+	std::vector<uint8_t> data(n * size);
+
+	for(size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = (uint8_t)rand();
+	}
+
+	const void* bufs[n];
+	uint64_t sizes[n];
+	uint8_t kinds[n];
+	cksum_t many[n];
+	cksum_t one[n];
+
+	for(size_t j = 1; j < sizeof(types) / sizeof(types[0]); j++)
+	{
+		for(size_t i = 0; i < n; i++)
+		{
+			bufs[i] = &data[i * size];
+			sizes[i] = size;
+			kinds[i] = types[j].type;
+		}
+
+		double batched = throughput(n * size, [&] () {ZFS::hash_many(bufs, sizes, kinds, many, n);});
+		double single = throughput(n * size, [&] () {for(size_t i = 0; i < n; i++) ZFS::hash(bufs[i], sizes[i], &one[i], kinds[i]);});
+
+		bool ok = memcmp(many, one, sizeof(many)) == 0;
+
+		printf("%-10s %d at once %8.2f, one by one %8.2f%s\n", types[j].name, (int)n, batched, single, ok ? "" : " MISMATCH");
+	}
+}
+
+static void kernels()
+{
+	// timed on their first use, which is now
+
+	printf("%-16s %-10s %8s\n", "kernel", "impl", "GB/s");
+
+	const std::vector<ZFS::Kernel*>& all = ZFS::Kernel::GetAll();
+
+	for(auto i = all.begin(); i != all.end(); i++)
+	{
+		ZFS::Kernel* k = *i;
+
+		const std::vector<ZFS::Kernel::Impl>& impls = k->GetImpls();
+
+		size_t selected = k->Get();
+
+		for(size_t j = 0; j < impls.size(); j++)
+		{
+			const ZFS::Kernel::Impl& impl = impls[j];
+
+			printf("%-16s %-10s %8.2f%s%s\n", j == 0 ? k->GetName() : "", impl.name.c_str(), impl.rate, 
+				j != selected ? "" : k->IsForced() ? " (forced)" : " (selected)", impl.ok ? "" : " MISMATCH");
+		}
+	}
+}
+
+static void bench_raidz_map()
+{
+	// a mix of metadata and data block sizes at random offsets, the geometry cache against building the map each time
+
+	const uint32_t n = 4096;
+
+	std::vector<uint64_t> offsets(n);
+	std::vector<uint32_t> sizes(n);
+
+	for(uint32_t i = 0; i < n; i++)
+	{
+		offsets[i] = ((uint64_t)rand() << 9) & ((1ULL << 40) - 1);
+		sizes[i] = (i & 3) == 0 ? 128 << 10 : (1 + rand() % 32) << 9;
+	}
+
+	static const struct {uint32_t dcols, nparity;} configs[] = {{4, 1}, {6, 2}, {11, 3}};
+
+	printf("raidz maps, millions per second\n");
+
+	for(size_t j = 0; j < sizeof(configs) / sizeof(configs[0]); j++)
+	{
+		uint32_t dcols = configs[j].dcols;
+		uint32_t nparity = configs[j].nparity;
+
+		ZFS::RaidzGeometry geometry(9, dcols, nparity);
+
+		volatile uint64_t sink = 0;
+
+		double build = throughput(n, [&] ()
+		{
+			for(uint32_t i = 0; i < n; i++)
+			{
+				raidz_map_t rm(offsets[i], sizes[i], 9, dcols, nparity);
+
+				sink += rm.m_col[rm.m_cols - 1].offset;
+			}
+		});
+
+		double cached = throughput(n, [&] ()
+		{
+			raidz_map_t tmp;
+			uint64_t row;
+
+			for(uint32_t i = 0; i < n; i++)
+			{
+				const raidz_map_t* rm = geometry.Get(offsets[i], sizes[i], row, tmp);
+
+				sink += row + rm->m_col[rm->m_cols - 1].offset;
+			}
+		});
+
+		printf("%2d wide raidz%d: build %6.1f, cached %6.1f\n", dcols, nparity, build * 1000, cached * 1000);
+	}
+}
+
+static void bench_buffers()
+{
+	// the sizes a read allocates on its way, compressed blocks, indirect blocks, small metadata
+
+	const size_t n = 256;
+
+	static const size_t sizes[] = {128 << 10, 16 << 10, 512, 4096, 64 << 10, 1536};
+
+	std::vector<void*> buffs(n);
+
+	printf("buffer allocation, millions of alloc and free pairs per second\n");
+
+	double pool = throughput(n, [&] ()
+	{
+		for(size_t i = 0; i < n; i++) buffs[i] = ZFS::BufferPool::Get().Alloc(sizes[i % 6]);
+		for(size_t i = 0; i < n; i++) ZFS::BufferPool::Get().Free(buffs[i]);
+	});
+
+	double heap = throughput(n, [&] ()
+	{
+		for(size_t i = 0; i < n; i++) buffs[i] = _aligned_malloc(sizes[i % 6], 16);
+		for(size_t i = 0; i < n; i++) _aligned_free(buffs[i]);
+	});
+
+	printf("pool %6.1f, _aligned_malloc %6.1f\n", pool * 1000, heap * 1000);
+}
+
+// a device that takes its time with every read, the copy on it should not be read first
+
+class DelayBackend : public ZFS::DeviceBackend
+{
+	struct Shadow {ZFS::DeviceRequest io; ZFS::DeviceRequest* req;};
+
+	ZFS::DeviceBackend* m_backend;
+	std::chrono::microseconds m_delay;
+	std::list<Shadow> m_inflight; // completions are held back until the delay has passed
+
+	size_t Release()
+	{
+		size_t count = 0;
+
+		auto now = std::chrono::steady_clock::now();
+
+		for(auto i = m_inflight.begin(); i != m_inflight.end(); )
+		{
+			if(i->io.done && now >= i->io.completed + m_delay)
+			{
+				i->req->result = i->io.result;
+				i->req->completed = now;
+				i->req->done = true;
+
+				i = m_inflight.erase(i);
+
+				count++;
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		return count;
+	}
+
+public:
+	DelayBackend(ZFS::DeviceBackend* backend, int64_t delay) : m_backend(backend), m_delay(delay) {}
+	virtual ~DelayBackend() {delete m_backend;}
+
+	bool Open(const wchar_t* path) {return m_backend->Open(path);}
+	void Close() {m_backend->Close(); m_inflight.clear();}
+	uint64_t GetSize() {return m_backend->GetSize();}
+	size_t GetAlignment() {return m_backend->GetAlignment();}
+	void SetAlignment(size_t align) {m_backend->SetAlignment(align);}
+	bool BeginRead(void* buff, size_t size, uint64_t offset) {return m_backend->BeginRead(buff, size, offset);}
+	size_t EndRead() {return m_backend->EndRead();}
+	uint8_t* Map(uint64_t offset, size_t size) {return m_backend->Map(offset, size);}
+
+	bool Submit(ZFS::DeviceRequest* const* reqs, size_t count)
+	{
+		std::vector<ZFS::DeviceRequest*> ios(count);
+
+		for(size_t i = 0; i < count; i++)
+		{
+			Shadow s;
+
+			s.io = *reqs[i];
+			s.io.done = false;
+			s.req = reqs[i];
+			s.req->done = false;
+
+			m_inflight.push_back(s);
+
+			ios[i] = &m_inflight.back().io;
+		}
+
+		return m_backend->Submit(ios.data(), count);
+	}
+
+	bool WaitAny(int64_t timeout)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout);
+
+		for(;;)
+		{
+			m_backend->WaitAny(0);
+
+			if(Release() > 0 || m_inflight.empty()) return true;
+			if(timeout >= 0 && std::chrono::steady_clock::now() >= deadline) return false;
+
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	}
+
+	bool Wait(int64_t timeout)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout);
+
+		while(!m_inflight.empty())
+		{
+			int64_t left = timeout < 0 ? -1 : std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count(), 0);
+
+			if(!WaitAny(left)) return false;
+		}
+
+		return true;
+	}
+};
+
+static void bench_copies()
+{
+	// two copies of the same image, one of them slowed down, both read the same number of times
+
+	const char* name = "zfs-win-bench.tmp";
+	const wchar_t* path = L"zfs-win-bench.tmp";
+	const size_t size = 1 << 20;
+	const size_t rounds = 64;
+
+	FILE* fp = fopen(name, "wb");
+
+	if(fp == NULL) {printf("copy selection: cannot create %s\n", name); return;}
+
+	std::vector<uint8_t> buff(size, 0x5a);
+
+	fwrite(buff.data(), 1, size, fp);
+	fclose(fp);
+
+	ZFS::Device devs[2];
+
+	devs[0].m_backend = ZFS::DeviceBackend::Create();
+	devs[1].m_backend = new DelayBackend(ZFS::DeviceBackend::Create(), 2000);
+
+	bool opened = true;
+
+	for(int i = 0; i < 2; i++)
+	{
+		opened = devs[i].m_backend->Open(path) && opened;
+
+		devs[i].m_size = devs[i].m_backend->GetSize();
+	}
+
+	if(opened)
+	{
+		std::vector<uint8_t> dst[2] = {std::vector<uint8_t>(4096), std::vector<uint8_t>(4096)};
+
+		for(size_t i = 0; i < rounds; i++)
+		{
+			ZFS::IoBatch batch;
+
+			uint64_t offset = (uint64_t)(i * 4096 * 7) % (size - 4096);
+
+			batch.Add(&devs[0], dst[0].data(), 4096, offset);
+			batch.Add(&devs[1], dst[1].data(), 4096, offset);
+
+			batch.Execute();
+		}
+
+		ZFS::Pool pool;
+
+		ZFS::VirtualDevice leaves[2] = {ZFS::VirtualDevice(), ZFS::VirtualDevice()};
+
+		int64_t cost[2];
+
+		for(int i = 0; i < 2; i++)
+		{
+			leaves[i].type = "file";
+			leaves[i].dev = &devs[i];
+
+			cost[i] = pool.GetCost(&leaves[i], 0, 4096);
+		}
+
+		printf("copy selection, expected microseconds to read after %d reads from each\n", (int)rounds);
+		printf("plain %lld, slowed %lld, %s copy first\n", (long long)cost[0], (long long)cost[1], cost[0] <= cost[1] ? "plain" : "SLOWED");
+	}
+	else
+	{
+		printf("copy selection: cannot open %s\n", name);
+	}
+
+	for(int i = 0; i < 2; i++)
+	{
+		devs[i].Close();
+	}
+
+	remove(name);
+}
+
+#ifdef _WIN32
+
+static void repair()
+{
+	HANDLE handle[4];
+	uint64_t size[4];
+	LARGE_INTEGER li, li2;
+	DWORD n;
+	static vdev_label_t label[4][4];
+
+	memset(label, 0, sizeof(label));
+
+	for(int i = 0; i < 4; i++)
+	{
+		std::wstring s = Util::Format(L"\\\\.\\PhysicalDrive%d", i + 1);
+
+		handle[i] = CreateFile(s.c_str(), GENERIC_WRITE | GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, (HANDLE)NULL);
+
+		if(handle[i] == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+
+		if(!GetFileSizeEx(handle[i], (LARGE_INTEGER*)&size[i]))
+		{
+			DISK_GEOMETRY_EX dg;
+			DWORD sz;
+		
+			if(DeviceIoControl(handle[i], IOCTL_DISK_GET_DRIVE_GEOMETRY_EX, NULL, 0, &dg, sizeof(dg), &sz, NULL))
+			{
+				size[i] = dg.DiskSize.QuadPart;
+			}
+		}
+
+		li.QuadPart = 0;
+		SetFilePointerEx(handle[i], li, &li2, FILE_BEGIN);
+		ReadFile(handle[i], &label[i][0], sizeof(vdev_label_t), &n, NULL);
+		ReadFile(handle[i], &label[i][1], sizeof(vdev_label_t), &n, NULL);
+
+		li.QuadPart = size[i] - sizeof(vdev_label_t) * 2 - 0x26000;
+		SetFilePointerEx(handle[i], li, &li2, FILE_BEGIN);
+		ReadFile(handle[i], &label[i][2], sizeof(vdev_label_t), &n, NULL);
+		ReadFile(handle[i], &label[i][3], sizeof(vdev_label_t), &n, NULL);
+	}
+
+	for(int i = 0; i < 4; i++)
+	{
+		for(int j = 0; j < 4; j++)
+		{
+			uberblock_t* ub = (uberblock_t*)&label[j][i].uberblock[8 << 10];
+
+			ub->magic = 0;
+
+			printf("%d\n", ub->txg);
+		}
+	}
+
+	for(int i = 0; i < 4; i++)
+	{
+		li.QuadPart = 0;
+		SetFilePointerEx(handle[i], li, &li2, FILE_BEGIN);
+		WriteFile(handle[i], &label[i][0], sizeof(vdev_label_t), &n, NULL);
+		WriteFile(handle[i], &label[i][1], sizeof(vdev_label_t), &n, NULL);
+
+		li.QuadPart = size[i] - sizeof(vdev_label_t) * 2 - 0x26000;
+		SetFilePointerEx(handle[i], li, &li2, FILE_BEGIN);
+		WriteFile(handle[i], &label[i][2], sizeof(vdev_label_t), &n, NULL);
+		WriteFile(handle[i], &label[i][3], sizeof(vdev_label_t), &n, NULL);
+
+		CloseHandle(handle[i]);
+	}
+}
+
+#endif
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+	// repair(); return -1;
+
+	uint32_t flags = 0;
+	long merge_gap = -1;
+	int mirror_policy = -1;
+	double hedge = -1;
+	long cache = -1;
+	int cache_mode = -1;
+	std::wstring l2;
+	long l2_size = 1024;
+
+	for(; argc > 1 && wcsncmp(argv[1], L"--", 2) == 0; argc--, argv++)
+	{
+		if(wcsicmp(argv[1], L"--mmap") == 0)
+		{
+			flags |= ZFS::DEVICE_MAPPED;
+		}
+		else if(wcsicmp(argv[1], L"--direct") == 0)
+		{
+			flags |= ZFS::DEVICE_DIRECT;
+		}
+		else if(wcsicmp(argv[1], L"--mirror") == 0 && argc > 2)
+		{
+			if(wcsicmp(argv[2], L"rr") == 0) mirror_policy = ZFS::MIRROR_ROUND_ROBIN;
+			else if(wcsicmp(argv[2], L"lo") == 0) mirror_policy = ZFS::MIRROR_LEAST_OUTSTANDING;
+			else if(wcsicmp(argv[2], L"locality") == 0) mirror_policy = ZFS::MIRROR_LOCALITY;
+			else {usage(); return -1;}
+
+			argc--;
+			argv++;
+		}
+		else if(wcsicmp(argv[1], L"--hedge") == 0 && argc > 2)
+		{
+			hedge = wcstod(argv[2], NULL);
+
+			argc--;
+			argv++;
+		}
+		else if(wcsicmp(argv[1], L"--cache") == 0 && argc > 2)
+		{
+			cache = wcstol(argv[2], NULL, 10);
+
+			argc--;
+			argv++;
+		}
+		else if(wcsicmp(argv[1], L"--cache-mode") == 0 && argc > 2)
+		{
+			if(wcsicmp(argv[2], L"compressed") == 0) cache_mode = 1;
+			else if(wcsicmp(argv[2], L"logical") == 0) cache_mode = 0;
+			else {usage(); return -1;}
+
+			argc--;
+			argv++;
+		}
+		else if(wcsicmp(argv[1], L"--huge-pages") == 0)
+		{
+			ZFS::BufferPool::Get().SetHugePages(true);
+		}
+		else if(wcsicmp(argv[1], L"--l2") == 0 && argc > 2)
+		{
+			l2 = argv[2];
+
+			argc--;
+			argv++;
+		}
+		else if(wcsicmp(argv[1], L"--l2-size") == 0 && argc > 2)
+		{
+			l2_size = wcstol(argv[2], NULL, 10);
+
+			argc--;
+			argv++;
+		}
+		else if(wcsicmp(argv[1], L"--merge-gap") == 0 && argc > 2)
+		{
+			merge_gap = wcstol(argv[2], NULL, 10);
+
+			argc--;
+			argv++;
+		}
+		else if(wcsicmp(argv[1], L"--kernel") == 0 && argc > 2)
+		{
+			if(!ZFS::Kernel::Configure(Util::UTF16To8(argv[2]).c_str()))
+			{
+				return -1;
+			}
+
+			argc--;
+			argv++;
+		}
+		else
+		{
+			usage();
+
+			return -1;
+		}
+	}
+
+	if(argc < 2) {usage(); return -1;}
+
+	std::wstring mp;
+	std::list<std::wstring> paths;
+	std::wstring pool;
+	std::wstring  dataset;
+	bool list_only = false;
+	bool test_only = false;
+
+	if(wcsicmp(argv[1], L"mount") == 0 || wcsicmp(argv[1], L"test") == 0)
+	{
+		test_only = wcsicmp(argv[1], L"test") == 0;
+
+		int first = test_only ? 2 : 3;
+
+		if(argc < first + 2) {usage(); return -1;}
+
+		if(!test_only)
+		{
+			mp = argv[2];
+		}
+
+		std::list<std::wstring> sl;
+
+		Util::Explode(std::wstring(argv[first]), sl, L"/");
+
+		pool = sl.front();
+
+		sl.pop_front();
+
+		dataset = Implode(sl, '/');
+
+		for(int i = first + 1; i < argc; i++)
+		{
+			paths.push_back(argv[i]);
+		}
+	}
+	else if(wcsicmp(argv[1], L"kernels") == 0)
+	{
+		kernels();
+
+		return 0;
+	}
+	else if(wcsicmp(argv[1], L"bench") == 0)
+	{
+		bench_raidz();
+		bench_cksum();
+		bench_raidz_map();
+		bench_buffers();
+		bench_copies();
+
+		return 0;
+	}
+	else if(wcsicmp(argv[1], L"list") == 0)
+	{
+		if(argc < 3) {usage(); return -1;}
+
+		for(int i = 2; i < argc; i++)
+		{
+			paths.push_back(argv[i]);
+		}
+
+		list_only = true;
+	}
+	
+	if(paths.empty()) {usage(); return -1;}
+
+	/*
+
+	paths.clear();
+	paths.push_back(L"\\\\.\\PhysicalDrive1");
+	paths.push_back(L"\\\\.\\PhysicalDrive2");
+	paths.push_back(L"\\\\.\\PhysicalDrive3");
+	paths.push_back(L"\\\\.\\PhysicalDrive4");
+
+	pool = L"share";
+	dataset = L"backup";
+
+	*/
+
+	ZFS::Context ctx;
+
+	if(!ctx.Init(paths, pool, flags))
+	{
+		return -1;
+	}
+
+	if(hedge >= 0)
+	{
+		ctx.m_pool.m_hedge_percentile = hedge;
+	}
+
+	if(cache_mode >= 0)
+	{
+		ctx.m_pool.m_cache.SetCompressed(cache_mode != 0);
+	}
+
+	if(cache >= 0)
+	{
+		ctx.m_pool.m_cache.SetBudget((uint64_t)cache << 20);
+	}
+
+	if(!l2.empty() && !ctx.m_pool.OpenL2(l2.c_str(), (uint64_t)l2_size << 20))
+	{
+		wprintf(L"Cannot open cache file %ls\n", l2.c_str());
+	}
+
+	if(mirror_policy >= 0)
+	{
+		ctx.m_pool.SetMirrorPolicy((uint32_t)mirror_policy);
+	}
+
+	if(merge_gap >= 0)
+	{
+		for(auto i = ctx.m_pool.m_devs.begin(); i != ctx.m_pool.m_devs.end(); i++)
+		{
+			(*i)->m_merge_gap = (size_t)merge_gap;
+		}
+	}
+
+	if(list_only)
+	{
+		ctx.List(ctx.m_root);
+
+		return 0;
+	}
+
+	if(!ctx.SetDataSet(dataset))
+	{
+		return -1;
+	}
+
+	if(test_only)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		ctx.m_mounted->Test();
+
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		printf("read test finished in %.2f s\n", elapsed.count());
+
+		stats(ctx.m_pool);
+
+		return 0;
+	}
+
+#ifdef _WIN32
+
+	//
+
+	DOKAN_OPTIONS options;
+
+	memset(&options, 0, sizeof(DOKAN_OPTIONS));
+
+	options.Version = DOKAN_VERSION;
+	options.GlobalContext = (ULONG64)&ctx;
+	options.ThreadCount = 1; // TODO
+	options.Options = DOKAN_OPTION_KEEP_ALIVE;
+	options.MountPoint = mp.c_str();
+
+	#ifdef _DEBUG
+
+	options.Options |= DOKAN_OPTION_DEBUG;
+
+	#endif
+
+	DOKAN_OPERATIONS ops;
+
+	memset(&ops, 0, sizeof(DOKAN_OPERATIONS));
+
+	ops.CreateFile = ZFS::CreateFile;
+	ops.OpenDirectory = ZFS::OpenDirectory;
+	ops.CreateDirectory = ZFS::CreateDirectory;
+	ops.Cleanup = ZFS::Cleanup;
+	ops.CloseFile = ZFS::CloseFile;
+	ops.ReadFile = ZFS::ReadFile;
+	ops.WriteFile = ZFS::WriteFile;
+	ops.FlushFileBuffers = ZFS::FlushFileBuffers;
+	ops.GetFileInformation = ZFS::GetFileInformation;
+	ops.FindFiles = ZFS::FindFiles;
+	ops.FindFilesWithPattern = ZFS::FindFilesWithPattern;
+	ops.SetFileAttributes = ZFS::SetFileAttributes;
+	ops.SetFileTime = ZFS::SetFileTime;
+	ops.DeleteFile = ZFS::DeleteFile;
+	ops.DeleteDirectory = ZFS::DeleteDirectory;
+	ops.MoveFile = ZFS::MoveFile;
+	ops.SetEndOfFile = ZFS::SetEndOfFile;
+	ops.SetAllocationSize = ZFS::SetAllocationSize;
+	ops.LockFile = ZFS::LockFile;
+	ops.UnlockFile = ZFS::UnlockFile;
+	ops.GetDiskFreeSpace = ZFS::GetDiskFreeSpace;
+	ops.GetVolumeInformation = ZFS::GetVolumeInformation;
+	ops.Unmount = ZFS::Unmount;
+
+	switch(int status = DokanMain(&options, &ops))
+	{
+	case DOKAN_SUCCESS:
+		printf("Success\n");
+		break;
+	case DOKAN_ERROR:
+		printf("Error\n");
+		break;
+	case DOKAN_DRIVE_LETTER_ERROR:
+		printf("Bad Drive letter\n");
+		break;
+	case DOKAN_DRIVER_INSTALL_ERROR:
+		printf("Can't install driver\n");
+		break;
+	case DOKAN_START_ERROR:
+		printf("Driver something wrong\n");
+		break;
+	case DOKAN_MOUNT_ERROR:
+		printf("Can't assign a drive letter\n");
+		break;
+	default:
+		printf("Unknown error: %d\n", status);
+		break;
+	}
+
+#else
+
+	printf("mount is not supported on this platform\n");
+
+	return -1;
+
+#endif
+
+	// std::list<std::wstring> paths;
+
+	/*
+	const char* name = "mpool";
+
+	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM1-flat.vmdk");
+	
+	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM2-flat.vmdk");
+	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM3-flat.vmdk");
+	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM4-flat.vmdk");
+	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM5-flat.vmdk");
+	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM6-flat.vmdk");
+	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM7-flat.vmdk");
+	paths.push_back(L"D:\\Virtual Machines\\ZFSVM\\ZFSVM8-flat.vmdk");
+	*/
+
+	/*
+	const char* name = "share";
+
+	paths.push_back(L"\\\\.\\PhysicalDrive1");
+	paths.push_back(L"\\\\.\\PhysicalDrive2");
+	paths.push_back(L"\\\\.\\PhysicalDrive3");
+	paths.push_back(L"\\\\.\\PhysicalDrive4");
+	*/
+
+	/*
+	const char* name = "rpool";
+
+	paths.push_back(L"D:\\Virtual Machines\\OpenSolaris\\OpenSolaris-flat.vmdk");	
+	*/
+
+	/*
+	const char* name = "rpool";
+
+	paths.push_back(L"D:\\Virtual Machines\\ZFS1VM\\ZFS1VM-flat.vmdk");
+	*/
+
+	return 0;
+}
+
+#ifndef _WIN32
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::wstring> args;
+	std::vector<wchar_t*> argw;
+
+	for(int i = 0; i < argc; i++)
+	{
+		args.push_back(Util::UTF8To16(argv[i]));
+	}
+
+	for(int i = 0; i < argc; i++)
+	{
+		argw.push_back(&args[i][0]);
+	}
+
+	argw.push_back(NULL);
+
+	return _tmain(argc, argw.data());
+}
+
+#endif
@@ -1,59 +1,90 @@
-/* 
- *	Copyright (C) 2010 Gabest
- *	http://code.google.com/p/zfs-win/
- *
- *  This Program is free software; you can redistribute it and/or modify
- *  it under the terms of the GNU General Public License as published by
- *  the Free Software Foundation; either version 2, or (at your option)
- *  any later version.
- *   
- *  This Program is distributed in the hope that it will be useful,
- *  but WITHOUT ANY WARRANTY; without even the implied warranty of
- *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
- *  GNU General Public License for more details.
- *   
- *  You should have received a copy of the GNU General Public License
- *  along with GNU Make; see the file COPYING.  If not, write to
- *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
- *  http://www.gnu.org/copyleft/gpl.html
- *
- */
-
-// stdafx.h : include file for standard system include files,
-// or project specific include files that are used frequently, but
-// are changed infrequently
-//
-
-#pragma once
-
-#include "targetver.h"
-
-#include <windows.h>
-#include <wincrypt.h>
-#include <shlwapi.h>
-
-#include <stdio.h>
-#include <stdint.h>
-#include <tchar.h>
-#include <time.h>
-#include <vector>
-#include <list>
-#include <map>
-#include <set>
-#include <queue>
-#include <stack>
-#include <string>
-#include <memory>
-#include <algorithm>
-#include <emmintrin.h>
-
-#ifndef ASSERT
- #if defined(_DEBUG) && defined(_MSC_VER)
-  #include <assert.h>
-  #define ASSERT assert
- #else
-  #define ASSERT(exp) ((void)0)
- #endif
-#endif
-
-// TODO: reference additional headers your program requires here
+/* 
+ *	Copyright (C) 2010 Gabest
+ *	http://code.google.com/p/zfs-win/
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *   
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *   
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA. 
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+// stdafx.h : include file for standard system include files,
+// or project specific include files that are used frequently, but
+// are changed infrequently
+//
+
+#pragma once
+
+#ifdef _WIN32
+
+#include "targetver.h"
+
+#include <windows.h>
+#include <shlwapi.h>
+#include <tchar.h>
+
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <set>
+#include <queue>
+#include <stack>
+#include <string>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#ifndef _WIN32
+#include "Posix.h"
+#endif
+
+// functions using instruction sets beyond the baseline, only called after checking Cpu::Get()
+
+#if defined(__GNUC__)
+ #define TARGET(isa) __attribute__((target(isa)))
+ #define HAVE_AVX2 1
+ #define HAVE_AVX512 1
+#elif defined(_MSC_VER) && _MSC_VER >= 1700
+ #define TARGET(isa)
+ #define HAVE_AVX2 1
+ #if _MSC_VER >= 1910
+  #define HAVE_AVX512 1
+ #endif
+#else
+ #define TARGET(isa)
+#endif
+
+#ifndef ASSERT
+ #if defined(_DEBUG) && defined(_MSC_VER)
+  #include <assert.h>
+  #define ASSERT assert
+ #else
+  #define ASSERT(exp) ((void)0)
+ #endif
+#endif
+
+// TODO: reference additional headers your program requires here